@@ -0,0 +1,379 @@
+/*
+ * File Name: cql2cpp_bench.cc
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/02
+ *
+ */
+
+#include <benchmark/benchmark.h>
+#include <cql2cpp/cql2cpp.h>
+#include <cql2cpp/functor_avg.h>
+#include <cql2cpp/functor_buffer.h>
+#include <geos/geom/GeometryFactory.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef CQL2CPP_TEST_DIR
+#define CQL2CPP_TEST_DIR "test"
+#endif
+
+namespace fs = std::filesystem;
+using namespace cql2cpp;
+
+namespace {
+
+struct Query {
+  std::string name;  // directory and file stem
+  std::string text;
+  AstNodePtr root;  // nullptr if it does not parse
+};
+
+// The properties the queries read and the kind of value each holds, guessed
+// from the literals they are compared with.
+struct Schema {
+  enum Kind { Number, Bool, String, NumberArray, StringArray, Geometry };
+
+  std::unordered_map<std::string, size_t> index;
+  std::vector<Kind> kinds;
+  std::vector<std::vector<std::string>> strings;  // candidates of strings
+
+  size_t Add(const std::string& name) {
+    auto it = index.find(name);
+    if (it != index.end()) return it->second;
+    index.emplace(name, kinds.size());
+    kinds.emplace_back(Number);
+    strings.emplace_back();
+    return kinds.size() - 1;
+  }
+
+  void Learn(size_t i, Kind kind) {
+    if (kind == Geometry or kinds.at(i) == Number) kinds.at(i) = kind;
+  }
+
+  void LearnLiteral(size_t i, const ValueT& value) {
+    if (IsString(value)) {
+      std::string_view s;
+      GetString(value, &s);
+      std::string str(s);
+      str.erase(std::remove_if(str.begin(), str.end(),
+                               [](char c) { return c == '%' or c == '_'; }),
+                str.end());
+      strings.at(i).emplace_back(str);
+      Learn(i, String);
+    } else if (std::holds_alternative<bool>(value)) {
+      Learn(i, Bool);
+    }
+  }
+
+  // the properties a parsed query reads
+  void Learn(const AstNodePtr& root) {
+    for (const auto& node : *root) {
+      for (const auto& child : node->children()) {
+        if (child->type() != PropertyName or
+            not std::holds_alternative<std::string>(child->origin_value()))
+          continue;
+        size_t i = Add(std::get<std::string>(child->origin_value()));
+        if (node->type() == SpatialPred) Learn(i, Geometry);
+        if (node->type() == ArgumentList) Learn(i, NumberArray);
+        for (const auto& sibling : node->children()) {
+          if (sibling->type() == Literal) LearnLiteral(i, sibling->origin_value());
+          if (sibling->type() != InList and sibling->type() != Array) continue;
+          if (node->type() == ArrayPred) Learn(i, StringArray);
+          for (const auto& element : sibling->children())
+            LearnLiteral(i, element->origin_value());
+        }
+      }
+    }
+  }
+
+  void Fill() {
+    for (auto& candidates : strings)
+      for (int i = 0; i < 4; i++)
+        candidates.emplace_back("synthetic_" + std::to_string(i));
+  }
+};
+
+// A feature whose property values are derived from its ordinal, so millions
+// of them take little memory. Every geometry property is the same small box.
+class SyntheticFeature : public FeatureSource {
+ private:
+  const Schema* schema_;
+  uint64_t ordinal_;
+  std::unique_ptr<geos::geom::Geometry> geometry_;
+
+  static uint64_t Mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    return x ^ (x >> 33);
+  }
+
+ public:
+  SyntheticFeature(const Schema* schema, uint64_t ordinal,
+                   std::unique_ptr<geos::geom::Geometry> geometry)
+      : schema_(schema), ordinal_(ordinal), geometry_(std::move(geometry)) {}
+
+  ValueT get_property(const std::string& property_path) const override {
+    auto it = schema_->index.find(property_path);
+    if (it == schema_->index.end()) return NullValue;
+    size_t i = it->second;
+    uint64_t h = Mix(ordinal_ * 0x9e3779b97f4a7c15ULL + i);
+    const auto& strings = schema_->strings.at(i);
+    switch (schema_->kinds.at(i)) {
+      case Schema::Number:
+        return static_cast<double>(h % 20000) / 100.0;
+      case Schema::Bool:
+        return static_cast<bool>(h & 1);
+      case Schema::String:
+        return std::string_view(strings.at(h % strings.size()));
+      case Schema::NumberArray: {
+        ArrayType array;
+        for (size_t j = 0; j < 3; j++)
+          array.emplace_back(static_cast<double>((h >> (8 * j)) % 100));
+        return array;
+      }
+      case Schema::StringArray: {
+        ArrayType array;
+        for (size_t j = 0; j <= h % 3; j++)
+          array.emplace_back(
+              std::string(strings.at((h >> (8 * j)) % strings.size())));
+        return array;
+      }
+      case Schema::Geometry:
+        return static_cast<const geos::geom::Geometry*>(geometry_.get());
+    }
+    return NullValue;
+  }
+};
+
+// A task record over 2025 lasting up to four hours, with its start and end
+// as timestamp strings derived from its ordinal
+class TaskFeature : public FeatureSource {
+ private:
+  int64_t start_;
+  int64_t end_;
+
+ public:
+  explicit TaskFeature(uint64_t ordinal) {
+    static const int64_t year_begin =
+        TimeParser::DaysFromCivil(2025, 1, 1) * TimeParser::kDay;
+    std::mt19937_64 random(ordinal);
+    start_ = year_begin + static_cast<int64_t>(random() % (365 * 86400)) *
+                              TimeParser::kSecond;
+    end_ = start_ +
+           static_cast<int64_t>(random() % (4 * 3600)) * TimeParser::kSecond;
+  }
+
+  ValueT get_property(const std::string& property_path) const override {
+    if (property_path == "start") return TimeParser::Format(start_);
+    if (property_path == "end") return TimeParser::Format(end_);
+    return NullValue;
+  }
+};
+
+std::vector<Query> queries;
+Schema schema;
+
+// feature sets by size, built on first use and shared by benchmarks
+const std::vector<FeatureSourcePtr>& Features(size_t size) {
+  static std::map<size_t, std::vector<FeatureSourcePtr>> sets;
+  auto& features = sets[size];
+  if (not features.empty()) return features;
+  auto factory = geos::geom::GeometryFactory::create();
+  std::mt19937_64 random(size);
+  std::uniform_real_distribution<double> lon(-180.0, 180.0);
+  std::uniform_real_distribution<double> lat(-90.0, 90.0);
+  features.reserve(size);
+  for (size_t i = 0; i < size; i++) {
+    double x = lon(random), y = lat(random);
+    geos::geom::Envelope box(x, x + 0.01, y, y + 0.01);
+    features.emplace_back(std::make_shared<SyntheticFeature>(
+        &schema, i, factory->toGeometry(&box)));
+  }
+  return features;
+}
+
+const Cql2Cpp& Engine(size_t size) {
+  static std::map<size_t, std::unique_ptr<Cql2Cpp>> engines;
+  static std::ostringstream discard;
+  auto& engine = engines[size];
+  if (engine != nullptr) return *engine;
+  engine = std::make_unique<Cql2Cpp>(discard);
+  engine->RegisterFunctor(std::make_shared<FunctorAvg>());
+  engine->RegisterFunctor(std::make_shared<FunctorBuffer>());
+  engine->set_feature_source(Features(size));
+  return *engine;
+}
+
+void LoadQueries(const std::string& dir, const std::string& prefix) {
+  std::vector<fs::path> files;
+  for (const auto& entry : fs::directory_iterator(dir))
+    if (entry.path().extension() == ".txt") files.emplace_back(entry.path());
+  std::sort(files.begin(), files.end());
+  for (const auto& file : files) {
+    std::ifstream fin(file);
+    Query query{prefix + file.stem().string(),
+                std::string(std::istreambuf_iterator<char>(fin),
+                            std::istreambuf_iterator<char>()),
+                nullptr};
+    query.root = Cql2Cpp::ParseAsAst(query.text, nullptr);
+    if (query.root != nullptr) schema.Learn(query.root);
+    queries.emplace_back(std::move(query));
+  }
+}
+
+void BM_Parse(benchmark::State& state, const Query* query) {
+  for (auto _ : state)
+    benchmark::DoNotOptimize(Cql2Cpp::ParseAsAst(query->text, nullptr));
+}
+
+void BM_ConvertToSQL(benchmark::State& state, const Query* query) {
+  std::string sql, error_msg;
+  for (auto _ : state) {
+    sql.clear();
+    benchmark::DoNotOptimize(
+        Cql2Cpp::ConvertToSQL(query->text, &sql, &error_msg));
+  }
+}
+
+// every feature of a set, by one evaluator, without planning
+void BM_Evaluate(benchmark::State& state, const Query* query) {
+  const auto& features = Features(state.range(0));
+  Evaluator evaluator;
+  evaluator.RegisterFunctor(std::make_shared<FunctorAvg>());
+  evaluator.RegisterFunctor(std::make_shared<FunctorBuffer>());
+  size_t matches = 0;
+  ValueT value;
+  for (auto _ : state) {
+    matches = 0;
+    for (const auto& feature : features)
+      if (evaluator.Evaluate(query->root, feature.get(), &value) and
+          std::holds_alternative<bool>(value) and std::get<bool>(value))
+        matches++;
+  }
+  state.SetItemsProcessed(state.iterations() * features.size());
+  state.counters["matches"] = matches;
+}
+
+// parse, plan and match a set, as Cql2Cpp::filter does for a caller
+void BM_Filter(benchmark::State& state, const Query* query) {
+  const Cql2Cpp& engine = Engine(state.range(0));
+  SelectionSet result;
+  for (auto _ : state) {
+    if (not engine.filter(query->text, &result)) {
+      state.SkipWithError(engine.error_msg().c_str());
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * engine.size());
+  state.counters["matches"] = result.Count();
+}
+
+// The tasks of one day among a set, by a full scan parsing the times of
+// every feature, by a full scan of times parsed when the set was loaded, or
+// by an interval index
+enum TaskAccess { ParseTimes, ParsedTimes, IntervalIndex };
+
+void BM_Tasks(benchmark::State& state, TaskAccess access) {
+  static std::map<std::pair<TaskAccess, size_t>, std::unique_ptr<Cql2Cpp>>
+      engines;
+  static std::ostringstream discard;
+  size_t size = state.range(0);
+  auto& engine = engines[{access, size}];
+  if (engine == nullptr) {
+    std::vector<FeatureSourcePtr> tasks;
+    tasks.reserve(size);
+    for (size_t i = 0; i < size; i++)
+      tasks.emplace_back(std::make_shared<TaskFeature>(i));
+    engine = std::make_unique<Cql2Cpp>(discard);
+    if (access == ParsedTimes) {
+      engine->RegisterTime("start");
+      engine->RegisterTime("end");
+    }
+    if (access == IntervalIndex)
+      engine->RegisterIndex(std::make_shared<IndexInterval>("start", "end"));
+    engine->set_feature_source(tasks);
+  }
+
+  const std::string query =
+      "T_INTERSECTS(INTERVAL(start, end), "
+      "INTERVAL('2025-03-01T00:00:00Z', '2025-03-01T23:59:59Z'))";
+  SelectionSet result;
+  for (auto _ : state) {
+    if (not engine->filter(query, &result)) {
+      state.SkipWithError(engine->error_msg().c_str());
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * size);
+  state.counters["matches"] = result.Count();
+}
+
+}  // namespace
+
+// Write the results as JSON to cql2cpp_bench.json unless --benchmark_out
+// says otherwise, so runs can be compared with tools/compare.py of Google
+// Benchmark.
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  FLAGS_minloglevel = google::GLOG_FATAL;  // evaluation errors are expected
+
+  std::string test_dir = CQL2CPP_TEST_DIR;
+  LoadQueries(test_dir + "/supported/1.0/examples/text", "examples/");
+  LoadQueries(test_dir + "/indoorjson", "indoorjson/");
+  schema.Fill();
+
+  for (const auto& query : queries) {
+    benchmark::RegisterBenchmark(("BM_Parse/" + query.name).c_str(), BM_Parse,
+                                 &query);
+    if (query.root == nullptr) continue;
+    benchmark::RegisterBenchmark(("BM_ConvertToSQL/" + query.name).c_str(),
+                                 BM_ConvertToSQL, &query);
+    for (auto bm : {benchmark::RegisterBenchmark(
+                        ("BM_Evaluate/" + query.name).c_str(), BM_Evaluate,
+                        &query),
+                    benchmark::RegisterBenchmark(
+                        ("BM_Filter/" + query.name).c_str(), BM_Filter,
+                        &query)})
+      bm->Arg(1000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+  }
+
+  for (auto [name, access] :
+       {std::make_pair("BM_Tasks/parse_times", ParseTimes),
+        std::make_pair("BM_Tasks/parsed_times", ParsedTimes),
+        std::make_pair("BM_Tasks/interval_index", IntervalIndex)})
+    benchmark::RegisterBenchmark(name, BM_Tasks, access)
+        ->Arg(100000)
+        ->Arg(1000000)
+        ->Unit(benchmark::kMillisecond);
+
+  std::vector<char*> args(argv, argv + argc);
+  std::string out = "--benchmark_out=cql2cpp_bench.json";
+  std::string format = "--benchmark_out_format=json";
+  if (std::none_of(args.begin(), args.end(), [](const char* arg) {
+        return std::strncmp(arg, "--benchmark_out=", 16) == 0;
+      })) {
+    args.emplace_back(out.data());
+    args.emplace_back(format.data());
+  }
+  int size = args.size();
+  benchmark::Initialize(&size, args.data());
+  if (benchmark::ReportUnrecognizedArguments(size, args.data())) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
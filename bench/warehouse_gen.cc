@@ -0,0 +1,369 @@
+/*
+ * File Name: warehouse_gen.cc
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/02
+ *
+ */
+
+// Generate a synthetic indoor warehouse: bins on a grid of aisles and bays
+// on every floor, stacked in levels. Values follow skewed distributions so
+// that queries have realistic selectivities: a few labels and SKUs are
+// common and most are rare, most bins are occupied and nearly full. The
+// same arguments and seed give the same dataset with the same math library.
+// Values drawn through log, exp, cos and pow may differ in their last bits
+// with another one.
+
+#include <cql2cpp/flatgeobuf_writer.h>
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <argparse/argparse.hpp>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef CQL2CPP_VERSION
+#define CQL2CPP_VERSION "0.0.0"
+#endif
+
+namespace {
+
+constexpr double kBinDepth = 1.0;     // along x, meters
+constexpr double kBinWidth = 0.9;     // along y
+constexpr double kAisleWidth = 1.6;   // between two racks
+constexpr double kBayGap = 0.1;
+
+const std::vector<std::string> kLabels = {
+    "STORAGE", "PICKING",   "CONTAINER_BIN", "BULK",     "RETURNS",
+    "COLD",    "OVERSIZE",  "FRAGILE",       "HAZMAT",   "QUARANTINE"};
+
+// std distributions differ between standard libraries, these do not
+class Random {
+ private:
+  uint64_t state_;
+
+ public:
+  explicit Random(uint64_t seed) : state_(seed) {}
+
+  // splitmix64
+  uint64_t Next() {
+    uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  // in [0, 1)
+  double Uniform() { return (Next() >> 11) * 0x1.0p-53; }
+
+  bool Bernoulli(double p) { return Uniform() < p; }
+
+  double Exponential(double mean) { return -mean * std::log(1.0 - Uniform()); }
+
+  double Normal(double mean, double sigma) {
+    double u = 1.0 - Uniform();
+    return mean + sigma * std::sqrt(-2.0 * std::log(u)) *
+                      std::cos(2.0 * M_PI * Uniform());
+  }
+};
+
+// rank k in [0, n) with probability proportional to 1 / (k + 1)^s
+class Zipf {
+ private:
+  std::vector<double> cdf_;
+
+ public:
+  Zipf(size_t n, double s) {
+    double sum = 0.0;
+    for (size_t k = 0; k < n; k++) cdf_.push_back(sum += std::pow(k + 1, -s));
+    for (double& c : cdf_) c /= sum;
+  }
+
+  size_t operator()(Random* random) const {
+    auto it = std::upper_bound(cdf_.begin(), cdf_.end(), random->Uniform());
+    return std::min<size_t>(it - cdf_.begin(), cdf_.size() - 1);
+  }
+};
+
+struct Bin {
+  std::string id;
+  int64_t floor, aisle, bay, level;
+  double x, y;  // lower left corner
+  std::string zone;
+  std::vector<std::string> binlocations;
+  std::vector<std::string> labels;
+  bool occupied;
+  std::string sku;  // empty if not occupied
+  int64_t quantity;
+  double fill_level;  // 0 to 1
+  double weight;      // kg
+  int64_t status;     // 0 ok, 1 blocked, 2 maintenance, 3 reserved
+  int64_t priority;   // 1 highest to 5
+  double last_pick_age;  // seconds
+  double temperature;    // celsius
+};
+
+std::string Code(int64_t n, int width) {
+  std::ostringstream ss;
+  ss << std::setw(width) << std::setfill('0') << n;
+  return ss.str();
+}
+
+class Generator {
+ private:
+  int64_t floors_, aisles_, bays_, levels_;
+  Random random_;
+  Zipf label_rank_;
+  Zipf sku_rank_;
+  Zipf priority_rank_;
+
+ public:
+  Generator(int64_t floors, int64_t aisles, int64_t bays, int64_t levels,
+            uint64_t seed)
+      : floors_(floors),
+        aisles_(aisles),
+        bays_(bays),
+        levels_(levels),
+        random_(seed),
+        label_rank_(kLabels.size(), 1.2),
+        sku_rank_(std::max<int64_t>(floors * aisles * bays * levels / 4, 1),
+                  1.1),
+        priority_rank_(5, 1.5) {}
+
+  int64_t size() const { return floors_ * aisles_ * bays_ * levels_; }
+
+  template <typename F>
+  void ForEach(F f) {
+    Bin bin;
+    for (bin.floor = 0; bin.floor < floors_; bin.floor++)
+      for (bin.aisle = 0; bin.aisle < aisles_; bin.aisle++)
+        for (bin.bay = 0; bin.bay < bays_; bin.bay++)
+          for (bin.level = 0; bin.level < levels_; bin.level++) {
+            Fill(&bin);
+            f(bin);
+          }
+  }
+
+ private:
+  void Fill(Bin* bin) {
+    // racks face each other in pairs across an aisle
+    int64_t rack = bin->aisle;
+    bin->x = (rack / 2) * (2 * kBinDepth + kAisleWidth) +
+             (rack % 2) * (kBinDepth + kAisleWidth);
+    bin->y = bin->bay * (kBinWidth + kBayGap);
+
+    bin->zone = std::string(1, static_cast<char>('A' + (bin->aisle / 4) % 26));
+    std::string aisle = bin->zone + "-" + Code(bin->aisle, 2);
+    std::string bay = aisle + "-" + Code(bin->bay, 3);
+    std::string location = bay + "-" + Code(bin->level, 1);
+    bin->id = "F" + std::to_string(bin->floor) + "-" + location;
+    bin->binlocations = {aisle, bay, location};
+
+    // pickers reach the lowest levels, bulk is stored on the top
+    bin->labels.clear();
+    if (bin->level == 0 and random_.Bernoulli(0.8))
+      bin->labels.emplace_back("PICKING");
+    if (bin->level == levels_ - 1 and random_.Bernoulli(0.5))
+      bin->labels.emplace_back("BULK");
+    int64_t more = 1 + static_cast<int64_t>(random_.Uniform() * 2.0);
+    for (int64_t i = 0; i < more; i++) {
+      const std::string& label = kLabels.at(label_rank_(&random_));
+      if (std::find(bin->labels.begin(), bin->labels.end(), label) ==
+          bin->labels.end())
+        bin->labels.emplace_back(label);
+    }
+    bool cold = std::find(bin->labels.begin(), bin->labels.end(), "COLD") !=
+                bin->labels.end();
+
+    bin->occupied = random_.Bernoulli(0.85);
+    if (bin->occupied) {
+      bin->sku = "SKU-" + Code(sku_rank_(&random_), 7);
+      bin->fill_level = 1.0 - std::pow(random_.Uniform(), 3.0);
+      bin->quantity =
+          1 + static_cast<int64_t>(random_.Exponential(40.0) * bin->fill_level);
+      bin->weight = std::exp(random_.Normal(2.5, 1.0)) * bin->fill_level;
+    } else {
+      bin->sku.clear();
+      bin->fill_level = 0.0;
+      bin->quantity = 0;
+      bin->weight = 0.0;
+    }
+
+    double u = random_.Uniform();
+    bin->status = u < 0.90 ? 0 : u < 0.93 ? 1 : u < 0.95 ? 2 : 3;
+    bin->priority = 1 + priority_rank_(&random_);
+    // frequently picked bins were picked recently
+    bin->last_pick_age = random_.Exponential(bin->level == 0 ? 600 : 7200);
+    bin->temperature = cold ? random_.Normal(4.0, 1.0)
+                            : random_.Normal(20.0, 2.0);
+  }
+};
+
+std::string JsonArray(const std::vector<std::string>& strings) {
+  std::string json = "[";
+  for (size_t i = 0; i < strings.size(); i++)
+    json += (i > 0 ? ",\"" : "\"") + strings.at(i) + "\"";
+  return json + "]";
+}
+
+void WriteGeoJson(const Bin& bin, std::ostream& os) {
+  double x1 = bin.x + kBinDepth, y1 = bin.y + kBinWidth;
+  os << "{\"type\":\"Feature\",\"id\":\"" << bin.id << "\","
+     << "\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[[[" << bin.x
+     << "," << bin.y << "],[" << x1 << "," << bin.y << "],[" << x1 << ","
+     << y1 << "],[" << bin.x << "," << y1 << "],[" << bin.x << "," << bin.y
+     << "]]]},\"properties\":{"
+     << "\"id\":\"" << bin.id << "\",\"floor\":" << bin.floor
+     << ",\"aisle\":" << bin.aisle << ",\"bay\":" << bin.bay
+     << ",\"level\":" << bin.level << ",\"zone\":\"" << bin.zone << "\""
+     << ",\"binlocations\":" << JsonArray(bin.binlocations)
+     << ",\"labels\":" << JsonArray(bin.labels)
+     << ",\"occupied\":" << (bin.occupied ? "true" : "false");
+  if (bin.occupied) os << ",\"sku\":\"" << bin.sku << "\"";
+  os << ",\"quantity\":" << bin.quantity << ",\"fill_level\":"
+     << bin.fill_level << ",\"weight\":" << bin.weight
+     << ",\"status\":" << bin.status << ",\"priority\":" << bin.priority
+     << ",\"last_pick_age\":" << bin.last_pick_age
+     << ",\"temperature\":" << bin.temperature << "}}";
+}
+
+template <typename T>
+void Put(T value, std::string* wkb) {
+  wkb->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+std::string Wkb(const Bin& bin) {
+  double x1 = bin.x + kBinDepth, y1 = bin.y + kBinWidth;
+  std::string wkb;
+  Put<uint8_t>(1, &wkb);   // little endian
+  Put<uint32_t>(3, &wkb);  // Polygon
+  Put<uint32_t>(1, &wkb);
+  Put<uint32_t>(5, &wkb);
+  for (double v : {bin.x, bin.y, x1, bin.y, x1, y1, bin.x, y1, bin.x, bin.y})
+    Put<double>(v, &wkb);
+  return wkb;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  argparse::ArgumentParser program("warehouse_gen", CQL2CPP_VERSION);
+  program.add_description(
+      "generate bins of a synthetic warehouse for benchmarks and load tests");
+  program.add_argument("--floors").default_value(3).scan<'i', int>();
+  program.add_argument("--aisles").default_value(20).scan<'i', int>();
+  program.add_argument("--bays")
+      .help("bins along an aisle")
+      .default_value(50)
+      .scan<'i', int>();
+  program.add_argument("--levels")
+      .help("bins stacked in a bay")
+      .default_value(4)
+      .scan<'i', int>();
+  program.add_argument("--seed").default_value(1).scan<'i', int>();
+  program.add_argument("--format")
+      .help("geojson, ndjson or fgb")
+      .default_value(std::string("geojson"))
+      .choices("geojson", "ndjson", "fgb");
+  program.add_argument("--index-node-size")
+      .help("node size of the packed R-tree of fgb, 0 for no index")
+      .default_value(16)
+      .scan<'i', int>();
+  program.add_argument("-O", "--output")
+      .help("output file, - for stdout")
+      .default_value(std::string("-"));
+
+  try {
+    program.parse_args(argc, argv);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl << program;
+    return 1;
+  }
+
+  google::InitGoogleLogging(argv[0]);
+  google::LogToStderr();
+
+  std::ofstream fout;
+  std::string output = program.get<std::string>("--output");
+  if (output != "-") {
+    fout.open(output, std::ios::binary);
+    if (not fout.is_open()) {
+      LOG(ERROR) << "can not open " << output;
+      return 1;
+    }
+  }
+  std::ostream& os = output == "-" ? std::cout : fout;
+  os << std::setprecision(9);
+
+  Generator generator(program.get<int>("--floors"),
+                      program.get<int>("--aisles"), program.get<int>("--bays"),
+                      program.get<int>("--levels"), program.get<int>("--seed"));
+  std::string format = program.get<std::string>("--format");
+
+  if (format == "geojson" or format == "ndjson") {
+    bool collection = format == "geojson";
+    if (collection) os << "{\"type\":\"FeatureCollection\",\"features\":[\n";
+    bool first = true;
+    generator.ForEach([&](const Bin& bin) {
+      if (collection and not first) os << ",\n";
+      first = false;
+      WriteGeoJson(bin, os);
+      if (not collection) os << "\n";
+    });
+    if (collection) os << "\n]}\n";
+  } else {
+    using cql2cpp::FlatGeobufType;
+    cql2cpp::FlatGeobufWriter writer(
+        "bins", 3,
+        {{"id", FlatGeobufType::String},
+         {"floor", FlatGeobufType::Int},
+         {"aisle", FlatGeobufType::Int},
+         {"bay", FlatGeobufType::Int},
+         {"level", FlatGeobufType::Int},
+         {"zone", FlatGeobufType::String},
+         {"binlocations", FlatGeobufType::Json},
+         {"labels", FlatGeobufType::Json},
+         {"occupied", FlatGeobufType::Bool},
+         {"sku", FlatGeobufType::String},
+         {"quantity", FlatGeobufType::Int},
+         {"fill_level", FlatGeobufType::Double},
+         {"weight", FlatGeobufType::Double},
+         {"status", FlatGeobufType::Int},
+         {"priority", FlatGeobufType::Int},
+         {"last_pick_age", FlatGeobufType::Double},
+         {"temperature", FlatGeobufType::Double}},
+        program.get<int>("--index-node-size"));
+    bool added = true;
+    generator.ForEach([&](const Bin& bin) {
+      cql2cpp::ValueT sku = cql2cpp::NullValue;
+      if (bin.occupied) sku = bin.sku;
+      added = added and
+              writer.Add(Wkb(bin),
+                         {bin.id, bin.floor, bin.aisle, bin.bay, bin.level,
+                          bin.zone, JsonArray(bin.binlocations),
+                          JsonArray(bin.labels), bin.occupied, sku,
+                          bin.quantity, bin.fill_level, bin.weight, bin.status,
+                          bin.priority, bin.last_pick_age, bin.temperature});
+    });
+    if (not added or not writer.Write(os)) {
+      LOG(ERROR) << "write fgb error: " << writer.error_msg();
+      return 1;
+    }
+  }
+
+  os.flush();
+  if (not os.good()) {
+    LOG(ERROR) << "can not write " << output;
+    return 1;
+  }
+  LOG(INFO) << generator.size() << " bins written to " << output;
+  return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * File Name: array_columns.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/10
+ *
+ */
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "feature_source.h"
+
+namespace cql2cpp {
+
+// Array properties sorted and deduplicated, one per feature ordinal, when
+// features are loaded so that array predicates on these properties merge
+// them as they are instead of copying and sorting per evaluation. Values
+// which are not arrays are kept as none and left to the evaluator.
+class ArrayColumns {
+ private:
+  struct Column {
+    std::string property_path;
+    std::vector<std::optional<ArrayType>> values;
+  };
+
+  std::vector<Column> columns_;
+
+ public:
+  void Register(const std::string& property_path) {
+    columns_.push_back({property_path, {}});
+  }
+
+  bool empty() const { return columns_.empty(); }
+
+  void Clear() {
+    for (auto& column : columns_) column.values.clear();
+  }
+
+  // normalize the properties of the feature at ordinal
+  void Set(uint32_t ordinal, const FeatureSource& fs) {
+    for (auto& column : columns_) {
+      if (column.values.size() <= ordinal)
+        column.values.resize(ordinal + 1);
+      ValueT value = fs.get_property(column.property_path);
+      if (std::holds_alternative<ArrayType>(value)) {
+        column.values.at(ordinal) = std::move(std::get<ArrayType>(value));
+        NormalizeArray(&*column.values.at(ordinal));
+      } else {
+        column.values.at(ordinal).reset();
+      }
+    }
+  }
+
+  void Erase(uint32_t ordinal) {
+    for (auto& column : columns_)
+      if (ordinal < column.values.size()) column.values.at(ordinal).reset();
+  }
+
+  // nullptr if the property is not an array normalized so
+  const ArrayType* Get(uint32_t ordinal,
+                       const std::string& property_path) const {
+    for (const auto& column : columns_) {
+      if (column.property_path != property_path) continue;
+      if (ordinal >= column.values.size() or
+          not column.values.at(ordinal).has_value())
+        return nullptr;
+      return &*column.values.at(ordinal);
+    }
+    return nullptr;
+  }
+};
+
+}  // namespace cql2cpp
@@ -0,0 +1,131 @@
+/*
+ * File Name: ast_compiler.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/20
+ *
+ */
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+
+#include "ast_node.h"
+#include "like_matcher.h"
+#include "string_fold.h"
+#include "temporal.h"
+
+namespace cql2cpp {
+
+using NodeCompile =
+    std::function<bool(const AstNodePtr, std::string* error_msg)>;
+
+// Prepare a parsed AST for repeated evaluation. Work which does not depend on
+// the feature is done here once instead of in the evaluator for every
+// feature.
+class AstCompiler {
+ private:
+  std::map<NodeType, std::map<Operator, NodeCompile>> compilers_;
+  mutable std::string error_msg_;
+
+ public:
+  AstCompiler() {
+    // literal arrays are folded into one sorted and deduplicated array
+    compilers_[Array][NullOp] = [](auto n, auto errmsg) -> bool {
+      ArrayType array;
+      for (const auto& child : n->children()) {
+        if (not child->constant()) return true;
+        array.emplace_back(Element(child->origin_value()));
+      }
+      NormalizeArray(&array);
+      n->set_constant(array);
+      return true;
+    };
+
+    // CASEI and ACCENTI of literals are folded once
+    compilers_[CharacterClause][CaseI] = [](auto n, auto errmsg) -> bool {
+      return Fold(n, &StringFold::FoldCase, errmsg);
+    };
+    compilers_[CharacterClause][AccentI] = [](auto n, auto errmsg) -> bool {
+      return Fold(n, &StringFold::FoldAccents, errmsg);
+    };
+
+    // a literal pattern is compiled into a matcher for the evaluator
+    compilers_[IsLikePred][Like] = [](auto n, auto errmsg) -> bool {
+      std::string_view pattern;
+      if (n->children().size() == 2 and n->children().at(1)->constant() and
+          GetString(n->children().at(1)->origin_value(), &pattern))
+        n->set_compiled(std::make_shared<LikeMatcher>(pattern));
+      return true;
+    };
+    compilers_[IsLikePred][NotLike] = compilers_[IsLikePred][Like];
+
+    // dates, timestamps and intervals of literals are parsed once
+    for (auto op : {Timestamp, Date, Interval})
+      compilers_[TemporalInstance][op] = [](auto n, auto errmsg) -> bool {
+        std::vector<ValueT> vs;
+        for (const auto& child : n->children()) {
+          if (not child->constant()) return true;
+          vs.emplace_back(child->origin_value());
+        }
+        ValueT value;
+        if (not Temporal::Instance(n->op(), vs, &value, errmsg)) return false;
+        n->set_constant(value);
+        return true;
+      };
+  }
+
+  static bool Fold(const AstNodePtr& n, std::string (*fold)(std::string_view),
+                   std::string* error_msg) {
+    if (n->children().size() != 1 or not n->children().front()->constant())
+      return true;
+    const ValueT& value = n->children().front()->origin_value();
+    std::string_view s;
+    if (std::holds_alternative<NullStruct>(value)) {
+      n->set_constant(NullValue);
+      return true;
+    }
+    if (not GetString(value, &s)) {
+      *error_msg = "CASEI and ACCENTI need a string";
+      return false;
+    }
+    n->set_constant(fold(s));
+    return true;
+  }
+
+  void Register(
+      const std::map<NodeType, std::map<Operator, NodeCompile>> compilers) {
+    compilers_.insert(compilers.begin(), compilers.end());
+  }
+
+  bool Compile(const AstNodePtr& root) const {
+    for (const auto& child : root->children())
+      if (not Compile(child)) return false;
+
+    if (compilers_.find(root->type()) == compilers_.end() ||
+        compilers_.at(root->type()).find(root->op()) ==
+            compilers_.at(root->type()).end())
+      return true;
+
+    return compilers_.at(root->type()).at(root->op())(root, &error_msg_);
+  }
+
+  // the property paths a query reads
+  static std::set<std::string> PropertyPaths(const AstNodePtr& root) {
+    std::set<std::string> paths;
+    for (const auto& node : *root)
+      if (node->type() == PropertyName and
+          std::holds_alternative<std::string>(node->origin_value()))
+        paths.insert(std::get<std::string>(node->origin_value()));
+    return paths;
+  }
+
+  const std::string& error_msg() const { return error_msg_; }
+};
+
+}  // namespace cql2cpp
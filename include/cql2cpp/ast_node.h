@@ -27,6 +27,13 @@ namespace cql2cpp {
 class AstNode;
 using AstNodePtr = std::shared_ptr<AstNode>;
 
+// Feature independent state prepared by AstCompiler for the evaluator of a
+// node, e.g. the matcher of a LIKE pattern
+class CompiledState {
+ public:
+  virtual ~CompiledState() = default;
+};
+
 // Abstract Syntax Tree
 class AstNode : public std::enable_shared_from_this<AstNode> {
  private:
@@ -36,6 +43,8 @@ class AstNode : public std::enable_shared_from_this<AstNode> {
   std::vector<AstNodePtr> children_;
   ValueT origin_value_;
   mutable ValueT value_;
+  bool constant_ = false;
+  std::shared_ptr<const CompiledState> compiled_;
   static std::ostream* ous_;
 
  public:
@@ -50,7 +59,11 @@ class AstNode : public std::enable_shared_from_this<AstNode> {
   }
 
   AstNode(NodeType type, const ValueT& value)
-      : type_(type), op_(NullOp), origin_value_(value), value_(NullValue) {
+      : type_(type),
+        op_(NullOp),
+        origin_value_(value),
+        value_(NullValue),
+        constant_(type == Literal) {
     id_ = idg.Gen();
 #ifdef DEBUG
     LOG(INFO) << "AstNode " << ToString() << std::endl;
@@ -58,7 +71,11 @@ class AstNode : public std::enable_shared_from_this<AstNode> {
   }
 
   AstNode(const ValueT& value)
-      : type_(Literal), op_(NullOp), origin_value_(value), value_(NullValue) {
+      : type_(Literal),
+        op_(NullOp),
+        origin_value_(value),
+        value_(NullValue),
+        constant_(true) {
     id_ = idg.Gen();
 #ifdef DEBUG
     LOG(INFO) << "AstNode " << ToString() << std::endl;
@@ -78,6 +95,31 @@ class AstNode : public std::enable_shared_from_this<AstNode> {
   ValueT value() const { return value_; }
   void set_value(const ValueT& value) const { value_ = value; }
 
+  // the sub-tree does not depend on any feature. Its value is the origin
+  // value: either a literal or folded at compile time
+  bool constant() const { return constant_; }
+  void set_constant(const ValueT& value) {
+    origin_value_ = value;
+    constant_ = true;
+  }
+
+  // nullptr if nothing was compiled for the node
+  const CompiledState* compiled() const { return compiled_.get(); }
+  void set_compiled(std::shared_ptr<const CompiledState> compiled) {
+    compiled_ = std::move(compiled);
+  }
+
+  // A copy of the tree with the same ids, origin values and compiled state
+  // but none of the values of an evaluation, so the copy may be evaluated
+  // while the tree is. Compiled state is shared, being immutable.
+  AstNodePtr Clone() const {
+    auto clone = std::make_shared<AstNode>(*this);
+    clone->value_ = NullValue;
+    for (auto& child : clone->children_)
+      if (child) child = child->Clone();
+    return clone;
+  }
+
   std::string ToString() {
     if (op_ == NullOp)
       return id_ + " " + TypeName.at(type()) + " " +
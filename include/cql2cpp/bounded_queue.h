@@ -0,0 +1,60 @@
+/*
+ * File Name: bounded_queue.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/29
+ *
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace cql2cpp {
+
+// A queue between two threads. Push blocks while it is full, so a fast
+// producer can not run ahead of its consumer by more than the capacity.
+template <typename T>
+class BoundedQueue {
+ private:
+  std::deque<T> items_;
+  size_t capacity_;
+  bool closed_ = false;
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+
+ public:
+  BoundedQueue(size_t capacity) : capacity_(capacity > 0 ? capacity : 1) {}
+
+  void Push(T item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return items_.size() < capacity_; });
+    items_.emplace_back(std::move(item));
+    not_empty_.notify_one();
+  }
+
+  // false once the queue is closed and drained
+  bool Pop(T* item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return closed_ or not items_.empty(); });
+    if (items_.empty()) return false;
+    *item = std::move(items_.front());
+    items_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  // no more items will be pushed
+  void Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    not_empty_.notify_all();
+  }
+};
+
+}  // namespace cql2cpp
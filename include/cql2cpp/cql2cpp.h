@@ -10,17 +10,36 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <variant>
 #include <vector>
 
+#include "ast_compiler.h"
+#include "array_columns.h"
 #include "ast_node.h"
 #include "cql2_lexer.h"
 #include "cql2_parser_text.h"
 #include "evaluator.h"
 #include "feature_source.h"
+#include "feature_source_columns.h"
+#include "folded_columns.h"
 #include "global_yylex.h"
+#include "index/interval.h"
+#include "index/inverted.h"
+#include "index/range.h"
+#include "index/spatial.h"
+#include "metrics_sink.h"
+#include "query_cache.h"
+#include "query_planner.h"
+#include "selection_set.h"
 #include "sql_converter.h"
+#include "standing_query.h"
+#include "time_columns.h"
 #include "tree_dot.h"
 
 #ifndef CQL2CPP_VERSION
@@ -31,12 +50,207 @@ namespace cql2cpp {
 
 class Cql2Cpp {
  private:
-  std::vector<FeatureSourcePtr> features_;
+  std::vector<FeatureSourcePtr> features_;  // nullptr if erased
+  SelectionSet live_;                        // ordinals of features
+  std::vector<uint32_t> free_;               // erased ordinals to reuse
+  std::map<std::string, std::vector<IndexPtr>> indexes_;
+  FoldedColumns folded_;
+  TimeColumns times_;
+  ArrayColumns arrays_;
+  StandingQueries standing_;
   std::ostream& ostr_;
   Evaluator evaluator_;
+  EvaluationProfile* profile_ = nullptr;
+  MetricsSink* metrics_ = MetricsSink::Noop();
 
   mutable std::string error_msg_;
 
+  void BuildIndexes() {
+    for (auto& [property_path, indexes] : indexes_) {
+      for (auto& index : indexes) {
+        index->Clear();
+        for (size_t i = 0; i < features_.size(); i++)
+          index->Insert(i, *features_.at(i));
+        index->Commit();
+      }
+    }
+  }
+
+  // fold, parse and normalize the registered properties of every feature
+  void FillColumns() {
+    folded_.Clear();
+    times_.Clear();
+    arrays_.Clear();
+    if (folded_.empty() and times_.empty() and arrays_.empty()) return;
+    for (size_t i = 0; i < features_.size(); i++) FillColumns(i);
+  }
+
+  void FillColumns(uint32_t ordinal) {
+    folded_.Set(ordinal, *features_.at(ordinal));
+    times_.Set(ordinal, *features_.at(ordinal));
+    arrays_.Set(ordinal, *features_.at(ordinal));
+  }
+
+  void IndexFeature(uint32_t ordinal) {
+    FillColumns(ordinal);
+    for (auto& [property_path, indexes] : indexes_) {
+      for (auto& index : indexes) {
+        index->Insert(ordinal, *features_.at(ordinal));
+        index->Commit();
+      }
+    }
+  }
+
+  // true if the index reads any of the changed paths
+  static bool Reads(const Index& index,
+                    const std::vector<std::string>& changed_paths) {
+    for (const auto& path : index.property_paths())
+      for (const auto& changed : changed_paths)
+        if (StandingQueries::Overlap(changed, path)) return true;
+    return false;
+  }
+
+  bool Exists(uint32_t ordinal) const {
+    if (ordinal < features_.size() and features_.at(ordinal) != nullptr)
+      return true;
+    error_msg_ = "no feature at ordinal " + std::to_string(ordinal);
+    return false;
+  }
+
+  // Parse, timed and counted by the metrics sink, a hit of the query cache
+  // as such
+  bool Compile(const std::string& cql2_query, AstNodePtr* root,
+               std::string* error_msg) const {
+    auto start = std::chrono::steady_clock::now();
+    bool cached;
+    bool ret = Parse(cql2_query, root, error_msg, &cached);
+    metrics_->Record(MetricsSink::CompileLatency,
+                     std::chrono::steady_clock::now() - start);
+    if (ret)
+      metrics_->Add(cached ? MetricsSink::CompileCacheHits
+                           : MetricsSink::QueriesCompiled,
+                    1);
+    return ret;
+  }
+
+  // Parse the query and choose the access paths. Residual conjuncts must be
+  // matched on each candidate.
+  bool Plan(const std::string& cql2_query, QueryPlan* plan) const {
+    AstNodePtr root;
+    if (not Compile(cql2_query, &root, &error_msg_)) return false;
+
+    QueryPlanner(indexes_).Plan(root, live_, plan);
+    metrics_->Add(plan->accesses.empty() ? MetricsSink::FullScans
+                                         : MetricsSink::IndexPlans,
+                  1);
+    return true;
+  }
+
+  // count the features a plan evaluated and returned
+  void Report(size_t evaluated, size_t matches) const {
+    if (evaluated > 0) metrics_->Add(MetricsSink::FeaturesEvaluated, evaluated);
+    metrics_->Add(MetricsSink::Matches, matches);
+  }
+
+  // Decide residual BETWEEN and IS NULL conjuncts of a property for all
+  // candidates at once, typed and without the evaluator, leaving the others
+  // to Match. Not while profiling, as the profile records what the evaluator
+  // does. The number of candidates the residual is evaluated on.
+  size_t Sieve(QueryPlan* plan) const {
+    if (plan->residual.empty()) return 0;
+    size_t evaluated = plan->candidates.Count();
+    if (profile_ != nullptr) return evaluated;
+    std::vector<AstNodePtr> residual;
+    for (const auto& conjunct : plan->residual) {
+      size_t nulls = 0, errors = 0;
+      if (not EvaluatorBetween::Batch(conjunct, features_, &plan->candidates,
+                                      &nulls, &errors) and
+          not EvaluatorNull::Batch(conjunct, features_, &plan->candidates)) {
+        residual.emplace_back(conjunct);
+        continue;
+      }
+      if (nulls > 0) metrics_->Add(MetricsSink::ResultTypeErrors, nulls);
+      if (errors > 0) {
+        LOG(ERROR) << "evaluation error: BETWEEN needs numbers on " << errors
+                   << " features";
+        metrics_->Add(MetricsSink::EvaluationErrors, errors);
+      }
+    }
+    plan->residual = std::move(residual);
+    return evaluated;
+  }
+
+  // the features matching a plan
+  void Select(QueryPlan* plan, SelectionSet* result) const {
+    size_t evaluated = Sieve(plan);
+    if (plan->residual.empty()) {
+      *result = std::move(plan->candidates);
+      Report(evaluated, result->Count());
+      return;
+    }
+    result->Clear();
+    plan->candidates.ForEach([&](uint32_t i) {
+      if (Match(plan->residual, i)) result->Add(i);
+    });
+    Report(evaluated, result->Count());
+  }
+
+  // evaluate a standing query on one feature and record a transition if
+  // the feature entered or left its result
+  void Reevaluate(uint32_t id, StandingQuery* query, uint32_t ordinal,
+                  std::vector<Transition>* transitions) const {
+    bool match = features_.at(ordinal) != nullptr and
+                 Match({query->root}, ordinal);
+    if (match == query->result.Contains(ordinal)) return;
+    if (match)
+      query->result.Add(ordinal);
+    else
+      query->result.Remove(ordinal);
+    if (transitions != nullptr) transitions->push_back({id, ordinal, match});
+  }
+
+  void ReevaluateAll(uint32_t ordinal, std::vector<Transition>* transitions) {
+    for (auto& [id, query] : standing_.queries())
+      Reevaluate(id, &query, ordinal, transitions);
+  }
+
+  // recompute the results of standing queries after features are replaced
+  void Reselect() {
+    for (auto& [id, query] : standing_.queries()) {
+      QueryPlan plan;
+      QueryPlanner(indexes_).Plan(query.root, live_, &plan);
+      Select(&plan, &query.result);
+    }
+  }
+
+  // Match the feature at ordinal, with its folded and time columns
+  bool Match(const std::vector<AstNodePtr>& conjuncts, uint32_t ordinal) const {
+    const FeatureSource* fs = features_.at(ordinal).get();
+    if (folded_.empty() and times_.empty() and arrays_.empty())
+      return Match(conjuncts, fs);
+    FeatureSourceColumns columns(*fs, folded_, times_, arrays_, ordinal);
+    return Match(conjuncts, &columns);
+  }
+
+  // true if all conjuncts evaluate to true
+  bool Match(const std::vector<AstNodePtr>& conjuncts,
+             const FeatureSource* fs) const {
+    ValueT value;
+    for (const auto& conjunct : conjuncts) {
+      if (not evaluator_.Evaluate(conjunct, fs, &value)) {
+        LOG(ERROR) << "evaluation error: " << evaluator_.error_msg();
+        return false;
+      }
+      if (not std::holds_alternative<bool>(value)) {
+        LOG(ERROR) << "evaluation result type error";
+        metrics_->Add(MetricsSink::ResultTypeErrors, 1);
+        return false;
+      }
+      if (not std::get<bool>(value)) return false;
+    }
+    return true;
+  }
+
  public:
   Cql2Cpp() : ostr_(std::cout) {}
 
@@ -44,37 +258,248 @@ class Cql2Cpp {
 
   void set_feature_source(const std::vector<FeatureSourcePtr> feature_source) {
     features_ = feature_source;
+    live_ = SelectionSet::All(features_.size());
+    free_.clear();
+    BuildIndexes();
+    FillColumns();
+    Reselect();
+  }
+
+  void clear() {
+    features_.clear();
+    live_.Clear();
+    free_.clear();
+    folded_.Clear();
+    times_.Clear();
+    arrays_.Clear();
+    for (auto& [property_path, indexes] : indexes_)
+      for (auto& index : indexes) index->Clear();
+    for (auto& [id, query] : standing_.queries()) query.result.Clear();
+  }
+
+  // Insert, Update and Erase keep the indexes and the results of standing
+  // queries up to date. Ordinals of features never change, erased ordinals
+  // are reused by Insert.
+  uint32_t Insert(const FeatureSourcePtr feature,
+                  std::vector<Transition>* transitions = nullptr) {
+    uint32_t ordinal;
+    if (free_.empty()) {
+      ordinal = features_.size();
+      features_.emplace_back(feature);
+    } else {
+      ordinal = free_.back();
+      free_.pop_back();
+      features_.at(ordinal) = feature;
+    }
+    live_.Add(ordinal);
+    IndexFeature(ordinal);
+    ReevaluateAll(ordinal, transitions);
+    return ordinal;
   }
 
-  void clear() { features_.clear(); }
+  // the feature may be the one at ordinal, changed in place
+  bool Update(uint32_t ordinal, const FeatureSourcePtr feature,
+              std::vector<Transition>* transitions = nullptr) {
+    if (not Exists(ordinal)) return false;
+    features_.at(ordinal) = feature;
+    IndexFeature(ordinal);
+    ReevaluateAll(ordinal, transitions);
+    return true;
+  }
+
+  bool Erase(uint32_t ordinal,
+             std::vector<Transition>* transitions = nullptr) {
+    if (not Exists(ordinal)) return false;
+    for (auto& [property_path, indexes] : indexes_) {
+      for (auto& index : indexes) {
+        index->Erase(ordinal);
+        index->Commit();
+      }
+    }
+    features_.at(ordinal) = nullptr;
+    folded_.Erase(ordinal);
+    times_.Erase(ordinal);
+    arrays_.Erase(ordinal);
+    live_.Remove(ordinal);
+    free_.emplace_back(ordinal);
+    ReevaluateAll(ordinal, transitions);
+    return true;
+  }
+
+  // The properties at changed_paths of the feature at ordinal were changed
+  // in place. Only indexes on these paths are updated and only standing
+  // queries reading them are evaluated, on this feature alone.
+  bool Notify(uint32_t ordinal, const std::vector<std::string>& changed_paths,
+              std::vector<Transition>* transitions = nullptr) {
+    if (not Exists(ordinal)) return false;
+    FillColumns(ordinal);
+    for (auto& [property_path, indexes] : indexes_) {
+      for (auto& index : indexes) {
+        if (not Reads(*index, changed_paths)) continue;
+        index->Insert(ordinal, *features_.at(ordinal));
+        index->Commit();
+      }
+    }
+    for (uint32_t id : standing_.Readers(changed_paths))
+      Reevaluate(id, standing_.Get(id), ordinal, transitions);
+    return true;
+  }
+
+  // Register a query whose result is kept up to date, see Notify
+  bool Subscribe(const std::string& cql2_query, uint32_t* id) {
+    AstNodePtr root;
+    if (not Compile(cql2_query, &root, &error_msg_)) return false;
+
+    QueryPlan plan;
+    QueryPlanner(indexes_).Plan(root, live_, &plan);
+    StandingQuery query{root, AstCompiler::PropertyPaths(root), {}};
+    Select(&plan, &query.result);
+    *id = standing_.Add(std::move(query));
+    return true;
+  }
+
+  bool Unsubscribe(uint32_t id) {
+    if (standing_.Remove(id)) return true;
+    error_msg_ = "no standing query " + std::to_string(id);
+    return false;
+  }
+
+  // the current result of a standing query, nullptr if there is none
+  const SelectionSet* subscription(uint32_t id) const {
+    const StandingQuery* query = standing_.Get(id);
+    return query == nullptr ? nullptr : &query->result;
+  }
+
+  // number of features
+  size_t size() const { return live_.Count(); }
 
   void RegisterFunctor(const FunctorPtr functor) {
     evaluator_.RegisterFunctor(functor);
   }
 
+  // Profile the nodes of every query evaluated, see Evaluator::set_profile.
+  // The dot of Evaluate is a heat map of it.
+  void set_profile(EvaluationProfile* profile) {
+    profile_ = profile;
+    evaluator_.set_profile(profile);
+  }
+
+  // Report compilations, plans, evaluations and latencies to a sink which
+  // must outlive this, nullptr for none. See MetricsSink.
+  void set_metrics_sink(MetricsSink* metrics) {
+    metrics_ = metrics == nullptr ? MetricsSink::Noop() : metrics;
+    evaluator_.set_metrics_sink(metrics);
+  }
+
+  // Indexes are built from the feature source and used by filter to skip
+  // features. Register them before set_feature_source.
+  void RegisterIndex(const IndexPtr index) {
+    indexes_[index->property_path()].emplace_back(index);
+  }
+
+  // Fold a string property once per feature for CASEI and ACCENTI, folding
+  // being a combination of StringFold::Folding, e.g. CASEI(ACCENTI(name))
+  // needs both. Register them before set_feature_source.
+  void RegisterFolding(const std::string& property_path, int folding) {
+    folded_.Register(property_path, folding);
+  }
+
+  // Parse a date or timestamp property once per feature for temporal
+  // predicates, which then compare integers. Register them before
+  // set_feature_source.
+  void RegisterTime(const std::string& property_path) {
+    times_.Register(property_path);
+  }
+
+  // Sort and deduplicate an array property once per feature for array
+  // predicates, which then merge it as it is. Register them before
+  // set_feature_source.
+  void RegisterArray(const std::string& property_path) {
+    arrays_.Register(property_path);
+  }
+
+  // nullptr if the feature at ordinal was erased
+  const FeatureSourcePtr& feature(uint32_t ordinal) const {
+    return features_.at(ordinal);
+  }
+
   bool filter(const std::string& cql2_query,
               std::vector<FeatureSourcePtr>* result) const {
-    // Parse
-    AstNodePtr root;
-    if (not Parse(cql2_query, &root, &error_msg_)) return false;
+    return for_each(cql2_query, [&](uint32_t ordinal, const FeatureSource&) {
+      result->emplace_back(features_.at(ordinal));
+    });
+  }
 
-    // Prepare evaluator
-    ValueT value;
+  // ordinals of the matching features in the feature source
+  bool filter(const std::string& cql2_query, SelectionSet* result) const {
+    auto start = std::chrono::steady_clock::now();
+    QueryPlan plan;
+    if (not Plan(cql2_query, &plan)) return false;
+    Select(&plan, result);
+    metrics_->Record(MetricsSink::FilterLatency,
+                     std::chrono::steady_clock::now() - start);
+    return true;
+  }
 
-    // Loop over all features
-    for (const auto& f : features_) {
-      if (evaluator_.Evaluate(root, f.get(), &value)) {
-        if (std::holds_alternative<bool>(value)) {
-          if (std::get<bool>(value)) result->emplace_back(f);
-        } else {
-          LOG(ERROR) << "evaluation result type error";
-        }
-      } else {
-        LOG(ERROR) << "evaluation error: " << evaluator_.error_msg();
-      }
+  // number of matching features, without collecting them if the query is
+  // answered by indexes only
+  bool count(const std::string& cql2_query, size_t* count) const {
+    auto start = std::chrono::steady_clock::now();
+    QueryPlan plan;
+    if (not Plan(cql2_query, &plan)) return false;
+    size_t evaluated = Sieve(&plan);
+    const auto& residual = plan.residual;
+    if (residual.empty()) {
+      *count = plan.candidates.Count();
+    } else {
+      *count = 0;
+      plan.candidates.ForEach([&](uint32_t i) {
+        if (Match(residual, i)) (*count)++;
+      });
     }
+    Report(evaluated, *count);
+    metrics_->Record(MetricsSink::FilterLatency,
+                     std::chrono::steady_clock::now() - start);
+    return true;
+  }
+
+  // call f with every matching feature in the order of the feature source
+  bool for_each(
+      const std::string& cql2_query,
+      const std::function<void(uint32_t ordinal, const FeatureSource&)>& f)
+      const {
+    auto start = std::chrono::steady_clock::now();
+    QueryPlan plan;
+    if (not Plan(cql2_query, &plan)) return false;
+    size_t evaluated = Sieve(&plan);
+    const auto& residual = plan.residual;
+    size_t matches = 0;
+    plan.candidates.ForEach([&](uint32_t i) {
+      if (not Match(residual, i)) return;
+      matches++;
+      f(i, *features_.at(i));
+    });
+    Report(evaluated, matches);
+    metrics_->Record(MetricsSink::FilterLatency,
+                     std::chrono::steady_clock::now() - start);
+    return true;
+  }
 
-    return result;
+  // Match one feature against a query parsed once by ParseAsAst, for
+  // features which are not kept in memory like those of a stream
+  bool Matches(const AstNodePtr& root, const FeatureSource& fs) const {
+    metrics_->Add(MetricsSink::FeaturesEvaluated, 1);
+    if (not Match({root}, &fs)) return false;
+    metrics_->Add(MetricsSink::Matches, 1);
+    return true;
+  }
+
+  // the access paths filter would use for the query
+  bool Explain(const std::string& cql2_query, std::string* explain) const {
+    QueryPlan plan;
+    if (not Plan(cql2_query, &plan)) return false;
+    *explain = plan.Explain();
+    return true;
   }
 
   const std::string error_msg() const { return error_msg_; }
@@ -83,7 +508,7 @@ class Cql2Cpp {
                 bool* result, std::string* error_msg, std::string* dot) {
     // Parse
     AstNodePtr root;
-    if (not Parse(cql2_query, &root, error_msg)) return false;
+    if (not Compile(cql2_query, &root, error_msg)) return false;
 
     // Evaluate
     ValueT value;
@@ -92,7 +517,7 @@ class Cql2Cpp {
       *result = std::get<bool>(value);
       if (dot != nullptr) {
         std::stringstream ss;
-        Tree2Dot::GenerateDot(ss, root, cql2_query);
+        Tree2Dot::GenerateDot(ss, root, cql2_query, profile_);
         *dot = ss.str();
       }
       return true;
@@ -135,6 +560,34 @@ class Cql2Cpp {
     return converter.Convert(root, sql_where);
   }
 
+  // the WHERE clause with placeholders ?N for the literals, which are
+  // appended to parameters
+  static bool ConvertToSQL(
+      const std::string& cql2_query,
+      const std::map<std::string, std::string>& queryable_column,
+      std::string* sql_where, std::vector<SqlParameter>* parameters,
+      std::string* error_msg) {
+    AstNodePtr root;
+    if (not Parse(cql2_query, &root, error_msg)) return false;
+
+    SqlConverter converter(queryable_column);
+    converter.set_parameters(parameters);
+    if (converter.Convert(root, sql_where)) return true;
+    if (error_msg != nullptr) *error_msg = converter.error_msg();
+    return false;
+  }
+
+  // Cache compiled queries by their normalised text, for the parsing of
+  // every Cql2Cpp and of the static functions like ConvertToSQL as the
+  // lexer is global. nullptr, the default, to parse every query.
+  static void set_query_cache(const std::shared_ptr<QueryCache>& cache) {
+    std::atomic_store(&Cache(), cache);
+  }
+
+  static std::shared_ptr<QueryCache> query_cache() {
+    return std::atomic_load(&Cache());
+  }
+
   static AstNodePtr ParseAsAst(const std::string& cql2_query,
                                std::string* error_msg) {
     AstNodePtr root;
@@ -143,8 +596,30 @@ class Cql2Cpp {
   }
 
  private:
+  static std::shared_ptr<QueryCache>& Cache() {
+    static std::shared_ptr<QueryCache> cache;
+    return cache;
+  }
+
+  // cached is set if the query cache had the query
   static bool Parse(const std::string& cql2_query, AstNodePtr* root,
-                    std::string* error_msg) {
+                    std::string* error_msg, bool* cached = nullptr) {
+    std::shared_ptr<QueryCache> cache = query_cache();
+    std::string key;
+    if (cached != nullptr) *cached = false;
+    if (cache != nullptr) {
+      key = QueryCache::Normalize(cql2_query);
+      if (cache->Get(key, root)) {
+        if (error_msg != nullptr) error_msg->clear();
+        if (cached != nullptr) *cached = true;
+        return true;
+      }
+    }
+
+    // the lexer and the output of the parser are global
+    static std::mutex mutex;
+    std::lock_guard<std::mutex> lock(mutex);
+
     std::istringstream iss(cql2_query);
     std::ostringstream oss;
 
@@ -155,12 +630,16 @@ class Cql2Cpp {
     Cql2ParserText parser;
     int ret = parser.parse();
     if (error_msg != nullptr) *error_msg = oss.str();
-    if (ret == 0) {
-      *root = parser.root();
-      return true;
-    } else {
+    if (ret != 0) return false;
+
+    static const AstCompiler compiler;
+    if (not compiler.Compile(parser.root())) {
+      if (error_msg != nullptr) *error_msg = compiler.error_msg();
       return false;
     }
+    *root = parser.root();
+    if (cache != nullptr) cache->Put(key, *root);
+    return true;
   }
 };
 
@@ -0,0 +1,215 @@
+/*
+ * File Name: db_filter.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/01
+ *
+ */
+
+#pragma once
+
+#include <glog/logging.h>
+#include <sqlite3.h>
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ast_node.h"
+#include "evaluator.h"
+#include "feature_source_db.h"
+#include "metrics_sink.h"
+#include "query_planner.h"
+#include "sql_converter.h"
+#include "sql_statement_cache.h"
+
+namespace cql2cpp {
+
+// Filter the rows of a SQLite or SpatiaLite table by a query. The top level
+// conjuncts SqlConverter can convert are pushed down into the WHERE clause
+// of one statement. The others, e.g. calls of functors, are residual and
+// evaluated on the rows as SQLite returns them, which select only the
+// columns the residual reads. Functions are residual unless registered as
+// SQL functions. LIKE is residual too, as SQLite's LIKE ignores the case of
+// ASCII letters and has no escape character by default. Literals are bound
+// as parameters, so the statements of queries differing only in literals
+// are prepared once and cached.
+class DbFilter {
+ private:
+  sqlite3* db_;
+  std::string table_;
+  std::map<std::string, std::string> queryable_column_;
+  std::set<std::string> geometry_properties_ = {"geom"};
+  std::set<std::string> sql_functions_;
+  SqlDialect dialect_ = SqlDialect::SQLite;
+  Evaluator evaluator_;
+  SqlStatementCache statements_;
+  MetricsSink* metrics_ = MetricsSink::Noop();
+
+  std::string sql_;
+  std::vector<SqlParameter> parameters_;
+  std::vector<AstNodePtr> residual_;
+  size_t rows_ = 0;
+  std::string error_msg_;
+
+  std::string Column(const std::string& property) const {
+    auto it = queryable_column_.find(property);
+    return SqlConverter::QuoteIdentifier(
+        it == queryable_column_.end() ? property : it->second);
+  }
+
+  bool Pushdown(const AstNodePtr& conjunct, std::string* sql) {
+    for (const auto& node : *conjunct) {
+      if (node->type() == IsLikePred) return false;
+      if (node->type() != Function or node->children().empty()) continue;
+      const ValueT& name = node->children().front()->origin_value();
+      if (not std::holds_alternative<std::string>(name) or
+          sql_functions_.count(std::get<std::string>(name)) == 0)
+        return false;
+    }
+    size_t bound = parameters_.size();
+    SqlConverter converter(queryable_column_);
+    converter.set_parameters(&parameters_);
+    converter.set_dialect(dialect_, table_);
+    if (converter.Convert(conjunct, sql)) return true;
+    parameters_.resize(bound);
+    return false;
+  }
+
+  bool Match(const FeatureSource& fs) const {
+    ValueT value;
+    for (const auto& conjunct : residual_) {
+      if (not evaluator_.Evaluate(conjunct, &fs, &value)) {
+        LOG(ERROR) << "evaluation error: " << evaluator_.error_msg();
+        return false;
+      }
+      if (not std::holds_alternative<bool>(value) or not std::get<bool>(value))
+        return false;
+    }
+    return true;
+  }
+
+ public:
+  // queryable_column maps property names to column names like SqlConverter
+  DbFilter(sqlite3* db, const std::string& table,
+           const std::map<std::string, std::string>& queryable_column = {},
+           size_t statement_capacity = 16)
+      : db_(db),
+        table_(table),
+        queryable_column_(queryable_column),
+        statements_(db, statement_capacity) {}
+
+  // properties whose columns are SpatiaLite geometries, read by the
+  // residual as WKB
+  void set_geometry_properties(const std::set<std::string>& properties) {
+    geometry_properties_ = properties;
+  }
+
+  // SpatiaLite to look up spatial predicates from the SpatialIndex, which
+  // needs CreateSpatialIndex on the geometry columns
+  void set_dialect(SqlDialect dialect) { dialect_ = dialect; }
+
+  // a function the database evaluates, so conjuncts calling it are pushed
+  // down instead of evaluated by a functor
+  void RegisterSqlFunction(const std::string& name) {
+    sql_functions_.insert(name);
+  }
+
+  void RegisterFunctor(const FunctorPtr functor) {
+    evaluator_.RegisterFunctor(functor);
+  }
+
+  // Report filters like Cql2Cpp, a query with a WHERE clause as an index
+  // plan, nullptr for none
+  void set_metrics_sink(MetricsSink* metrics) {
+    metrics_ = metrics == nullptr ? MetricsSink::Noop() : metrics;
+    evaluator_.set_metrics_sink(metrics);
+  }
+
+  // Call f for every row matching a query parsed by ParseAsAst, with its
+  // rowid and the columns the residual reads.
+  bool Filter(const AstNodePtr& root,
+              const std::function<void(int64_t, const FeatureSource&)>& f) {
+    auto start = std::chrono::steady_clock::now();
+    error_msg_.clear();
+    rows_ = 0;
+    residual_.clear();
+    parameters_.clear();
+
+    std::vector<AstNodePtr> conjuncts;
+    QueryPlanner::Conjuncts(root, &conjuncts);
+    std::string where;
+    for (const auto& conjunct : conjuncts) {
+      std::string sql;
+      if (not Pushdown(conjunct, &sql)) {
+        residual_.emplace_back(conjunct);
+        continue;
+      }
+      if (not where.empty()) where += " AND ";
+      where += "(" + sql + ")";
+    }
+
+    std::set<std::string> read;
+    for (const auto& conjunct : residual_)
+      for (const auto& node : *conjunct)
+        if (node->type() == PropertyName and
+            std::holds_alternative<std::string>(node->origin_value()))
+          read.insert(std::get<std::string>(node->origin_value()));
+    auto properties = std::make_shared<std::vector<std::string>>(read.begin(),
+                                                                 read.end());
+    std::vector<bool> is_geometry;
+    sql_ = "SELECT rowid";
+    for (const auto& property : *properties) {
+      is_geometry.emplace_back(geometry_properties_.count(property) > 0);
+      sql_ += is_geometry.back() ? ", ST_AsBinary(" + Column(property) + ")"
+                                 : ", " + Column(property);
+    }
+    sql_ += " FROM " + SqlConverter::QuoteIdentifier(table_);
+    if (not where.empty()) sql_ += " WHERE " + where;
+
+    sqlite3_stmt* stmt = statements_.Prepare(sql_, parameters_, &error_msg_);
+    if (stmt == nullptr) return false;
+    int rc;
+    size_t matches = 0;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+      rows_++;
+      FeatureSourceDB row(stmt, 1, properties, is_geometry);
+      if (not Match(row)) continue;
+      matches++;
+      f(sqlite3_column_int64(stmt, 0), row);
+    }
+    if (rc != SQLITE_DONE) error_msg_ = sqlite3_errmsg(db_);
+    sqlite3_reset(stmt);
+    metrics_->Add(where.empty() ? MetricsSink::FullScans
+                                : MetricsSink::IndexPlans,
+                  1);
+    if (not residual_.empty())
+      metrics_->Add(MetricsSink::FeaturesEvaluated, rows_);
+    metrics_->Add(MetricsSink::Matches, matches);
+    metrics_->Record(MetricsSink::FilterLatency,
+                     std::chrono::steady_clock::now() - start);
+    return rc == SQLITE_DONE;
+  }
+
+  // the statement of the last Filter and the values of its placeholders
+  const std::string& sql() const { return sql_; }
+  const std::vector<SqlParameter>& parameters() const { return parameters_; }
+
+  const SqlStatementCache& statements() const { return statements_; }
+
+  // the conjuncts the last Filter evaluated on the rows
+  const std::vector<AstNodePtr>& residual() const { return residual_; }
+
+  // the rows SQLite returned to the last Filter
+  size_t rows() const { return rows_; }
+
+  const std::string& error_msg() const { return error_msg_; }
+};
+
+}  // namespace cql2cpp
@@ -10,39 +10,60 @@
 
 #pragma once
 
+#include <chrono>
 #include <map>
 
 #include "ast_node.h"
 #include "evaluator/array.h"
 #include "evaluator/ast_node.h"
+#include "evaluator/between.h"
 #include "evaluator/bool.h"
 #include "evaluator/compare.h"
 #include "evaluator/function.h"
 #include "evaluator/in.h"
+#include "evaluator/like.h"
 #include "evaluator/literal.h"
+#include "evaluator/null.h"
 #include "evaluator/property.h"
 #include "evaluator/spatial.h"
+#include "evaluator/temporal.h"
 #include "feature_source.h"
 #include "functor.h"
 #include "functor_avg.h"
 #include "functor_buffer.h"
 #include "functor_related_bins.h"
+#include "lazy_geometry.h"
+#include "metrics_sink.h"
+#include "node_profile.h"
 
 namespace cql2cpp {
 
 class Evaluator {
  private:
   std::map<NodeType, std::map<Operator, NodeEval>> type_evaluator_;
+  std::map<NodeType, std::map<Operator, NodeShortcut>> type_shortcut_;
   EvaluatorFunction eval_func;
+  EvaluationProfile* profile_ = nullptr;
+  MetricsSink* metrics_ = MetricsSink::Noop();
   mutable std::string error_msg_;
 
  public:
   Evaluator() {
     Register(EvaluatorBool().GetEvaluators());
     Register(EvaluatorCompare().GetEvaluators());
+    Register(EvaluatorBetween().GetEvaluators());
+    RegisterShortcuts(EvaluatorBetween().GetShortcuts());
+    Register(EvaluatorNull().GetEvaluators());
+    RegisterShortcuts(EvaluatorNull().GetShortcuts());
     Register(EvaluatorSpatial().GetEvaluators());
+    RegisterShortcuts(EvaluatorSpatial().GetShortcuts());
+    Register(EvaluatorTemporal().GetEvaluators());
+    RegisterShortcuts(EvaluatorTemporal().GetShortcuts());
     Register(EvaluatorArray().GetEvaluators());
+    RegisterShortcuts(EvaluatorArray().GetShortcuts());
     Register(EvaluatorIn().GetEvaluators());
+    Register(EvaluatorLike().GetEvaluators());
+    RegisterShortcuts(EvaluatorLike().GetShortcuts());
     Register(EvaluatorLiteral().GetEvaluators());
     Register(EvaluatorProperty().GetEvaluators());
 
@@ -57,21 +78,70 @@ class Evaluator {
     type_evaluator_.insert(evaluators.begin(), evaluators.end());
   }
 
+  void RegisterShortcuts(
+      const std::map<NodeType, std::map<Operator, NodeShortcut>> shortcuts) {
+    type_shortcut_.insert(shortcuts.begin(), shortcuts.end());
+  }
+
   void RegisterFunctor(const FunctorPtr functor) {
     eval_func.Register(functor);
   }
 
+  // Record the calls, results and time of every node evaluated into a
+  // profile, nullptr to stop. Profiling reads the steady clock twice per
+  // node.
+  void set_profile(EvaluationProfile* profile) { profile_ = profile; }
+
+  // Report envelope shortcuts and errors by kind, nullptr for none
+  void set_metrics_sink(MetricsSink* metrics) {
+    metrics_ = metrics == nullptr ? MetricsSink::Noop() : metrics;
+  }
+
   bool Evaluate(const AstNodePtr root, const FeatureSource* fs,
                 ValueT* result) const {
+    // geometries the feature gives are kept until the root is evaluated
+    GeometryPins pins;
+    if (profile_ == nullptr) return EvaluateNode(root, fs, result);
+    auto start = std::chrono::steady_clock::now();
+    bool ret = EvaluateNode(root, fs, result);
+    profile_->Record(root.get(), ret, *result,
+                     std::chrono::steady_clock::now() - start);
+    return ret;
+  }
+
+  const std::string& error_msg() const { return error_msg_; }
+
+ private:
+  bool EvaluateNode(const AstNodePtr root, const FeatureSource* fs,
+                    ValueT* result) const {
+    if (root->constant()) {
+      *result = root->origin_value();
+      root->set_value(*result);
+      return true;
+    }
+
     if (type_evaluator_.find(root->type()) == type_evaluator_.end() ||
         type_evaluator_.at(root->type()).find(root->op()) ==
             type_evaluator_.at(root->type()).end()) {
       error_msg_ = "can not find evaluator for operator \"" +
                    OpName.at(root->op()) + "\" in node type \"" +
                    TypeName.at(root->type()) + "\"";
+      metrics_->Add(MetricsSink::UnsupportedErrors, 1);
       return false;
     }
 
+    auto shortcuts = type_shortcut_.find(root->type());
+    if (shortcuts != type_shortcut_.end()) {
+      auto shortcut = shortcuts->second.find(root->op());
+      if (shortcut != shortcuts->second.end() and
+          shortcut->second(root, fs, result)) {
+        if (root->type() == SpatialPred)
+          metrics_->Add(MetricsSink::EnvelopeShortcuts, 1);
+        root->set_value(*result);
+        return true;
+      }
+    }
+
     std::vector<ValueT> child_values;
     for (AstNodePtr child : root->children()) {
       ValueT value;
@@ -92,12 +162,13 @@ class Evaluator {
                 << " value: " << value_str(*result, true);
     } else {
       LOG(ERROR) << "Evaluate Node " << root->id() << " error: " << error_msg_;
+      metrics_->Add(root->type() == Function ? MetricsSink::FunctionErrors
+                                             : MetricsSink::EvaluationErrors,
+                    1);
     }
 
     return ret;
   }
-
-  const std::string& error_msg() const { return error_msg_; }
 };
 
 }  // namespace cql2cpp
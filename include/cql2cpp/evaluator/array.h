@@ -10,6 +10,8 @@
 
 #pragma once
 
+#include <algorithm>
+
 #include "ast_node.h"
 
 namespace cql2cpp {
@@ -17,6 +19,7 @@ namespace cql2cpp {
 class EvaluatorArray : public EvaluatorAstNode {
  private:
   std::map<NodeType, std::map<Operator, NodeEval>> evaluators_;
+  std::map<NodeType, std::map<Operator, NodeShortcut>> shortcuts_;
 
   template <typename ValueType>
   static bool CheckValueNumberType(const std::string& op, size_t num,
@@ -35,85 +38,124 @@ class EvaluatorArray : public EvaluatorAstNode {
     return true;
   }
 
+  // Point to the operand itself if it is already in set form, e.g. literal
+  // arrays folded at compile time. Otherwise normalize a copy into storage.
+  // Properties registered with Cql2Cpp::RegisterArray are in set form
+  // before, and read by the shortcut without copying.
+  static const ArrayType* AsSortedSet(const ValueT& v, ArrayType* storage) {
+    const ArrayType& array = std::get<ArrayType>(v);
+    if (IsSortedSet(array)) return &array;
+    *storage = array;
+    NormalizeArray(storage);
+    return storage;
+  }
+
+  static bool SortedOperands(const std::vector<ValueT>& vs,
+                             const ArrayType** lhs, ArrayType* lhs_storage,
+                             const ArrayType** rhs, ArrayType* rhs_storage,
+                             std::string* errmsg) {
+    if (not CheckValueNumberType<ArrayType>("Array Op", 2, vs, errmsg))
+      return false;
+    *lhs = AsSortedSet(vs.at(0), lhs_storage);
+    *rhs = AsSortedSet(vs.at(1), rhs_storage);
+    return true;
+  }
+
+  // an operand in set form without evaluating it: a folded literal or a
+  // property normalized when the feature was loaded, nullptr otherwise
+  static const ArrayType* Resolve(const AstNodePtr& n,
+                                  const FeatureSource* fs) {
+    if (n->constant()) {
+      const ArrayType* array = std::get_if<ArrayType>(&n->origin_value());
+      return array != nullptr and IsSortedSet(*array) ? array : nullptr;
+    }
+    if (n->type() == PropertyName and fs != nullptr and
+        std::holds_alternative<std::string>(n->origin_value()))
+      return fs->get_set(std::get<std::string>(n->origin_value()));
+    return nullptr;
+  }
+
+  // the predicate of two arrays in set form, by linear merge
+  static bool Relate(Operator op, const ArrayType& lhs, const ArrayType& rhs) {
+    ArrayElementComp comp;
+    switch (op) {
+      case A_Equals:
+        return lhs.size() == rhs.size() and
+               std::equal(lhs.begin(), lhs.end(), rhs.begin(),
+                          [&comp](const Element& a, const Element& b) {
+                            return comp.equivalent(a, b);
+                          });
+      case A_Contains:
+        return lhs.size() >= rhs.size() and
+               std::includes(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                             comp);
+      case A_ContainedBy:
+        return lhs.size() <= rhs.size() and
+               std::includes(rhs.begin(), rhs.end(), lhs.begin(), lhs.end(),
+                             comp);
+      default: {  // A_Overlaps
+        auto l = lhs.begin();
+        auto r = rhs.begin();
+        while (l != lhs.end() and r != rhs.end()) {
+          if (comp(*l, *r))
+            ++l;
+          else if (comp(*r, *l))
+            ++r;
+          else
+            return true;
+        }
+        return false;
+      }
+    }
+  }
+
  public:
   EvaluatorArray() {
+    // literal arrays are folded by AstCompiler, here we only meet arrays
+    // which contain property names
     evaluators_[Array][NullOp] = [](auto n, auto vs, auto fs, auto value,
                                     auto errmsg) -> bool {
       ArrayType result;
       for (const auto& v : vs) result.emplace_back(Element(v));
+      NormalizeArray(&result);
       *value = result;
       return true;
     };
 
-    evaluators_[ArrayPred][A_Equals] = [this](auto n, auto vs, auto fs,
-                                              auto value, auto errmsg) -> bool {
-      const auto& contains = evaluators_.at(ArrayPred).at(A_Contains);
-      const auto& contained = evaluators_.at(ArrayPred).at(A_ContainedBy);
-
-      bool ret1 = contains.operator()(n, vs, fs, value, errmsg);
-      bool result_1 = std::get<bool>(*value);
-      if (not ret1) return false;
-      bool ret2 = contained.operator()(n, vs, fs, value, errmsg);
-      bool result_2 = std::get<bool>(*value);
-      if (not ret2) return false;
-
-      *value = result_1 and result_2;
-      return true;
-    };
-
-    evaluators_[ArrayPred][A_Contains] = [](auto n, auto vs, auto fs,
-                                            auto value, auto errmsg) -> bool {
-      if (not CheckValueNumberType<ArrayType>("Array Op", 2, vs, errmsg))
-        return false;
-      const auto& lhs_array = std::get<ArrayType>(vs.at(0));
-      const auto& rhs_array = std::get<ArrayType>(vs.at(1));
-      if (lhs_array.size() < rhs_array.size()) {
-        *value = false;
+    for (auto op : {A_Equals, A_Contains, A_ContainedBy, A_Overlaps}) {
+      evaluators_[ArrayPred][op] = [](auto n, auto vs, auto fs, auto value,
+                                      auto errmsg) -> bool {
+        ArrayType lhs_storage, rhs_storage;
+        const ArrayType* lhs;
+        const ArrayType* rhs;
+        if (not SortedOperands(vs, &lhs, &lhs_storage, &rhs, &rhs_storage,
+                               errmsg))
+          return false;
+        *value = Relate(n->op(), *lhs, *rhs);
         return true;
-      }
-      SetType lhs_set(lhs_array.begin(), lhs_array.end());
-      SetType rhs_set(rhs_array.begin(), rhs_array.end());
-      for (const auto& e : rhs_set)
-        if (lhs_set.find(e) == lhs_set.end()) {
-          *value = false;
-          return true;
-        }
-      *value = true;
-      return true;
-    };
-
-    evaluators_[ArrayPred][A_ContainedBy] =
-        [](auto n, auto vs, auto fs, auto value, auto errmsg) -> bool {
-      if (not CheckValueNumberType<ArrayType>("Array Op", 2, vs, errmsg))
-        return false;
+      };
 
-      const auto& lhs_array = std::get<ArrayType>(vs.at(0));
-      const auto& rhs_array = std::get<ArrayType>(vs.at(1));
-      if (lhs_array.size() > rhs_array.size()) {
-        *value = false;
+      // operands in set form, merged without evaluating the children
+      shortcuts_[ArrayPred][op] = [](auto n, auto fs, auto value) {
+        if (n->children().size() != 2) return false;
+        const ArrayType* lhs = Resolve(n->children().at(0), fs);
+        const ArrayType* rhs = Resolve(n->children().at(1), fs);
+        if (lhs == nullptr or rhs == nullptr) return false;
+        *value = Relate(n->op(), *lhs, *rhs);
         return true;
-      }
-      SetType lhs_set(lhs_array.begin(), lhs_array.end());
-      SetType rhs_set(rhs_array.begin(), rhs_array.end());
-      for (const auto& e : lhs_set)
-        if (rhs_set.find(e) == rhs_set.end()) {
-          *value = false;
-          return true;
-        }
-      *value = true;
-      return true;
-    };
-
-    evaluators_[ArrayPred][A_Overlaps] = [](auto n, auto vs, auto fs,
-                                            auto value, auto errmsg) -> bool {
-      // TODO
-      return false;
-    };
+      };
+    }
   }
+
   const std::map<NodeType, std::map<Operator, NodeEval>>& GetEvaluators()
       const override {
     return evaluators_;
   }
+
+  const std::map<NodeType, std::map<Operator, NodeShortcut>>& GetShortcuts()
+      const override {
+    return shortcuts_;
+  }
 };
 }  // namespace cql2cpp
 
@@ -23,9 +23,19 @@ using NodeEval =
     std::function<bool(const AstNodePtr, const std::vector<ValueT>&,
                        const FeatureSource*, ValueT*, std::string* error_msg)>;
 
+// Decide a node before its children are evaluated, false if it can not.
+using NodeShortcut =
+    std::function<bool(const AstNodePtr, const FeatureSource*, ValueT*)>;
+
 class EvaluatorAstNode {
  public:
    virtual const std::map<NodeType, std::map<Operator, NodeEval>>& GetEvaluators() const = 0;
+
+   virtual const std::map<NodeType, std::map<Operator, NodeShortcut>>&
+   GetShortcuts() const {
+     static const std::map<NodeType, std::map<Operator, NodeShortcut>> none;
+     return none;
+   }
 };
 
 using EvaluatorAstNodePtr = std::shared_ptr<EvaluatorAstNode>;
@@ -0,0 +1,191 @@
+/*
+ * File Name: between.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/10
+ *
+ */
+
+#pragma once
+
+#include <cql2cpp/selection_set.h>
+
+#include <cmath>
+#include <vector>
+
+#include "ast_node.h"
+
+namespace cql2cpp {
+
+// BETWEEN and NOT BETWEEN of numbers. Integers are compared as integers, so
+// int64_t beyond 2^53 are not rounded through double.
+class EvaluatorBetween : public EvaluatorAstNode {
+ private:
+  std::map<NodeType, std::map<Operator, NodeEval>> evaluators_;
+  std::map<NodeType, std::map<Operator, NodeShortcut>> shortcuts_;
+
+  // -1, 0 or 1 as a is less than, equal to or greater than b, false if
+  // either is not a number or is nan
+  static bool Compare(const ValueT& a, const ValueT& b, int* order) {
+    const int64_t* a_int = std::get_if<int64_t>(&a);
+    const int64_t* b_int = std::get_if<int64_t>(&b);
+    const uint64_t* a_uint = std::get_if<uint64_t>(&a);
+    const uint64_t* b_uint = std::get_if<uint64_t>(&b);
+    if ((a_int != nullptr or a_uint != nullptr) and
+        (b_int != nullptr or b_uint != nullptr)) {
+      if (a_int != nullptr and b_int != nullptr)
+        *order = (*a_int > *b_int) - (*a_int < *b_int);
+      else if (a_uint != nullptr and b_uint != nullptr)
+        *order = (*a_uint > *b_uint) - (*a_uint < *b_uint);
+      else if (a_int != nullptr)  // and b is unsigned
+        *order = *a_int < 0 ? -1
+                            : (static_cast<uint64_t>(*a_int) > *b_uint) -
+                                  (static_cast<uint64_t>(*a_int) < *b_uint);
+      else
+        *order = *b_int < 0 ? 1
+                            : (*a_uint > static_cast<uint64_t>(*b_int)) -
+                                  (*a_uint < static_cast<uint64_t>(*b_int));
+      return true;
+    }
+
+    double left, right;
+    if (not ToDouble(a, &left) or not ToDouble(b, &right) or
+        std::isnan(left) or std::isnan(right))
+      return false;
+    *order = (left > right) - (left < right);
+    return true;
+  }
+
+  static bool ToDouble(const ValueT& v, double* d) {
+    if (std::holds_alternative<int64_t>(v))
+      *d = std::get<int64_t>(v);
+    else if (std::holds_alternative<uint64_t>(v))
+      *d = std::get<uint64_t>(v);
+    else if (std::holds_alternative<double>(v))
+      *d = std::get<double>(v);
+    else
+      return false;
+    return true;
+  }
+
+  static bool IsNull(const ValueT& v) {
+    return std::holds_alternative<NullStruct>(v);
+  }
+
+  // constant bounds of a predicate on a property
+  static bool Bounds(const AstNodePtr& n, std::string* property_path) {
+    if (n->type() != IsBetweenPred or n->children().size() != 3) return false;
+    const AstNodePtr& value = n->children().at(0);
+    if (value->type() != PropertyName or
+        not std::holds_alternative<std::string>(value->origin_value()) or
+        not n->children().at(1)->constant() or
+        not n->children().at(2)->constant())
+      return false;
+    *property_path = std::get<std::string>(value->origin_value());
+    return true;
+  }
+
+ public:
+  // v BETWEEN low AND high, null if any of them is null
+  static bool Within(const ValueT& v, const ValueT& low, const ValueT& high,
+                     ValueT* value, std::string* errmsg) {
+    if (IsNull(v) or IsNull(low) or IsNull(high)) {
+      *value = NullValue;
+      return true;
+    }
+    // the common case of an integer property and integer literals
+    const int64_t* i = std::get_if<int64_t>(&v);
+    const int64_t* i_low = std::get_if<int64_t>(&low);
+    const int64_t* i_high = std::get_if<int64_t>(&high);
+    if (i != nullptr and i_low != nullptr and i_high != nullptr) {
+      *value = *i_low <= *i and *i <= *i_high;
+      return true;
+    }
+    int to_low, to_high;
+    if (not Compare(v, low, &to_low) or not Compare(v, high, &to_high)) {
+      *errmsg = "BETWEEN needs numbers but we have " + value_str(v, true) +
+                ", " + value_str(low, true) + " and " + value_str(high, true);
+      return false;
+    }
+    *value = to_low >= 0 and to_high <= 0;
+    return true;
+  }
+
+  // Narrow candidates to the features whose property is, or is not for
+  // NotBetween, between constant bounds, in one pass without the evaluator.
+  // Features for which the predicate is null or an error are dropped and
+  // counted. False if the predicate is not of this form.
+  static bool Batch(const AstNodePtr& n,
+                    const std::vector<FeatureSourcePtr>& features,
+                    SelectionSet* candidates, size_t* nulls, size_t* errors) {
+    std::string property_path;
+    if (not Bounds(n, &property_path)) return false;
+    const ValueT& low = n->children().at(1)->origin_value();
+    const ValueT& high = n->children().at(2)->origin_value();
+    bool negate = n->op() == NotBetween;
+    if (IsNull(low) or IsNull(high)) {
+      *nulls += candidates->Count();
+      candidates->Clear();
+      return true;
+    }
+
+    std::vector<uint32_t> selected;
+    std::string errmsg;
+    ValueT value;
+    candidates->ForEach([&](uint32_t ordinal) {
+      if (not Within(features.at(ordinal)->get_property(property_path), low,
+                     high, &value, &errmsg))
+        (*errors)++;
+      else if (IsNull(value))
+        (*nulls)++;
+      else if (std::get<bool>(value) != negate)
+        selected.emplace_back(ordinal);
+    });
+    *candidates = SelectionSet(std::move(selected));
+    return true;
+  }
+
+  EvaluatorBetween() {
+    for (auto op : {Between, NotBetween}) {
+      evaluators_[IsBetweenPred][op] = [](auto n, auto vs, auto fs, auto value,
+                                          auto errmsg) -> bool {
+        if (vs.size() != 3) {
+          *errmsg = "BETWEEN needs three values but we have " +
+                    std::to_string(vs.size());
+          return false;
+        }
+        if (not Within(vs.at(0), vs.at(1), vs.at(2), value, errmsg))
+          return false;
+        if (n->op() == NotBetween and std::holds_alternative<bool>(*value))
+          *value = not std::get<bool>(*value);
+        return true;
+      };
+
+      // a property between literals, read without evaluating the children
+      shortcuts_[IsBetweenPred][op] = [](auto n, auto fs, auto value) {
+        std::string property_path, errmsg;
+        if (fs == nullptr or not Bounds(n, &property_path) or
+            not Within(fs->get_property(property_path),
+                       n->children().at(1)->origin_value(),
+                       n->children().at(2)->origin_value(), value, &errmsg))
+          return false;
+        if (n->op() == NotBetween and std::holds_alternative<bool>(*value))
+          *value = not std::get<bool>(*value);
+        return true;
+      };
+    }
+  }
+
+  const std::map<NodeType, std::map<Operator, NodeEval>>& GetEvaluators()
+      const override {
+    return evaluators_;
+  }
+
+  const std::map<NodeType, std::map<Operator, NodeShortcut>>& GetShortcuts()
+      const override {
+    return shortcuts_;
+  }
+};
+}  // namespace cql2cpp
@@ -110,10 +110,9 @@ class EvaluatorCompare : public EvaluatorAstNode {
         *value = std::get<bool>(vs.at(0)) == std::get<bool>(vs.at(1));
         return true;
       }
-      if (std::holds_alternative<std::string>(vs.at(0)) and
-          std::holds_alternative<std::string>(vs.at(1))) {
-        *value =
-            std::get<std::string>(vs.at(0)) == std::get<std::string>(vs.at(1));
+      std::string_view left_str, right_str;
+      if (GetString(vs.at(0), &left_str) and GetString(vs.at(1), &right_str)) {
+        *value = left_str == right_str;
         return true;
       }
 
@@ -57,7 +57,7 @@ class EvaluatorIn : public EvaluatorAstNode {
           not std::holds_alternative<int64_t>(vs.at(0)) and
           not std::holds_alternative<uint64_t>(vs.at(0)) and
           not std::holds_alternative<double>(vs.at(0)) and
-          not std::holds_alternative<std::string>(vs.at(0))) {
+          not IsString(vs.at(0))) {
         *errmsg = "left hand side is not scalar type";
         return false;
       }
@@ -0,0 +1,139 @@
+/*
+ * File Name: like.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/06
+ *
+ */
+
+#pragma once
+
+#include <cql2cpp/like_matcher.h>
+#include <cql2cpp/string_fold.h>
+
+#include "ast_node.h"
+
+namespace cql2cpp {
+
+class EvaluatorLike : public EvaluatorAstNode {
+ private:
+  std::map<NodeType, std::map<Operator, NodeEval>> evaluators_;
+  std::map<NodeType, std::map<Operator, NodeShortcut>> shortcuts_;
+
+  // the property under nested CASEI and ACCENTI and their folding, false if
+  // there is something else
+  static bool FoldedProperty(const AstNodePtr& n, std::string* property_path,
+                             int* folding) {
+    *folding = 0;
+    AstNodePtr node = n;
+    while (node->type() == CharacterClause and node->children().size() == 1) {
+      *folding |= StringFold::FoldingOf(node->op());
+      node = node->children().front();
+    }
+    if (node->type() != PropertyName or
+        not std::holds_alternative<std::string>(node->origin_value()))
+      return false;
+    *property_path = std::get<std::string>(node->origin_value());
+    return true;
+  }
+
+ public:
+  EvaluatorLike() {
+    evaluators_[IsLikePred][Like] = [](auto n, auto vs, auto fs, auto value,
+                                       auto errmsg) -> bool {
+      return Match(n, vs, value, errmsg);
+    };
+    evaluators_[IsLikePred][NotLike] = [](auto n, auto vs, auto fs,
+                                          auto value, auto errmsg) -> bool {
+      bool ret = Match(n, vs, value, errmsg);
+      if (ret and std::holds_alternative<bool>(*value))
+        *value = not std::get<bool>(*value);
+      return ret;
+    };
+
+    // literals are folded by AstCompiler, here we only meet properties and
+    // functions
+    evaluators_[CharacterClause][CaseI] = [](auto n, auto vs, auto fs,
+                                             auto value, auto errmsg) -> bool {
+      return Fold(vs, &StringFold::FoldCase, value, errmsg);
+    };
+    evaluators_[CharacterClause][AccentI] =
+        [](auto n, auto vs, auto fs, auto value, auto errmsg) -> bool {
+      return Fold(vs, &StringFold::FoldAccents, value, errmsg);
+    };
+
+    // a property folded when the feature was loaded
+    for (auto op : {CaseI, AccentI})
+      shortcuts_[CharacterClause][op] = [](auto n, auto fs, auto value) {
+        std::string property_path;
+        int folding;
+        return fs != nullptr and FoldedProperty(n, &property_path, &folding) and
+               fs->get_folded(property_path, folding, value);
+      };
+  }
+
+  // the matcher of a literal pattern is compiled by AstCompiler
+  static bool Match(const AstNodePtr& n, const std::vector<ValueT>& vs,
+                    ValueT* value, std::string* errmsg) {
+    if (vs.size() != 2) {
+      *errmsg = "(NOT)LIKE needs two values but we have " +
+                std::to_string(vs.size());
+      return false;
+    }
+    if (std::holds_alternative<NullStruct>(vs.at(0)) or
+        std::holds_alternative<NullStruct>(vs.at(1))) {
+      *value = NullValue;
+      return true;
+    }
+    std::string_view s, pattern;
+    if (not GetString(vs.at(0), &s)) {
+      *errmsg = "left hand side of (NOT)LIKE is not a string";
+      return false;
+    }
+    auto matcher = dynamic_cast<const LikeMatcher*>(n->compiled());
+    if (matcher != nullptr) {
+      *value = matcher->Match(s);
+      return true;
+    }
+    if (not GetString(vs.at(1), &pattern)) {
+      *errmsg = "pattern of (NOT)LIKE is not a string";
+      return false;
+    }
+    *value = LikeMatcher(pattern).Match(s);
+    return true;
+  }
+
+  static bool Fold(const std::vector<ValueT>& vs,
+                   std::string (*fold)(std::string_view), ValueT* value,
+                   std::string* errmsg) {
+    if (vs.size() != 1) {
+      *errmsg = "CASEI and ACCENTI need one value but we have " +
+                std::to_string(vs.size());
+      return false;
+    }
+    if (std::holds_alternative<NullStruct>(vs.at(0))) {
+      *value = NullValue;
+      return true;
+    }
+    std::string_view s;
+    if (not GetString(vs.at(0), &s)) {
+      *errmsg = "CASEI and ACCENTI need a string";
+      return false;
+    }
+    *value = fold(s);
+    return true;
+  }
+
+  const std::map<NodeType, std::map<Operator, NodeEval>>& GetEvaluators()
+      const override {
+    return evaluators_;
+  }
+
+  const std::map<NodeType, std::map<Operator, NodeShortcut>>& GetShortcuts()
+      const override {
+    return shortcuts_;
+  }
+};
+}  // namespace cql2cpp
@@ -0,0 +1,91 @@
+/*
+ * File Name: null.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/10
+ *
+ */
+
+#pragma once
+
+#include <cql2cpp/selection_set.h>
+
+#include <vector>
+
+#include "ast_node.h"
+
+namespace cql2cpp {
+
+// IS NULL and IS NOT NULL. Of a property they ask the feature source, which
+// may answer without building the value.
+class EvaluatorNull : public EvaluatorAstNode {
+ private:
+  std::map<NodeType, std::map<Operator, NodeEval>> evaluators_;
+  std::map<NodeType, std::map<Operator, NodeShortcut>> shortcuts_;
+
+  static bool Property(const AstNodePtr& n, std::string* property_path) {
+    if (n->type() != IsNullPred or n->children().size() != 1) return false;
+    const AstNodePtr& operand = n->children().front();
+    if (operand->type() != PropertyName or
+        not std::holds_alternative<std::string>(operand->origin_value()))
+      return false;
+    *property_path = std::get<std::string>(operand->origin_value());
+    return true;
+  }
+
+ public:
+  // Narrow candidates to the features whose property is, or is not for
+  // IsNotNull, null in one pass without the evaluator. False if the
+  // predicate is not of a property.
+  static bool Batch(const AstNodePtr& n,
+                    const std::vector<FeatureSourcePtr>& features,
+                    SelectionSet* candidates) {
+    std::string property_path;
+    if (not Property(n, &property_path)) return false;
+    bool null = n->op() == IsNull;
+    std::vector<uint32_t> selected;
+    candidates->ForEach([&](uint32_t ordinal) {
+      if (features.at(ordinal)->is_null(property_path) == null)
+        selected.emplace_back(ordinal);
+    });
+    *candidates = SelectionSet(std::move(selected));
+    return true;
+  }
+
+  EvaluatorNull() {
+    for (auto op : {IsNull, IsNotNull}) {
+      evaluators_[IsNullPred][op] = [](auto n, auto vs, auto fs, auto value,
+                                       auto errmsg) -> bool {
+        if (vs.size() != 1) {
+          *errmsg = "IS NULL needs one value but we have " +
+                    std::to_string(vs.size());
+          return false;
+        }
+        *value = std::holds_alternative<NullStruct>(vs.front()) ==
+                 (n->op() == IsNull);
+        return true;
+      };
+
+      // a property is tested without reading its value
+      shortcuts_[IsNullPred][op] = [](auto n, auto fs, auto value) {
+        std::string property_path;
+        if (fs == nullptr or not Property(n, &property_path)) return false;
+        *value = fs->is_null(property_path) == (n->op() == IsNull);
+        return true;
+      };
+    }
+  }
+
+  const std::map<NodeType, std::map<Operator, NodeEval>>& GetEvaluators()
+      const override {
+    return evaluators_;
+  }
+
+  const std::map<NodeType, std::map<Operator, NodeShortcut>>& GetShortcuts()
+      const override {
+    return shortcuts_;
+  }
+};
+}  // namespace cql2cpp
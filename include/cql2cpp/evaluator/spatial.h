@@ -19,54 +19,125 @@ namespace cql2cpp {
 class EvaluatorSpatial : public EvaluatorAstNode {
  private:
   std::map<NodeType, std::map<Operator, NodeEval>> evaluators_;
+  std::map<NodeType, std::map<Operator, NodeShortcut>> shortcuts_;
 
- public:
-  EvaluatorSpatial() {
-    evaluators_[SpatialPred][S_Intersects] =
-        [](auto n, auto vs, auto fs, auto value, auto errmsg) -> bool {
+  // envelope of a literal or of a property, without building its geometry
+  static bool Envelope(const AstNodePtr& node, const FeatureSource* fs,
+                       geos::geom::Envelope* envelope) {
+    if (node->constant()) {
+      const ValueT& value = node->origin_value();
+      if (std::holds_alternative<const geos::geom::Geometry*>(value) and
+          std::get<const geos::geom::Geometry*>(value) != nullptr) {
+        *envelope =
+            *std::get<const geos::geom::Geometry*>(value)->getEnvelopeInternal();
+        return true;
+      }
+      if (std::holds_alternative<const geos::geom::Envelope*>(value) and
+          std::get<const geos::geom::Envelope*>(value) != nullptr) {
+        *envelope = *std::get<const geos::geom::Envelope*>(value);
+        return true;
+      }
+      return false;
+    }
+    if (node->type() == PropertyName and fs != nullptr and
+        std::holds_alternative<std::string>(node->origin_value()))
+      return fs->get_envelope(std::get<std::string>(node->origin_value()),
+                              envelope);
+    return false;
+  }
+
+  // Two geometries with disjoint envelopes are disjoint, so every other
+  // predicate is false without building either geometry.
+  static NodeShortcut EnvelopeCheck(bool if_disjoint) {
+    return [if_disjoint](auto n, auto fs, auto value) -> bool {
+      if (n->children().size() != 2) return false;
+      geos::geom::Envelope lhs, rhs;
+      if (not Envelope(n->children().at(0), fs, &lhs) or
+          not Envelope(n->children().at(1), fs, &rhs) or lhs.intersects(rhs))
+        return false;
+      *value = if_disjoint;
+      return true;
+    };
+  }
+
+  // a geometry or a bbox as a geometry, nullptr if it is neither
+  static const geos::geom::Geometry* AsGeometry(
+      const ValueT& value, const geos::geom::GeometryFactory* factory,
+      std::unique_ptr<geos::geom::Geometry>* owned) {
+    if (std::holds_alternative<const geos::geom::Geometry*>(value))
+      return std::get<const geos::geom::Geometry*>(value);
+    if (std::holds_alternative<const geos::geom::Envelope*>(value) and
+        std::get<const geos::geom::Envelope*>(value) != nullptr) {
+      *owned =
+          factory->toGeometry(std::get<const geos::geom::Envelope*>(value));
+      return owned->get();
+    }
+    return nullptr;
+  }
+
+  using Relate = bool (*)(const geos::geom::Geometry*,
+                          const geos::geom::Geometry*);
+
+  static NodeEval Predicate(const std::string& name, Relate relate) {
+    return [name, relate](auto n, auto vs, auto fs, auto value,
+                          auto errmsg) -> bool {
       if (vs.size() != 2) {
-        *errmsg = "S_INTERSECTS needs two values but we have " +
+        *errmsg = name + " needs two values but we have " +
                   std::to_string(vs.size());
         return false;
       }
       geos::geom::GeometryFactory::Ptr factory =
           geos::geom::GeometryFactory::create();
-      const geos::geom::Geometry* lhs = nullptr;
-      std::shared_ptr<geos::geom::Geometry> lhs_shared;
-      if (std::holds_alternative<const geos::geom::Geometry*>(vs.at(0)))
-        lhs = std::get<const geos::geom::Geometry*>(vs.at(0));
-      else if (std::holds_alternative<const geos::geom::Envelope*>(vs.at(0))) {
-        lhs_shared = factory->toGeometry(
-            std::get<const geos::geom::Envelope*>(vs.at(0)));
-        lhs = lhs_shared.get();
-      } else {
-        *errmsg =
-            "left hand side value type of S_INTERSECTS should be geometry or "
-            "bbox";
+      std::unique_ptr<geos::geom::Geometry> lhs_owned, rhs_owned;
+      const geos::geom::Geometry* lhs =
+          AsGeometry(vs.at(0), factory.get(), &lhs_owned);
+      if (lhs == nullptr) {
+        *errmsg = "left hand side value type of " + name +
+                  " should be geometry or bbox";
         return false;
       }
-      const geos::geom::Geometry* rhs = nullptr;
-      std::shared_ptr<geos::geom::Geometry> rhs_shared;
-      if (std::holds_alternative<const geos::geom::Geometry*>(vs.at(1)))
-        rhs = std::get<const geos::geom::Geometry*>(vs.at(1));
-      else if (std::holds_alternative<const geos::geom::Envelope*>(vs.at(1))) {
-        rhs_shared = factory->toGeometry(
-            std::get<const geos::geom::Envelope*>(vs.at(1)));
-        rhs = rhs_shared.get();
-      } else {
-        *errmsg =
-            "right hand side value type of S_INTERSECTS should be geometry or "
-            "bbox";
+      const geos::geom::Geometry* rhs =
+          AsGeometry(vs.at(1), factory.get(), &rhs_owned);
+      if (rhs == nullptr) {
+        *errmsg = "right hand side value type of " + name +
+                  " should be geometry or bbox";
         return false;
       }
-      *value = lhs->intersects(rhs);
+      *value = relate(lhs, rhs);
       return true;
     };
   }
+
+ public:
+  EvaluatorSpatial() {
+    const std::map<Operator, Relate> relates = {
+        {S_Contains, [](auto lhs, auto rhs) { return lhs->contains(rhs); }},
+        {S_Crosses, [](auto lhs, auto rhs) { return lhs->crosses(rhs); }},
+        {S_Disjoint, [](auto lhs, auto rhs) { return lhs->disjoint(rhs); }},
+        {S_Equals, [](auto lhs, auto rhs) { return lhs->equals(rhs); }},
+        {S_Intersects,
+         [](auto lhs, auto rhs) { return lhs->intersects(rhs); }},
+        {S_Overlaps, [](auto lhs, auto rhs) { return lhs->overlaps(rhs); }},
+        {S_Touches, [](auto lhs, auto rhs) { return lhs->touches(rhs); }},
+        {S_Within, [](auto lhs, auto rhs) { return lhs->within(rhs); }},
+    };
+    for (const auto& [name, op] : NameOp) {
+      auto relate = relates.find(op);
+      if (relate == relates.end()) continue;
+      evaluators_[SpatialPred][op] = Predicate(name, relate->second);
+      shortcuts_[SpatialPred][op] = EnvelopeCheck(op == S_Disjoint);
+    }
+  }
+
   const std::map<NodeType, std::map<Operator, NodeEval>>& GetEvaluators()
       const override {
     return evaluators_;
   }
+
+  const std::map<NodeType, std::map<Operator, NodeShortcut>>& GetShortcuts()
+      const override {
+    return shortcuts_;
+  }
 };
 }  // namespace cql2cpp
 
@@ -0,0 +1,115 @@
+/*
+ * File Name: temporal.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/08
+ *
+ */
+
+#pragma once
+
+#include <cql2cpp/temporal.h>
+
+#include "ast_node.h"
+
+namespace cql2cpp {
+
+class EvaluatorTemporal : public EvaluatorAstNode {
+ private:
+  std::map<NodeType, std::map<Operator, NodeEval>> evaluators_;
+  std::map<NodeType, std::map<Operator, NodeShortcut>> shortcuts_;
+
+  // the time of a literal, of a property parsed when the feature was
+  // loaded or of an interval of them, false if there is something else
+  static bool Resolve(const AstNodePtr& n, const FeatureSource* fs,
+                      TimeValue* time) {
+    if (n->constant()) {
+      if (not std::holds_alternative<TimeValue>(n->origin_value()))
+        return false;
+      *time = std::get<TimeValue>(n->origin_value());
+      return true;
+    }
+    if (n->type() == PropertyName)
+      return fs != nullptr and
+             std::holds_alternative<std::string>(n->origin_value()) and
+             fs->get_time(std::get<std::string>(n->origin_value()), time);
+    TimeValue begin, end;
+    if (n->type() != TemporalInstance or n->op() != Interval or
+        n->children().size() != 2 or
+        not ResolveEnd(n->children().at(0), fs, &begin) or
+        not ResolveEnd(n->children().at(1), fs, &end) or
+        begin.begin > end.end)
+      return false;
+    *time = {begin.begin, end.end};
+    return true;
+  }
+
+  // an end of an interval, '..' being unbounded as in Temporal::Instance
+  static bool ResolveEnd(const AstNodePtr& n, const FeatureSource* fs,
+                         TimeValue* time) {
+    std::string_view s;
+    if (n->constant() and GetString(n->origin_value(), &s) and s == "..") {
+      *time = {TimeValue::kUnboundedBegin, TimeValue::kUnboundedEnd};
+      return true;
+    }
+    return Resolve(n, fs, time);
+  }
+
+ public:
+  EvaluatorTemporal() {
+    // literals are parsed by AstCompiler, here we only meet properties and
+    // functions
+    for (auto op : {Timestamp, Date, Interval})
+      evaluators_[TemporalInstance][op] =
+          [](auto n, auto vs, auto fs, auto value, auto errmsg) -> bool {
+        return Temporal::Instance(n->op(), vs, value, errmsg);
+      };
+
+    for (auto op : Temporal::Predicates()) {
+      evaluators_[TemporalPred][op] = [](auto n, auto vs, auto fs, auto value,
+                                         auto errmsg) -> bool {
+        if (vs.size() != 2) {
+          *errmsg = "temporal predicate needs two values but we have " +
+                    std::to_string(vs.size());
+          return false;
+        }
+        ValueT a, b;
+        if (not Temporal::ToTime(vs.at(0), &a, errmsg) or
+            not Temporal::ToTime(vs.at(1), &b, errmsg))
+          return false;
+        if (std::holds_alternative<NullStruct>(a) or
+            std::holds_alternative<NullStruct>(b)) {
+          *value = NullValue;
+          return true;
+        }
+        *value = Temporal::Relate(n->op(), std::get<TimeValue>(a),
+                                  std::get<TimeValue>(b));
+        return true;
+      };
+
+      // times parsed before, compared without evaluating the children
+      shortcuts_[TemporalPred][op] = [](auto n, auto fs, auto value) {
+        TimeValue a, b;
+        if (n->children().size() != 2 or
+            not Resolve(n->children().at(0), fs, &a) or
+            not Resolve(n->children().at(1), fs, &b))
+          return false;
+        *value = Temporal::Relate(n->op(), a, b);
+        return true;
+      };
+    }
+  }
+
+  const std::map<NodeType, std::map<Operator, NodeEval>>& GetEvaluators()
+      const override {
+    return evaluators_;
+  }
+
+  const std::map<NodeType, std::map<Operator, NodeShortcut>>& GetShortcuts()
+      const override {
+    return shortcuts_;
+  }
+};
+}  // namespace cql2cpp
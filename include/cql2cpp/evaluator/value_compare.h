@@ -22,6 +22,9 @@ inline bool TypedEqual(const ValueT& a, const ValueT& b) {
 }
 
 inline bool isVariantEqual(const ValueT& a, const ValueT& b) {
+  std::string_view s_a, s_b;
+  if (GetString(a, &s_a) and GetString(b, &s_b)) return s_a == s_b;
+
   if (a.index() != b.index()) return false;
 
   if (std::holds_alternative<bool>(a)) return TypedEqual<bool>(a, b);
@@ -30,12 +33,11 @@ inline bool isVariantEqual(const ValueT& a, const ValueT& b) {
 
   if (std::holds_alternative<uint64_t>(a)) return TypedEqual<uint64_t>(a, b);
 
+  if (std::holds_alternative<TimeValue>(a)) return TypedEqual<TimeValue>(a, b);
+
   if (std::holds_alternative<double>(a))
     return fabs(std::get<double>(a) - std::get<double>(b)) < kEpsilon;
 
-  if (std::holds_alternative<std::string>(a))
-    return TypedEqual<std::string>(a, b);
-
   return false;
 }
 
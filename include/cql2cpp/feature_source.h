@@ -18,6 +18,51 @@ namespace cql2cpp {
 class FeatureSource {
  public:
    virtual ValueT get_property(const std::string& property_path) const = 0;
+
+   // True if a property is missing or null. Sources override it to answer
+   // without building the value, for IS NULL.
+   virtual bool is_null(const std::string& property_path) const {
+     return std::holds_alternative<NullStruct>(get_property(property_path));
+   }
+
+   // The envelope of a geometry property, false if it is not a geometry.
+   // Sources keeping geometries undecoded override it to answer without
+   // building the geometry.
+   virtual bool get_envelope(const std::string& property_path,
+                             geos::geom::Envelope* envelope) const {
+     ValueT value = get_property(property_path);
+     if (not std::holds_alternative<const geos::geom::Geometry*>(value) or
+         std::get<const geos::geom::Geometry*>(value) == nullptr)
+       return false;
+     *envelope =
+         *std::get<const geos::geom::Geometry*>(value)->getEnvelopeInternal();
+     return true;
+   }
+
+   // The value of a string property folded as by StringFold::Fold, false if
+   // it was not folded before. Sources materialising folded variants of
+   // properties override it, so CASEI and ACCENTI do not fold per
+   // evaluation.
+   virtual bool get_folded(const std::string& property_path, int folding,
+                           ValueT* value) const {
+     return false;
+   }
+
+   // The time of a date or timestamp property, false if it was not parsed
+   // before. Sources parsing time properties when they are loaded override
+   // it, so temporal predicates compare integers.
+   virtual bool get_time(const std::string& property_path,
+                         TimeValue* time) const {
+     return false;
+   }
+
+   // An array property sorted and deduplicated, nullptr if it was not
+   // normalized before. Sources normalizing array properties when they are
+   // loaded override it, so array predicates do not sort per evaluation.
+   virtual const ArrayType* get_set(const std::string& property_path) const {
+     return nullptr;
+   }
+
    virtual ~FeatureSource() {}
 };
 
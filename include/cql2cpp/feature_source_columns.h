@@ -0,0 +1,79 @@
+/*
+ * File Name: feature_source_columns.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/08
+ *
+ */
+
+#pragma once
+
+#include <string>
+
+#include "array_columns.h"
+#include "feature_source.h"
+#include "folded_columns.h"
+#include "time_columns.h"
+
+namespace cql2cpp {
+
+// A feature of a Cql2Cpp with its columns computed at load time, for one
+// evaluation. Folded strings are views into the columns.
+class FeatureSourceColumns : public FeatureSource {
+ private:
+  const FeatureSource& feature_;
+  const FoldedColumns& folded_;
+  const TimeColumns& times_;
+  const ArrayColumns& arrays_;
+  uint32_t ordinal_;
+
+ public:
+  FeatureSourceColumns(const FeatureSource& feature,
+                       const FoldedColumns& folded, const TimeColumns& times,
+                       const ArrayColumns& arrays, uint32_t ordinal)
+      : feature_(feature),
+        folded_(folded),
+        times_(times),
+        arrays_(arrays),
+        ordinal_(ordinal) {}
+
+  ValueT get_property(const std::string& property_path) const override {
+    return feature_.get_property(property_path);
+  }
+
+  bool is_null(const std::string& property_path) const override {
+    return feature_.is_null(property_path);
+  }
+
+  bool get_envelope(const std::string& property_path,
+                    geos::geom::Envelope* envelope) const override {
+    return feature_.get_envelope(property_path, envelope);
+  }
+
+  bool get_folded(const std::string& property_path, int folding,
+                  ValueT* value) const override {
+    const ValueT* folded = folded_.Get(ordinal_, property_path, folding);
+    if (folded == nullptr)
+      return feature_.get_folded(property_path, folding, value);
+    if (std::holds_alternative<std::string>(*folded))
+      *value = std::string_view(std::get<std::string>(*folded));
+    else
+      *value = *folded;
+    return true;
+  }
+
+  bool get_time(const std::string& property_path,
+                TimeValue* time) const override {
+    return times_.Get(ordinal_, property_path, time) or
+           feature_.get_time(property_path, time);
+  }
+
+  const ArrayType* get_set(const std::string& property_path) const override {
+    const ArrayType* array = arrays_.Get(ordinal_, property_path);
+    return array != nullptr ? array : feature_.get_set(property_path);
+  }
+};
+
+}  // namespace cql2cpp
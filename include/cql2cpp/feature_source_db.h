@@ -10,13 +10,96 @@
 
 #pragma once
 
+#include <geos/geom/Geometry.h>
+#include <geos/io/WKBReader.h>
+#include <glog/logging.h>
+#include <sqlite3.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "feature_source.h"
 
 namespace cql2cpp {
 
+// A row of a SQLite query. Its columns are copied out of the statement
+// stepped to the row, so it outlives the next step. Geometry columns are
+// selected as WKB, e.g. by ST_AsBinary, and built on first use.
 class FeatureSourceDB : public FeatureSource {
+ private:
+  std::shared_ptr<const std::vector<std::string>> properties_;
+  std::vector<ValueT> values_;
+  mutable std::vector<std::string> wkb_;  // cleared if invalid
+  mutable std::vector<std::unique_ptr<geos::geom::Geometry>> geometries_;
+
  public:
+  // Column i + first of the statement is property i. A property is a
+  // geometry if is_geometry is true for it.
+  FeatureSourceDB(sqlite3_stmt* stmt, int first,
+                  std::shared_ptr<const std::vector<std::string>> properties,
+                  const std::vector<bool>& is_geometry)
+      : properties_(std::move(properties)),
+        values_(properties_->size(), NullValue),
+        wkb_(properties_->size()),
+        geometries_(properties_->size()) {
+    for (size_t i = 0; i < properties_->size(); i++) {
+      int column = first + static_cast<int>(i);
+      switch (sqlite3_column_type(stmt, column)) {
+        case SQLITE_INTEGER:
+          values_.at(i) =
+              static_cast<int64_t>(sqlite3_column_int64(stmt, column));
+          break;
+        case SQLITE_FLOAT:
+          values_.at(i) = sqlite3_column_double(stmt, column);
+          break;
+        case SQLITE_TEXT:
+          values_.at(i) = std::string(
+              reinterpret_cast<const char*>(sqlite3_column_text(stmt, column)),
+              sqlite3_column_bytes(stmt, column));
+          break;
+        case SQLITE_BLOB:
+          if (i < is_geometry.size() and is_geometry.at(i))
+            wkb_.at(i).assign(
+                static_cast<const char*>(sqlite3_column_blob(stmt, column)),
+                sqlite3_column_bytes(stmt, column));
+          break;
+        default:  // NULL
+          break;
+      }
+    }
+  }
+
+  ValueT get_property(const std::string& property_path) const override {
+    for (size_t i = 0; i < properties_->size(); i++) {
+      if (properties_->at(i) != property_path) continue;
+      if (wkb_.at(i).empty()) return values_.at(i);
+      if (geometries_.at(i) == nullptr) {
+        try {
+          geometries_.at(i) = geos::io::WKBReader().read(
+              reinterpret_cast<const unsigned char*>(wkb_.at(i).data()),
+              wkb_.at(i).size());
+        } catch (const std::exception& e) {
+          LOG(WARNING) << "invalid geometry: " << e.what();
+          wkb_.at(i).clear();
+          return NullValue;
+        }
+      }
+      return static_cast<const geos::geom::Geometry*>(geometries_.at(i).get());
+    }
+    return NullValue;
+  }
+
+  // without copying strings out of the row
+  bool is_null(const std::string& property_path) const override {
+    for (size_t i = 0; i < properties_->size(); i++) {
+      if (properties_->at(i) != property_path) continue;
+      if (wkb_.at(i).empty())
+        return std::holds_alternative<NullStruct>(values_.at(i));
+      return FeatureSource::is_null(property_path);
+    }
+    return true;
+  }
 };
 
 };  // namespace cql2cpp
-
@@ -0,0 +1,352 @@
+/*
+ * File Name: feature_source_flatgeobuf.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/30
+ *
+ */
+
+#pragma once
+
+#include <geos/geom/Envelope.h>
+#include <geos/geom/Geometry.h>
+
+#include <cmath>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "feature_source.h"
+#include "flat_table.h"
+#include "feature_source_mapped.h"
+#include "lazy_geometry.h"
+
+namespace cql2cpp {
+
+// https://github.com/flatgeobuf/flatgeobuf/blob/master/src/fbs/header.fbs
+enum class FlatGeobufType : uint8_t {
+  Byte,
+  UByte,
+  Bool,
+  Short,
+  UShort,
+  Int,
+  UInt,
+  Long,
+  ULong,
+  Float,
+  Double,
+  String,
+  Json,
+  DateTime,
+  Binary
+};
+
+// what a feature needs to know from the header of its file
+struct FlatGeobufSchema {
+  std::vector<FlatGeobufType> types;
+  std::unordered_map<std::string, uint16_t> columns;  // name to index
+  uint8_t geometry_type = 0;  // 0 if it differs between features
+  bool has_z = false;
+};
+
+// A feature of a FlatGeobuf file decoded in place from its flatbuffer.
+// Properties are decoded when they are asked for, strings as views into the
+// file. The envelope of the geometry is read from its coordinates, and the
+// geometry is converted to WKB and built only when a predicate needs more.
+// Columns given per feature instead of in the header are not supported.
+class FeatureSourceFlatGeobuf : public FeatureSource {
+ private:
+  std::shared_ptr<const void> owner_;
+  std::shared_ptr<const FlatGeobufSchema> schema_;
+  FlatTable feature_;
+  std::shared_ptr<GeometryCache> cache_;
+  mutable std::unique_ptr<LazyGeometry> geometry_;
+  mutable bool geometry_read_ = false;
+  mutable geos::geom::Envelope envelope_;
+  mutable bool envelope_read_ = false;
+
+  template <typename T>
+  static void Put(T value, std::string* wkb) {
+    wkb->append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  struct Coordinates {
+    const uint8_t* xy = nullptr;
+    const uint8_t* z = nullptr;
+    size_t size = 0;      // number of points
+    bool with_z = false;  // write z, NaN where there is none
+  };
+
+  static Coordinates Points(const FlatTable& g, bool has_z) {
+    Coordinates c;
+    size_t length = 0;
+    if (not g.Vector(1, sizeof(double), &c.xy, &length)) return c;
+    c.size = length / 2;
+    size_t z_length;
+    if (not has_z or not g.Vector(2, sizeof(double), &c.z, &z_length) or
+        z_length != c.size)
+      c.z = nullptr;
+    c.with_z = c.z != nullptr;
+    return c;
+  }
+
+  static void PutPoint(const Coordinates& c, size_t i, std::string* wkb) {
+    wkb->append(reinterpret_cast<const char*>(c.xy + 16 * i), 16);
+    if (not c.with_z) return;
+    if (c.z != nullptr)
+      wkb->append(reinterpret_cast<const char*>(c.z + 8 * i), 8);
+    else
+      Put<double>(NAN, wkb);
+  }
+
+  static void PutHeader(uint32_t type, const Coordinates& c, std::string* wkb) {
+    Put<uint8_t>(1, wkb);  // little endian
+    Put<uint32_t>(type + (c.with_z ? 1000 : 0), wkb);
+  }
+
+  static void PutLine(const Coordinates& c, size_t begin, size_t end,
+                      std::string* wkb) {
+    Put<uint32_t>(end - begin, wkb);
+    for (size_t i = begin; i < end; i++) PutPoint(c, i, wkb);
+  }
+
+  // ranges of points of rings or lines, all points if there are no ends
+  static std::vector<std::pair<size_t, size_t>> Parts(const FlatTable& g,
+                                                      size_t points) {
+    std::vector<std::pair<size_t, size_t>> parts;
+    const uint8_t* ends;
+    size_t length;
+    if (not g.Vector(0, sizeof(uint32_t), &ends, &length) or length == 0) {
+      if (points > 0) parts.emplace_back(0, points);
+      return parts;
+    }
+    size_t begin = 0;
+    for (size_t i = 0; i < length; i++) {
+      size_t end = std::min<size_t>(FlatTable::Read<uint32_t>(ends + 4 * i),
+                                    points);
+      if (end < begin) return {};
+      parts.emplace_back(begin, end);
+      begin = end;
+    }
+    return parts;
+  }
+
+  // a Json column as FeatureSourceMapped converts JSON, so arrays are arrays
+  static ValueT JsonValue(std::string_view text) {
+    size_t begin = text.find_first_not_of(" \t\r\n");
+    if (begin == std::string_view::npos) return NullValue;
+    text = text.substr(begin, text.find_last_not_of(" \t\r\n") - begin + 1);
+    return FeatureSourceMapped::Value(text);
+  }
+
+ public:
+  FeatureSourceFlatGeobuf(std::shared_ptr<const void> owner,
+                          std::shared_ptr<const FlatGeobufSchema> schema,
+                          const uint8_t* feature, size_t size,
+                          std::shared_ptr<GeometryCache> cache = nullptr)
+      : owner_(std::move(owner)),
+        schema_(std::move(schema)),
+        feature_(FlatTable::Root(feature, size)),
+        cache_(std::move(cache)) {}
+
+  // Append a geometry table as ISO WKB with z if it has one. The type of a
+  // geometry is given by the header unless that is unknown (0). Parts of a
+  // collection are written with z if the collection is, given by with_z.
+  static bool ToWkb(const FlatTable& g, uint8_t type, bool has_z,
+                    std::string* wkb,
+                    std::optional<bool> with_z = std::nullopt) {
+    if (not g.valid()) return false;
+    if (type == 0) type = g.Scalar<uint8_t>(6, 0);
+    Coordinates c = Points(g, has_z);
+    if (with_z.has_value()) c.with_z = *with_z;
+    switch (type) {
+      case 1: {  // Point
+        PutHeader(type, c, wkb);
+        if (c.size > 0) {
+          PutPoint(c, 0, wkb);
+        } else {
+          for (int i = 0; i < (c.with_z ? 3 : 2); i++)
+            Put<double>(NAN, wkb);
+        }
+        return true;
+      }
+      case 2:  // LineString
+        PutHeader(type, c, wkb);
+        PutLine(c, 0, c.size, wkb);
+        return true;
+      case 3: {  // Polygon
+        PutHeader(type, c, wkb);
+        auto rings = Parts(g, c.size);
+        Put<uint32_t>(rings.size(), wkb);
+        for (auto [begin, end] : rings) PutLine(c, begin, end, wkb);
+        return true;
+      }
+      case 4:  // MultiPoint
+        PutHeader(type, c, wkb);
+        Put<uint32_t>(c.size, wkb);
+        for (size_t i = 0; i < c.size; i++) {
+          PutHeader(1, c, wkb);
+          PutPoint(c, i, wkb);
+        }
+        return true;
+      case 5: {  // MultiLineString
+        PutHeader(type, c, wkb);
+        auto lines = Parts(g, c.size);
+        Put<uint32_t>(lines.size(), wkb);
+        for (auto [begin, end] : lines) {
+          PutHeader(2, c, wkb);
+          PutLine(c, begin, end, wkb);
+        }
+        return true;
+      }
+      case 6:    // MultiPolygon
+      case 7: {  // GeometryCollection
+        auto parts = g.Tables(7);
+        bool z = with_z.value_or(has_z);
+        Put<uint8_t>(1, wkb);
+        Put<uint32_t>(type + (z ? 1000 : 0), wkb);
+        Put<uint32_t>(parts.size(), wkb);
+        for (const auto& part : parts)
+          if (not ToWkb(part, type == 6 ? 3 : 0, has_z, wkb, z)) return false;
+        return true;
+      }
+      default:  // curves, surfaces and TIN are not supported
+        return false;
+    }
+  }
+
+  // envelope of the xy of a geometry table and its parts
+  static void ExpandEnvelope(const FlatTable& g, geos::geom::Envelope* env) {
+    Coordinates c = Points(g, false);
+    for (size_t i = 0; i < c.size; i++)
+      env->expandToInclude(FlatTable::Read<double>(c.xy + 16 * i),
+                           FlatTable::Read<double>(c.xy + 16 * i + 8));
+    for (const auto& part : g.Tables(7)) ExpandEnvelope(part, env);
+  }
+
+  const FlatTable& table() const { return feature_; }
+
+  bool get_envelope(const std::string& property_path,
+                    geos::geom::Envelope* envelope) const override {
+    if (property_path != "geom" or not feature_.Table(0).valid()) return false;
+    if (not envelope_read_) {
+      envelope_read_ = true;
+      ExpandEnvelope(feature_.Table(0), &envelope_);
+    }
+    *envelope = envelope_;
+    return true;
+  }
+
+  // geom without decoding the geometry
+  bool is_null(const std::string& property_path) const override {
+    if (property_path == "geom") return not feature_.Table(0).valid();
+    return FeatureSource::is_null(property_path);
+  }
+
+  ValueT get_property(const std::string& property_path) const override {
+    // Annex A: Abstract Test Suite (Normative)
+    // "the queryable for the feature geometry is geom"
+    if (property_path == "geom") {
+      if (not geometry_read_) {
+        geometry_read_ = true;
+        std::string wkb;
+        geos::geom::Envelope envelope;
+        if (ToWkb(feature_.Table(0), schema_->geometry_type, schema_->has_z,
+                  &wkb) and
+            get_envelope(property_path, &envelope))
+          geometry_ = std::make_unique<LazyGeometry>(std::move(wkb), envelope,
+                                                     cache_);
+      }
+      const geos::geom::Geometry* geometry =
+          geometry_ == nullptr ? nullptr : GeometryPins::Pin(geometry_->get());
+      if (geometry == nullptr) return NullValue;
+      return geometry;
+    }
+
+    auto column = schema_->columns.find(property_path);
+    if (column == schema_->columns.end()) return NullValue;
+    const uint8_t* data;
+    size_t length;
+    if (not feature_.Vector(1, 1, &data, &length)) return NullValue;
+
+    // pairs of a column index and its value, in any order
+    size_t pos = 0;
+    while (pos + 2 <= length) {
+      uint16_t index = FlatTable::Read<uint16_t>(data + pos);
+      pos += 2;
+      if (index >= schema_->types.size()) return NullValue;
+      const uint8_t* p = data + pos;
+      size_t width;
+      FlatGeobufType type = schema_->types.at(index);
+      switch (type) {
+        case FlatGeobufType::Byte:
+        case FlatGeobufType::UByte:
+        case FlatGeobufType::Bool:
+          width = 1;
+          break;
+        case FlatGeobufType::Short:
+        case FlatGeobufType::UShort:
+          width = 2;
+          break;
+        case FlatGeobufType::Int:
+        case FlatGeobufType::UInt:
+        case FlatGeobufType::Float:
+          width = 4;
+          break;
+        case FlatGeobufType::Long:
+        case FlatGeobufType::ULong:
+        case FlatGeobufType::Double:
+          width = 8;
+          break;
+        default:  // prefixed by the length
+          if (pos + 4 > length) return NullValue;
+          width = 4 + FlatTable::Read<uint32_t>(p);
+      }
+      if (pos + width > length) return NullValue;
+      pos += width;
+      if (index != column->second) continue;
+
+      switch (type) {
+        case FlatGeobufType::Byte:
+          return int64_t(FlatTable::Read<int8_t>(p));
+        case FlatGeobufType::UByte:
+          return uint64_t(FlatTable::Read<uint8_t>(p));
+        case FlatGeobufType::Bool:
+          return FlatTable::Read<uint8_t>(p) != 0;
+        case FlatGeobufType::Short:
+          return int64_t(FlatTable::Read<int16_t>(p));
+        case FlatGeobufType::UShort:
+          return uint64_t(FlatTable::Read<uint16_t>(p));
+        case FlatGeobufType::Int:
+          return int64_t(FlatTable::Read<int32_t>(p));
+        case FlatGeobufType::UInt:
+          return uint64_t(FlatTable::Read<uint32_t>(p));
+        case FlatGeobufType::Long:
+          return FlatTable::Read<int64_t>(p);
+        case FlatGeobufType::ULong:
+          return FlatTable::Read<uint64_t>(p);
+        case FlatGeobufType::Float:
+          return double(FlatTable::Read<float>(p));
+        case FlatGeobufType::Double:
+          return FlatTable::Read<double>(p);
+        case FlatGeobufType::String:
+        case FlatGeobufType::DateTime:
+          return std::string_view(reinterpret_cast<const char*>(p + 4),
+                                  width - 4);
+        case FlatGeobufType::Json:
+          return JsonValue(std::string_view(
+              reinterpret_cast<const char*>(p + 4), width - 4));
+        default:
+          return NullValue;
+      }
+    }
+    return NullValue;
+  }
+};
+
+}  // namespace cql2cpp
@@ -14,18 +14,26 @@
 #include <geos/io/GeoJSONWriter.h>
 
 #include "feature_source_json.h"
+#include "lazy_geometry.h"
 
 namespace cql2cpp {
 
+// A feature of a GeoJSONFeatureCollection. Its geometry is kept as WKB with
+// its envelope, so the collection can be released once the features are
+// created and predicates rejected by the envelope build no geometry. It may
+// be evaluated from several threads, see LazyGeometry.
 class FeatureSourceGeoJson : public FeatureSourceJson {
  private:
-  const geos::io::GeoJSONFeature& feature_;
+  std::unique_ptr<LazyGeometry> geometry_;
 
  public:
-  FeatureSourceGeoJson(const geos::io::GeoJSONFeature& feature)
-      : FeatureSourceJson(geos_nlohmann::json::object()), feature_(feature) {
+  FeatureSourceGeoJson(const geos::io::GeoJSONFeature& feature,
+                       std::shared_ptr<GeometryCache> cache = nullptr)
+      : FeatureSourceJson(geos_nlohmann::json::object()) {
+    if (feature.getGeometry() != nullptr)
+      geometry_ = std::make_unique<LazyGeometry>(*feature.getGeometry(), cache);
     geos::io::GeoJSONWriter writer;
-    std::string serialized = writer.write(feature_);
+    std::string serialized = writer.write(feature);
     geos_nlohmann::json j = geos_nlohmann::json::parse(serialized);
     if (j.contains("properties"))
       json_ = j.at("properties");
@@ -35,10 +43,28 @@ class FeatureSourceGeoJson : public FeatureSourceJson {
   ValueT get_property(const std::string& property_path) const override {
     // Annex A: Abstract Test Suite (Normative)
     // "the queryable for the feature geometry is geom"
-    if (property_path == "geom")
-      return feature_.getGeometry();
-    else
-      return FeatureSourceJson::get_property(property_path);
+    if (property_path == "geom") {
+      const geos::geom::Geometry* geometry =
+          geometry_ == nullptr ? nullptr : GeometryPins::Pin(geometry_->get());
+      if (geometry == nullptr) return NullValue;
+      return geometry;
+    }
+    return FeatureSourceJson::get_property(property_path);
+  }
+
+  // geom without building the geometry
+  bool is_null(const std::string& property_path) const override {
+    if (property_path == "geom") return geometry_ == nullptr;
+    return FeatureSourceJson::is_null(property_path);
+  }
+
+  bool get_envelope(const std::string& property_path,
+                    geos::geom::Envelope* envelope) const override {
+    if (property_path != "geom")
+      return FeatureSourceJson::get_envelope(property_path, envelope);
+    if (geometry_ == nullptr) return false;
+    *envelope = geometry_->envelope();
+    return true;
   }
 };
 
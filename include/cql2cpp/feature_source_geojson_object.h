@@ -0,0 +1,81 @@
+/*
+ * File Name: feature_source_geojson_object.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/27
+ *
+ */
+
+#pragma once
+
+#include <geos/geom/Geometry.h>
+#include <geos/io/GeoJSONReader.h>
+#include <glog/logging.h>
+
+#include "feature_source_json.h"
+#include "lazy_geometry.h"
+
+namespace cql2cpp {
+
+// A GeoJSON Feature object as parsed JSON, e.g. from GeoJsonStreamReader.
+// Unlike FeatureSourceGeoJson it does not need a GeoJSONFeatureCollection.
+// The geometry is parsed once and also kept as WKB with its envelope, so a
+// GeometryCache can drop the parsed one.
+class FeatureSourceGeoJsonObject : public FeatureSourceJson {
+ private:
+  std::unique_ptr<LazyGeometry> geometry_;
+
+  static geos_nlohmann::json Properties(const geos_nlohmann::json& feature) {
+    if (feature.contains("properties") and feature.at("properties").is_object())
+      return feature.at("properties");
+    return geos_nlohmann::json::object();
+  }
+
+ public:
+  FeatureSourceGeoJsonObject(const geos_nlohmann::json& feature,
+                             std::shared_ptr<GeometryCache> cache = nullptr)
+      : FeatureSourceJson(Properties(feature)) {
+    if (not feature.contains("geometry") or feature.at("geometry").is_null())
+      return;
+    try {
+      auto geometry =
+          geos::io::GeoJSONReader().read(feature.at("geometry").dump());
+      if (geometry != nullptr)
+        geometry_ =
+            std::make_unique<LazyGeometry>(std::move(geometry), cache);
+    } catch (const std::exception& e) {
+      LOG(WARNING) << "invalid geometry: " << e.what();
+    }
+  }
+
+  ValueT get_property(const std::string& property_path) const override {
+    // Annex A: Abstract Test Suite (Normative)
+    // "the queryable for the feature geometry is geom"
+    if (property_path == "geom") {
+      const geos::geom::Geometry* geometry =
+          geometry_ == nullptr ? nullptr : GeometryPins::Pin(geometry_->get());
+      if (geometry == nullptr) return NullValue;
+      return geometry;
+    }
+    return FeatureSourceJson::get_property(property_path);
+  }
+
+  // geom without building the geometry
+  bool is_null(const std::string& property_path) const override {
+    if (property_path == "geom") return geometry_ == nullptr;
+    return FeatureSourceJson::is_null(property_path);
+  }
+
+  bool get_envelope(const std::string& property_path,
+                    geos::geom::Envelope* envelope) const override {
+    if (property_path != "geom")
+      return FeatureSourceJson::get_envelope(property_path, envelope);
+    if (geometry_ == nullptr) return false;
+    *envelope = geometry_->envelope();
+    return true;
+  }
+};
+
+}  // namespace cql2cpp
@@ -24,6 +24,9 @@ class FeatureSourceJson : public FeatureSource {
  public:
   FeatureSourceJson(const geos_nlohmann::json& json) : json_(json) {}
 
+  // change properties in place, then tell Cql2Cpp::Notify which ones
+  geos_nlohmann::json& json() { return json_; }
+
   ValueT get_property(const geos_nlohmann::json& json) const {
     switch (json.type()) {
       case geos_nlohmann::json::value_t::null:
@@ -66,6 +69,14 @@ class FeatureSourceJson : public FeatureSource {
     else
       return get_property(*value);
   }
+
+  // objects are null as in get_property
+  bool is_null(const std::string& property_path) const override {
+    const geos_nlohmann::json* value =
+        JsonHelper::get_property(property_path, json_);
+    return value == nullptr or value->is_null() or value->is_object() or
+           value->is_discarded();
+  }
 };
 
 }  // namespace cql2cpp
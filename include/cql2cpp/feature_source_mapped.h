@@ -0,0 +1,169 @@
+/*
+ * File Name: feature_source_mapped.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/28
+ *
+ */
+
+#pragma once
+
+#include <geos/geom/Geometry.h>
+#include <geos/io/GeoJSONReader.h>
+#include <glog/logging.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "feature_source.h"
+#include "json_span.h"
+
+namespace cql2cpp {
+
+// A GeoJSON Feature read in place from its text, e.g. in a MappedFile.
+// Properties are looked up when they are asked for, strings without escapes
+// are returned as views into the text and the geometry is parsed the first
+// time it is used. The owner keeps the text alive as long as the feature.
+class FeatureSourceMapped : public FeatureSource {
+ private:
+  std::shared_ptr<const void> owner_;
+  std::string_view text_;
+  std::string_view properties_;
+  std::string_view geometry_;
+  mutable std::unique_ptr<geos::geom::Geometry> geometry_parsed_;
+  mutable bool geometry_read_ = false;
+
+  // the text of a property, nested properties being separated by dots
+  bool Find(const std::string& property_path, std::string_view* value) const {
+    std::string_view current = properties_;
+    std::string_view path = property_path;
+    while (not current.empty()) {
+      size_t dot = path.find('.');
+      if (not JsonSpan::FindMember(current, path.substr(0, dot), value))
+        return false;
+      if (dot == std::string_view::npos) return true;
+      if (value->front() != '{') return false;
+      current = *value;
+      path = path.substr(dot + 1);
+    }
+    return false;
+  }
+
+  static ValueT Number(std::string_view text) {
+    char buffer[64];
+    if (text.size() >= sizeof(buffer)) return NullValue;
+    text.copy(buffer, text.size());
+    buffer[text.size()] = '\0';
+    char* end;
+    // like geos_nlohmann::json, integers are signed only if negative
+    if (text.find_first_of(".eE") == std::string_view::npos) {
+      errno = 0;
+      if (text.front() == '-') {
+        int64_t i = std::strtoll(buffer, &end, 10);
+        if (errno == 0 and *end == '\0') return i;
+      } else {
+        uint64_t u = std::strtoull(buffer, &end, 10);
+        if (errno == 0 and *end == '\0') return u;
+      }
+    }
+    double d = std::strtod(buffer, &end);
+    if (*end != '\0') return NullValue;
+    return d;
+  }
+
+ public:
+  FeatureSourceMapped(std::shared_ptr<const void> owner, std::string_view text)
+      : owner_(std::move(owner)), text_(text) {
+    JsonSpan::ForEachMember(text_, [this](auto key, auto value) {
+      if (key == "properties" and value.front() == '{')
+        properties_ = value;
+      else if (key == "geometry" and value.front() == '{')
+        geometry_ = value;
+      return true;
+    });
+  }
+
+  // the text of the feature as it is in the input
+  std::string_view text() const { return text_; }
+
+  // convert a JSON value like FeatureSourceJson does
+  static ValueT Value(std::string_view text) {
+    switch (text.front()) {
+      case '"': {
+        std::string_view raw = text.substr(1, text.size() - 2);
+        if (raw.find('\\') == std::string_view::npos) return raw;
+        return JsonSpan::Unescape(raw);
+      }
+      case 't':
+        return true;
+      case 'f':
+        return false;
+      case 'n':
+        return NullValue;
+      case '{':
+        return NullValue;
+      case '[': {
+        ArrayType array;
+        JsonSpan::ForEachElement(text, [&array](auto element) {
+          ValueT value = Value(element);
+          if (not std::holds_alternative<NullStruct>(value))
+            array.emplace_back(value);
+          return true;
+        });
+        return array;
+      }
+      default:
+        return Number(text);
+    }
+  }
+
+  ValueT get_property(const std::string& property_path) const override {
+    // Annex A: Abstract Test Suite (Normative)
+    // "the queryable for the feature geometry is geom"
+    if (property_path == "geom") {
+      if (not geometry_read_) {
+        geometry_read_ = true;
+        if (not geometry_.empty()) {
+          try {
+            geometry_parsed_ =
+                geos::io::GeoJSONReader().read(std::string(geometry_));
+          } catch (const std::exception& e) {
+            LOG(WARNING) << "invalid geometry: " << e.what();
+          }
+        }
+      }
+      if (geometry_parsed_ == nullptr) return NullValue;
+      return static_cast<const geos::geom::Geometry*>(geometry_parsed_.get());
+    }
+
+    std::string_view value;
+    if (not Find(property_path, &value)) return NullValue;
+    return Value(value);
+  }
+
+  // without converting the value, arrays in particular, or parsing geom
+  bool is_null(const std::string& property_path) const override {
+    if (property_path == "geom") return geometry_.empty();
+    std::string_view value;
+    if (not Find(property_path, &value)) return true;
+    switch (value.front()) {
+      case 'n':
+      case '{':
+        return true;
+      case '"':
+      case 't':
+      case 'f':
+      case '[':
+        return false;
+      default:
+        return std::holds_alternative<NullStruct>(Number(value));
+    }
+  }
+};
+
+}  // namespace cql2cpp
@@ -0,0 +1,128 @@
+/*
+ * File Name: flat_table.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/30
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace cql2cpp {
+
+// Read a table of a FlatBuffers buffer without generated code. Fields are
+// addressed by their index in the schema. Every offset is checked against
+// the buffer, so a field out of range reads as absent. Little endian hosts
+// only, like the buffers themselves.
+class FlatTable {
+ private:
+  const uint8_t* buf_ = nullptr;
+  size_t size_ = 0;
+  size_t table_ = 0;
+  size_t vtable_ = 0;
+  uint16_t vtable_size_ = 0;
+
+  // position of field i in the buffer, 0 if it is absent
+  size_t Field(int i) const {
+    size_t entry = 4 + 2 * static_cast<size_t>(i);
+    if (buf_ == nullptr or entry + 2 > vtable_size_) return 0;
+    uint16_t offset = Read<uint16_t>(buf_ + vtable_ + entry);
+    if (offset == 0 or table_ + offset >= size_) return 0;
+    return table_ + offset;
+  }
+
+  // position an offset field at pos refers to, 0 if out of range
+  size_t Deref(size_t pos) const {
+    if (pos == 0 or pos + 4 > size_) return 0;
+    uint32_t offset = Read<uint32_t>(buf_ + pos);
+    if (offset == 0 or pos + offset >= size_) return 0;
+    return pos + offset;
+  }
+
+ public:
+  template <typename T>
+  static T Read(const uint8_t* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+  }
+
+  FlatTable() = default;
+
+  // the table at pos of a buffer
+  FlatTable(const uint8_t* buf, size_t size, size_t pos) {
+    if (pos == 0 or pos + 4 > size) return;
+    int64_t vtable = static_cast<int64_t>(pos) - Read<int32_t>(buf + pos);
+    if (vtable < 0 or static_cast<size_t>(vtable) + 4 > size) return;
+    uint16_t vtable_size = Read<uint16_t>(buf + vtable);
+    if (vtable_size < 4 or static_cast<size_t>(vtable) + vtable_size > size)
+      return;
+    buf_ = buf;
+    size_ = size;
+    table_ = pos;
+    vtable_ = vtable;
+    vtable_size_ = vtable_size;
+  }
+
+  // the root table of a buffer
+  static FlatTable Root(const uint8_t* buf, size_t size) {
+    if (size < 4) return FlatTable();
+    return FlatTable(buf, size, Read<uint32_t>(buf));
+  }
+
+  bool valid() const { return buf_ != nullptr; }
+
+  template <typename T>
+  T Scalar(int i, T default_value) const {
+    size_t pos = Field(i);
+    if (pos == 0 or pos + sizeof(T) > size_) return default_value;
+    return Read<T>(buf_ + pos);
+  }
+
+  // the elements of a vector of scalars or structs, read them with Read
+  bool Vector(int i, size_t element_size, const uint8_t** data,
+              size_t* length) const {
+    size_t pos = Deref(Field(i));
+    if (pos == 0 or pos + 4 > size_) return false;
+    uint32_t n = Read<uint32_t>(buf_ + pos);
+    if (pos + 4 + static_cast<uint64_t>(n) * element_size > size_) return false;
+    *data = buf_ + pos + 4;
+    *length = n;
+    return true;
+  }
+
+  // empty if absent
+  std::string_view String(int i) const {
+    const uint8_t* data;
+    size_t length;
+    if (not Vector(i, 1, &data, &length)) return std::string_view();
+    return std::string_view(reinterpret_cast<const char*>(data), length);
+  }
+
+  // invalid if absent
+  FlatTable Table(int i) const {
+    size_t pos = Deref(Field(i));
+    return pos == 0 ? FlatTable() : FlatTable(buf_, size_, pos);
+  }
+
+  std::vector<FlatTable> Tables(int i) const {
+    std::vector<FlatTable> tables;
+    const uint8_t* data;
+    size_t length;
+    if (not Vector(i, 4, &data, &length)) return tables;
+    for (size_t k = 0; k < length; k++) {
+      size_t pos = Deref(data - buf_ + 4 * k);
+      if (pos != 0) tables.emplace_back(buf_, size_, pos);
+    }
+    return tables;
+  }
+};
+
+}  // namespace cql2cpp
@@ -0,0 +1,294 @@
+/*
+ * File Name: flatgeobuf_reader.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/30
+ *
+ */
+
+#pragma once
+
+#include <geos/geom/Envelope.h>
+#include <geos/geom/Geometry.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ast_node.h"
+#include "feature_source_flatgeobuf.h"
+#include "flat_table.h"
+#include "mapped_file.h"
+
+namespace cql2cpp {
+
+// Read the features of a FlatGeobuf file in place from a MappedFile. With
+// a window only the features found by the packed Hilbert R-tree of the file
+// are read, or by the envelopes of their geometries if it has no index.
+// https://flatgeobuf.org
+class FlatGeobufReader {
+ private:
+  static constexpr uint8_t kMagic[] = {'f', 'g', 'b', 3, 'f', 'g', 'b'};
+  static constexpr size_t kNodeItemSize = 40;  // 4 doubles and an offset
+
+  std::shared_ptr<const void> owner_;
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  std::shared_ptr<FlatGeobufSchema> schema_;
+  uint64_t features_count_ = 0;
+  uint16_t index_node_size_ = 0;
+  geos::geom::Envelope extent_;
+  size_t index_offset_ = 0;
+  size_t index_size_ = 0;
+  size_t features_offset_ = 0;
+  size_t decoded_ = 0;
+  std::shared_ptr<GeometryCache> cache_;
+  std::string error_msg_;
+
+  // first and last + 1 node of each level of the tree, leaves first
+  static std::vector<std::pair<uint64_t, uint64_t>> LevelBounds(
+      uint64_t items, uint16_t node_size) {
+    std::vector<uint64_t> level_nodes = {items};
+    uint64_t n = items;
+    uint64_t nodes = n;
+    do {
+      n = (n + node_size - 1) / node_size;
+      nodes += n;
+      level_nodes.emplace_back(n);
+    } while (n != 1);
+    std::vector<std::pair<uint64_t, uint64_t>> bounds;
+    for (uint64_t level : level_nodes) {
+      nodes -= level;
+      bounds.emplace_back(nodes, nodes + level);
+    }
+    return bounds;
+  }
+
+  // byte offsets of the features from the start of the features section,
+  // in the order of the file
+  void SearchIndex(const geos::geom::Envelope& window,
+                   std::vector<uint64_t>* offsets) const {
+    auto bounds = LevelBounds(features_count_, index_node_size_);
+    uint64_t leaves = bounds.front().first;
+    const uint8_t* nodes = data_ + index_offset_;
+    std::map<uint64_t, size_t> queue = {{0, bounds.size() - 1}};
+    while (not queue.empty()) {
+      auto [first, level] = *queue.begin();
+      queue.erase(queue.begin());
+      uint64_t end = std::min<uint64_t>(first + index_node_size_,
+                                        bounds.at(level).second);
+      for (uint64_t i = first; i < end; i++) {
+        const uint8_t* node = nodes + i * kNodeItemSize;
+        geos::geom::Envelope env(FlatTable::Read<double>(node),
+                                 FlatTable::Read<double>(node + 16),
+                                 FlatTable::Read<double>(node + 8),
+                                 FlatTable::Read<double>(node + 24));
+        if (not env.intersects(window)) continue;
+        uint64_t offset = FlatTable::Read<uint64_t>(node + 32);
+        if (first >= leaves)
+          offsets->emplace_back(offset);
+        else if (level > 0 and offset < leaves + features_count_)
+          queue.emplace(offset, level - 1);
+      }
+    }
+    std::sort(offsets->begin(), offsets->end());
+  }
+
+  // the feature at a byte offset from the start of the features section
+  bool Feature(uint64_t offset, const uint8_t** feature, size_t* size) const {
+    size_t pos = features_offset_ + offset;
+    if (offset >= size_ or pos + 4 > size_) return false;
+    *size = FlatTable::Read<uint32_t>(data_ + pos);
+    *feature = data_ + pos + 4;
+    return pos + 4 + *size <= size_;
+  }
+
+ public:
+  bool Open(const std::string& path) {
+    std::shared_ptr<const MappedFile> file = MappedFile::Open(path, &error_msg_);
+    if (file == nullptr) return false;
+    std::string_view text = file->text();
+    return Open(file, reinterpret_cast<const uint8_t*>(text.data()),
+                text.size());
+  }
+
+  // read a file already in memory, the owner keeps it alive
+  bool Open(std::shared_ptr<const void> owner, const uint8_t* data,
+            size_t size) {
+    owner_ = std::move(owner);
+    data_ = data;
+    size_ = size;
+    error_msg_.clear();
+    if (size_ < 12 or not std::equal(kMagic, kMagic + 3, data_) or
+        data_[3] != kMagic[3] or
+        not std::equal(kMagic + 4, kMagic + 7, data_ + 4)) {
+      error_msg_ = "not a FlatGeobuf file of version 3";
+      return false;
+    }
+    uint32_t header_size = FlatTable::Read<uint32_t>(data_ + 8);
+    if (12 + static_cast<uint64_t>(header_size) > size_) {
+      error_msg_ = "truncated FlatGeobuf header";
+      return false;
+    }
+    FlatTable header = FlatTable::Root(data_ + 12, header_size);
+    if (not header.valid()) {
+      error_msg_ = "invalid FlatGeobuf header";
+      return false;
+    }
+
+    schema_ = std::make_shared<FlatGeobufSchema>();
+    schema_->geometry_type = header.Scalar<uint8_t>(2, 0);
+    schema_->has_z = header.Scalar<uint8_t>(3, 0) != 0;
+    std::vector<FlatTable> columns = header.Tables(7);
+    for (size_t i = 0; i < columns.size(); i++) {
+      schema_->types.emplace_back(
+          static_cast<FlatGeobufType>(columns.at(i).Scalar<uint8_t>(1, 0)));
+      schema_->columns.emplace(columns.at(i).String(0), i);
+    }
+    features_count_ = header.Scalar<uint64_t>(8, 0);
+    index_node_size_ = header.Scalar<uint16_t>(9, 16);
+
+    extent_.setToNull();
+    const uint8_t* envelope;
+    size_t length;
+    if (header.Vector(1, sizeof(double), &envelope, &length) and length >= 4)
+      extent_ = geos::geom::Envelope(FlatTable::Read<double>(envelope),
+                                     FlatTable::Read<double>(envelope + 16),
+                                     FlatTable::Read<double>(envelope + 8),
+                                     FlatTable::Read<double>(envelope + 24));
+
+    index_offset_ = 12 + header_size;
+    index_size_ = 0;
+    if (index_node_size_ >= 2 and features_count_ > 0) {
+      auto bounds = LevelBounds(features_count_, index_node_size_);
+      index_size_ = bounds.front().second * kNodeItemSize;
+    }
+    features_offset_ = index_offset_ + index_size_;
+    if (features_offset_ > size_) {
+      error_msg_ = "truncated FlatGeobuf index";
+      return false;
+    }
+    return true;
+  }
+
+  // The envelope a query restricts geom to, by its top level conjuncts of
+  // spatial predicates other than S_DISJOINT against a literal. False if
+  // the query does not restrict geom.
+  static bool Window(const AstNodePtr& root, geos::geom::Envelope* window) {
+    if (root->type() == BoolExpr and root->op() == And) {
+      bool found = false;
+      for (const auto& child : root->children()) {
+        geos::geom::Envelope env;
+        if (not Window(child, &env)) continue;
+        if (found) {
+          geos::geom::Envelope overlap;
+          if (not window->intersection(env, overlap)) overlap.setToNull();
+          env = overlap;
+        }
+        *window = env;
+        found = true;
+      }
+      return found;
+    }
+    if (root->type() != SpatialPred or root->op() == S_Disjoint or
+        root->children().size() != 2)
+      return false;
+    for (int i = 0; i < 2; i++) {
+      const AstNodePtr& property = root->children().at(i);
+      const AstNodePtr& other = root->children().at(1 - i);
+      if (property->type() != PropertyName or
+          not std::holds_alternative<std::string>(property->origin_value()) or
+          std::get<std::string>(property->origin_value()) != "geom" or
+          not other->constant())
+        continue;
+      const ValueT& value = other->origin_value();
+      if (std::holds_alternative<const geos::geom::Geometry*>(value) and
+          std::get<const geos::geom::Geometry*>(value) != nullptr) {
+        *window =
+            *std::get<const geos::geom::Geometry*>(value)->getEnvelopeInternal();
+        return true;
+      }
+      if (std::holds_alternative<const geos::geom::Envelope*>(value) and
+          std::get<const geos::geom::Envelope*>(value) != nullptr) {
+        *window = *std::get<const geos::geom::Envelope*>(value);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Create a feature source for every feature whose geometry envelope
+  // intersects the window, or for all features without a window.
+  bool Load(std::vector<FeatureSourcePtr>* features,
+            const geos::geom::Envelope* window = nullptr) {
+    decoded_ = 0;
+    if (window != nullptr and window->isNull()) return true;
+
+    auto add = [&](const uint8_t* feature, size_t size) {
+      features->emplace_back(std::make_shared<FeatureSourceFlatGeobuf>(
+          owner_, schema_, feature, size, cache_));
+      decoded_++;
+    };
+    const uint8_t* feature;
+    size_t size;
+
+    if (window != nullptr and index_size_ > 0) {
+      std::vector<uint64_t> offsets;
+      SearchIndex(*window, &offsets);
+      for (uint64_t offset : offsets) {
+        if (not Feature(offset, &feature, &size)) {
+          error_msg_ = "feature out of range at " + std::to_string(offset);
+          return false;
+        }
+        add(feature, size);
+      }
+      return true;
+    }
+
+    // a stream of size prefixed features without index
+    for (uint64_t offset = 0; features_offset_ + offset < size_;
+         offset += 4 + size) {
+      if (not Feature(offset, &feature, &size)) {
+        error_msg_ = "feature out of range at " + std::to_string(offset);
+        return false;
+      }
+      if (window != nullptr) {
+        geos::geom::Envelope env;
+        FeatureSourceFlatGeobuf::ExpandEnvelope(
+            FlatTable::Root(feature, size).Table(0), &env);
+        if (not env.intersects(*window)) continue;
+      }
+      add(feature, size);
+    }
+    return true;
+  }
+
+  // only the features a query can select by its spatial window
+  bool Load(const AstNodePtr& root, std::vector<FeatureSourcePtr>* features) {
+    geos::geom::Envelope window;
+    return Load(features, Window(root, &window) ? &window : nullptr);
+  }
+
+  // bound the geometries the loaded features keep built, nullptr for no bound
+  void set_geometry_cache(std::shared_ptr<GeometryCache> cache) {
+    cache_ = std::move(cache);
+  }
+
+  // the number of features in the file, by its header
+  uint64_t features_count() const { return features_count_; }
+
+  // the number of feature sources created by the last Load
+  size_t decoded() const { return decoded_; }
+
+  bool has_index() const { return index_size_ > 0; }
+
+  const geos::geom::Envelope& extent() const { return extent_; }
+
+  const std::string& error_msg() const { return error_msg_; }
+};
+
+}  // namespace cql2cpp
@@ -0,0 +1,561 @@
+/*
+ * File Name: flatgeobuf_writer.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/02
+ *
+ */
+
+#pragma once
+
+#include <geos/geom/Envelope.h>
+#include <geos/vend/include_nlohmann_json.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <numeric>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "feature_source_flatgeobuf.h"
+#include "flat_table.h"
+#include "value.h"
+
+namespace cql2cpp {
+
+// Write a FlatBuffers buffer front to back. A table is followed by the
+// vectors and tables it refers to, so all offsets point forward. Little
+// endian hosts only, like FlatTable.
+class FlatBuilder {
+ public:
+  // a field of a table: an inline scalar, or an offset to a vector, a
+  // table or a vector of tables
+  struct Field {
+    enum Kind { Scalar, Vector, Table, Tables };
+    Kind kind;
+    int index;
+    std::string bytes;  // of the scalar or of the elements of the vector
+    size_t align = 1;   // of the scalar or of an element
+    uint32_t length = 0;
+    bool terminated = false;  // a string has a 0 after its bytes
+    std::vector<std::vector<Field>> tables;
+  };
+  using Fields = std::vector<Field>;
+
+  template <typename T>
+  static Field Of(int index, T value) {
+    Field f{Field::Scalar, index};
+    f.bytes.assign(reinterpret_cast<const char*>(&value), sizeof(T));
+    f.align = sizeof(T);
+    return f;
+  }
+
+  template <typename T>
+  static Field VectorOf(int index, const std::vector<T>& elements) {
+    Field f{Field::Vector, index};
+    f.bytes.assign(reinterpret_cast<const char*>(elements.data()),
+                   elements.size() * sizeof(T));
+    f.align = sizeof(T);
+    f.length = elements.size();
+    return f;
+  }
+
+  static Field StringOf(int index, std::string_view s) {
+    Field f{Field::Vector, index, std::string(s), 1,
+            static_cast<uint32_t>(s.size())};
+    f.terminated = true;
+    return f;
+  }
+
+  static Field TableOf(int index, Fields table) {
+    Field f{Field::Table, index};
+    f.tables.emplace_back(std::move(table));
+    return f;
+  }
+
+  static Field TablesOf(int index, std::vector<Fields> tables) {
+    Field f{Field::Tables, index};
+    f.length = tables.size();
+    f.tables = std::move(tables);
+    return f;
+  }
+
+  static std::string Finish(const Fields& root) {
+    FlatBuilder builder;
+    builder.buf_.assign(4, '\0');
+    uint32_t table = builder.WriteTable(root);
+    std::memcpy(builder.buf_.data(), &table, 4);
+    builder.Flush();
+    return std::move(builder.buf_);
+  }
+
+ private:
+  static constexpr size_t kField = static_cast<size_t>(-1);
+
+  // an offset at pos to write once what it refers to is written: the
+  // vector or table of a field, or element k of its vector of tables
+  struct Pending {
+    size_t pos;
+    const Field* field;
+    size_t k;  // kField for the field itself
+  };
+
+  std::string buf_;
+  std::deque<Pending> pending_;
+
+  // pad until extra more bytes end at a multiple of n
+  void Align(size_t n, size_t extra = 0) {
+    while ((buf_.size() + extra) % n != 0) buf_.push_back('\0');
+  }
+
+  template <typename T>
+  void Put(size_t pos, T value) {
+    std::memcpy(buf_.data() + pos, &value, sizeof(T));
+  }
+
+  size_t WriteTable(const Fields& fields) {
+    int n = 0;
+    for (const auto& f : fields) n = std::max(n, f.index + 1);
+    Align(2);
+    size_t vtable = buf_.size();
+    buf_.append(4 + 2 * n, '\0');
+    Align(8);
+    size_t table = buf_.size();
+    buf_.append(4, '\0');
+    Put<int32_t>(table, table - vtable);
+    for (const auto& f : fields) {
+      size_t pos;
+      if (f.kind == Field::Scalar) {
+        Align(f.align);
+        pos = buf_.size();
+        buf_ += f.bytes;
+      } else {
+        Align(4);
+        pos = buf_.size();
+        buf_.append(4, '\0');
+        pending_.push_back({pos, &f, kField});
+      }
+      Put<uint16_t>(vtable + 4 + 2 * f.index, pos - table);
+    }
+    Put<uint16_t>(vtable, 4 + 2 * n);
+    Put<uint16_t>(vtable + 2, buf_.size() - table);
+    return table;
+  }
+
+  size_t Write(const Pending& p) {
+    const Field& f = *p.field;
+    if (p.k != kField) return WriteTable(f.tables.at(p.k));
+    if (f.kind == Field::Table) return WriteTable(f.tables.front());
+    Align(std::max<size_t>(f.align, 4), 4);
+    size_t pos = buf_.size();
+    buf_.append(4, '\0');
+    Put<uint32_t>(pos, f.length);
+    if (f.kind == Field::Vector) {
+      buf_ += f.bytes;
+      if (f.terminated) buf_.push_back('\0');
+    } else {
+      buf_.append(4 * f.length, '\0');
+      for (size_t k = 0; k < f.length; k++)
+        pending_.push_back({pos + 4 + 4 * k, &f, k});
+    }
+    return pos;
+  }
+
+  void Flush() {
+    while (not pending_.empty()) {
+      Pending p = pending_.front();
+      pending_.pop_front();
+      Put<uint32_t>(p.pos, Write(p) - p.pos);
+    }
+  }
+};
+
+// Write features to a FlatGeobuf file with a packed Hilbert R-tree. The
+// features are kept encoded until Write, which sorts them along a Hilbert
+// curve over the extent when there is an index. Geometries are given as 2D
+// little endian WKB. https://flatgeobuf.org
+class FlatGeobufWriter {
+ public:
+  struct Column {
+    std::string name;
+    FlatGeobufType type;
+  };
+
+ private:
+  static constexpr uint8_t kMagic[] = {'f', 'g', 'b', 3, 'f', 'g', 'b', 1};
+
+  struct Feature {
+    std::string buffer;
+    geos::geom::Envelope envelope;
+  };
+
+  std::string name_;
+  uint8_t geometry_type_;
+  std::vector<Column> columns_;
+  uint16_t node_size_;
+  std::vector<Feature> features_;
+  geos::geom::Envelope extent_;
+  std::string error_msg_;
+
+  // a position in a WKB and what is left of it
+  struct Wkb {
+    const char* p;
+    size_t size;
+
+    template <typename T>
+    bool Get(T* value) {
+      if (size < sizeof(T)) return false;
+      std::memcpy(value, p, sizeof(T));
+      p += sizeof(T);
+      size -= sizeof(T);
+      return true;
+    }
+
+    bool Header(uint32_t* type) {
+      uint8_t order;
+      return Get(&order) and order == 1 and Get(type);
+    }
+  };
+
+  bool Points(Wkb* wkb, uint32_t n, std::vector<double>* xy,
+              geos::geom::Envelope* env) {
+    for (uint32_t i = 0; i < n; i++) {
+      double x, y;
+      if (not wkb->Get(&x) or not wkb->Get(&y)) return false;
+      xy->push_back(x);
+      xy->push_back(y);
+      env->expandToInclude(x, y);
+    }
+    return true;
+  }
+
+  // lines or rings, each prefixed by its number of points
+  bool Lines(Wkb* wkb, uint32_t lines, bool headers, std::vector<double>* xy,
+             std::vector<uint32_t>* ends, geos::geom::Envelope* env) {
+    for (uint32_t i = 0; i < lines; i++) {
+      uint32_t type, n;
+      if (headers and (not wkb->Header(&type) or type != 2)) return false;
+      if (not wkb->Get(&n) or not Points(wkb, n, xy, env)) return false;
+      ends->push_back(xy->size() / 2);
+    }
+    return true;
+  }
+
+  // the geometry table of a WKB geometry, of a known type if type is not 0
+  bool Geometry(Wkb* wkb, uint8_t type, FlatBuilder::Fields* g,
+                geos::geom::Envelope* env) {
+    uint32_t wkb_type, n;
+    if (not wkb->Header(&wkb_type)) return Fail("invalid WKB");
+    if (wkb_type < 1 or wkb_type > 6)
+      return Fail("unsupported WKB type " + std::to_string(wkb_type));
+    if (type != 0 and wkb_type != type)
+      return Fail("geometry type " + std::to_string(wkb_type) +
+                  " differs from " + std::to_string(type));
+    std::vector<double> xy;
+    std::vector<uint32_t> ends;
+    bool ok = true;
+    switch (wkb_type) {
+      case 1:  // Point
+        ok = Points(wkb, 1, &xy, env);
+        break;
+      case 2:  // LineString
+        ok = wkb->Get(&n) and Points(wkb, n, &xy, env);
+        break;
+      case 3:  // Polygon
+        ok = wkb->Get(&n) and Lines(wkb, n, false, &xy, &ends, env);
+        if (ends.size() == 1) ends.clear();
+        break;
+      case 4:  // MultiPoint
+        ok = wkb->Get(&n);
+        for (uint32_t i = 0; ok and i < n; i++) {
+          uint32_t point;
+          ok = wkb->Header(&point) and point == 1 and
+               Points(wkb, 1, &xy, env);
+        }
+        break;
+      case 5:  // MultiLineString
+        ok = wkb->Get(&n) and Lines(wkb, n, true, &xy, &ends, env);
+        if (ends.size() == 1) ends.clear();
+        break;
+      case 6: {  // MultiPolygon
+        std::vector<FlatBuilder::Fields> parts;
+        ok = wkb->Get(&n);
+        for (uint32_t i = 0; ok and i < n; i++) {
+          parts.emplace_back();
+          ok = Geometry(wkb, 3, &parts.back(), env);
+        }
+        if (ok) g->emplace_back(FlatBuilder::TablesOf(7, std::move(parts)));
+        break;
+      }
+    }
+    if (not ok) return Fail("invalid WKB");
+    if (not ends.empty()) g->emplace_back(FlatBuilder::VectorOf(0, ends));
+    if (not xy.empty()) g->emplace_back(FlatBuilder::VectorOf(1, xy));
+    if (geometry_type_ == 0 and type == 0)
+      g->emplace_back(FlatBuilder::Of<uint8_t>(6, wkb_type));
+    return true;
+  }
+
+  template <typename T>
+  static void Put(T value, std::string* properties) {
+    properties->append(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  // an array as JSON, as FeatureSourceFlatGeobuf reads Json columns
+  static bool ToJson(const ValueT& value, geos_nlohmann::json* json) {
+    std::string_view s;
+    if (GetString(value, &s))
+      *json = std::string(s);
+    else if (std::holds_alternative<bool>(value))
+      *json = std::get<bool>(value);
+    else if (std::holds_alternative<int64_t>(value))
+      *json = std::get<int64_t>(value);
+    else if (std::holds_alternative<uint64_t>(value))
+      *json = std::get<uint64_t>(value);
+    else if (std::holds_alternative<double>(value))
+      *json = std::get<double>(value);
+    else if (std::holds_alternative<NullStruct>(value))
+      *json = nullptr;
+    else if (std::holds_alternative<ArrayType>(value)) {
+      *json = geos_nlohmann::json::array();
+      for (const auto& element : std::get<ArrayType>(value)) {
+        json->emplace_back();
+        if (not ToJson(element.value, &json->back())) return false;
+      }
+    } else
+      return false;
+    return true;
+  }
+
+  bool Property(uint16_t i, const ValueT& value, std::string* properties) {
+    const Column& column = columns_.at(i);
+    Put<uint16_t>(i, properties);
+    std::string json;
+    std::string_view s;
+    switch (column.type) {
+      case FlatGeobufType::Bool:
+        if (not std::holds_alternative<bool>(value)) break;
+        Put<uint8_t>(std::get<bool>(value), properties);
+        return true;
+      case FlatGeobufType::Int:
+        if (not std::holds_alternative<int64_t>(value)) break;
+        Put<int32_t>(std::get<int64_t>(value), properties);
+        return true;
+      case FlatGeobufType::Long:
+        if (not std::holds_alternative<int64_t>(value)) break;
+        Put<int64_t>(std::get<int64_t>(value), properties);
+        return true;
+      case FlatGeobufType::Double:
+        if (std::holds_alternative<int64_t>(value))
+          Put<double>(std::get<int64_t>(value), properties);
+        else if (std::holds_alternative<double>(value))
+          Put<double>(std::get<double>(value), properties);
+        else
+          break;
+        return true;
+      case FlatGeobufType::Json:
+        if (std::holds_alternative<ArrayType>(value)) {
+          geos_nlohmann::json array;
+          if (not ToJson(value, &array)) break;
+          json = array.dump();
+          s = json;
+        } else if (not GetString(value, &s)) {
+          break;
+        }
+        Put<uint32_t>(s.size(), properties);
+        properties->append(s);
+        return true;
+      case FlatGeobufType::String:
+      case FlatGeobufType::DateTime:
+        if (not GetString(value, &s)) break;
+        Put<uint32_t>(s.size(), properties);
+        properties->append(s);
+        return true;
+      default:
+        return Fail("unsupported type of column " + column.name);
+    }
+    return Fail("value of column " + column.name + " is " + value_str(value));
+  }
+
+  bool Fail(const std::string& error_msg) {
+    error_msg_ = error_msg;
+    return false;
+  }
+
+  // the position of (x, y) along a Hilbert curve of order 16
+  static uint32_t Hilbert(uint32_t x, uint32_t y) {
+    uint32_t d = 0;
+    for (uint32_t s = 1u << 15; s > 0; s >>= 1) {
+      uint32_t rx = (x & s) > 0;
+      uint32_t ry = (y & s) > 0;
+      d += s * s * ((3 * rx) ^ ry);
+      if (ry == 0) {
+        if (rx == 1) {
+          x = s - 1 - x;
+          y = s - 1 - y;
+        }
+        std::swap(x, y);
+      }
+    }
+    return d;
+  }
+
+  void SortByHilbert() {
+    double width = extent_.getWidth(), height = extent_.getHeight();
+    auto cell = [](double v, double min, double size) {
+      return size > 0 ? static_cast<uint32_t>((v - min) / size * 65535.0) : 0;
+    };
+    std::vector<uint32_t> keys;
+    for (const auto& f : features_) {
+      keys.push_back(Hilbert(
+          cell((f.envelope.getMinX() + f.envelope.getMaxX()) / 2,
+               extent_.getMinX(), width),
+          cell((f.envelope.getMinY() + f.envelope.getMaxY()) / 2,
+               extent_.getMinY(), height)));
+    }
+    std::vector<size_t> order(features_.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+    std::vector<Feature> sorted;
+    sorted.reserve(features_.size());
+    for (size_t i : order) sorted.emplace_back(std::move(features_.at(i)));
+    features_ = std::move(sorted);
+  }
+
+  static void PutNode(const geos::geom::Envelope& env, uint64_t offset,
+                      std::string* index) {
+    for (double v :
+         {env.getMinX(), env.getMinY(), env.getMaxX(), env.getMaxY()})
+      Put<double>(v, index);
+    Put<uint64_t>(offset, index);
+  }
+
+  // the packed R-tree over the features in their order, root first
+  std::string Index() const {
+    auto bounds = LevelBounds(features_.size(), node_size_);
+    std::vector<std::pair<geos::geom::Envelope, uint64_t>> nodes(
+        bounds.front().second);
+    uint64_t offset = 0;
+    for (size_t i = 0; i < features_.size(); i++) {
+      nodes.at(bounds.front().first + i) = {features_.at(i).envelope, offset};
+      offset += 4 + features_.at(i).buffer.size();
+    }
+    for (size_t level = 1; level < bounds.size(); level++) {
+      auto [children, children_end] = bounds.at(level - 1);
+      auto [first, end] = bounds.at(level);
+      for (uint64_t k = 0; k < end - first; k++) {
+        uint64_t child = children + k * node_size_;
+        geos::geom::Envelope env;
+        for (uint64_t c = child;
+             c < std::min<uint64_t>(child + node_size_, children_end); c++)
+          env.expandToInclude(nodes.at(c).first);
+        nodes.at(first + k) = {env, child};
+      }
+    }
+    std::string index;
+    for (const auto& [env, offset] : nodes) PutNode(env, offset, &index);
+    return index;
+  }
+
+ public:
+  // geometry_type by the WKB numbering, 0 if it differs between features.
+  // node_size 0 writes no index.
+  FlatGeobufWriter(const std::string& name, uint8_t geometry_type,
+                   std::vector<Column> columns, uint16_t node_size = 16)
+      : name_(name),
+        geometry_type_(geometry_type),
+        columns_(std::move(columns)),
+        node_size_(node_size == 1 ? 2 : node_size) {}
+
+  // first and last + 1 node of each level of the tree, leaves first, as
+  // FlatGeobufReader reads them
+  static std::vector<std::pair<uint64_t, uint64_t>> LevelBounds(
+      uint64_t items, uint16_t node_size) {
+    std::vector<uint64_t> level_nodes = {items};
+    uint64_t n = items;
+    uint64_t nodes = n;
+    do {
+      n = (n + node_size - 1) / node_size;
+      nodes += n;
+      level_nodes.emplace_back(n);
+    } while (n != 1);
+    std::vector<std::pair<uint64_t, uint64_t>> bounds;
+    for (uint64_t level : level_nodes) {
+      nodes -= level;
+      bounds.emplace_back(nodes, nodes + level);
+    }
+    return bounds;
+  }
+
+  // a feature by its geometry and a value for every column, NullValue to
+  // leave one out
+  bool Add(std::string_view wkb, const std::vector<ValueT>& values) {
+    if (values.size() != columns_.size())
+      return Fail("expect " + std::to_string(columns_.size()) + " values");
+    Feature feature;
+    FlatBuilder::Fields geometry;
+    Wkb reader{wkb.data(), wkb.size()};
+    if (not Geometry(&reader, geometry_type_, &geometry, &feature.envelope))
+      return false;
+    std::string properties;
+    for (size_t i = 0; i < values.size(); i++)
+      if (not std::holds_alternative<NullStruct>(values.at(i)) and
+          not Property(i, values.at(i), &properties))
+        return false;
+    FlatBuilder::Fields table = {FlatBuilder::TableOf(0, std::move(geometry))};
+    if (not properties.empty())
+      table.emplace_back(FlatBuilder::StringOf(1, properties));
+    feature.buffer = FlatBuilder::Finish(table);
+    extent_.expandToInclude(feature.envelope);
+    features_.emplace_back(std::move(feature));
+    return true;
+  }
+
+  size_t size() const { return features_.size(); }
+
+  bool Write(std::ostream& os) {
+    bool indexed = node_size_ > 0 and not features_.empty();
+    if (indexed) SortByHilbert();
+
+    std::vector<FlatBuilder::Fields> columns;
+    for (const auto& column : columns_)
+      columns.push_back(
+          {FlatBuilder::StringOf(0, column.name),
+           FlatBuilder::Of<uint8_t>(1, static_cast<uint8_t>(column.type))});
+    FlatBuilder::Fields header = {
+        FlatBuilder::StringOf(0, name_),
+        FlatBuilder::Of<uint8_t>(2, geometry_type_),
+        FlatBuilder::TablesOf(7, std::move(columns)),
+        FlatBuilder::Of<uint64_t>(8, features_.size()),
+        FlatBuilder::Of<uint16_t>(9, indexed ? node_size_ : 0)};
+    if (not extent_.isNull())
+      header.emplace_back(FlatBuilder::VectorOf<double>(
+          1, {extent_.getMinX(), extent_.getMinY(), extent_.getMaxX(),
+              extent_.getMaxY()}));
+    std::string buffer = FlatBuilder::Finish(header);
+
+    std::string prefix;
+    Put<uint32_t>(buffer.size(), &prefix);
+    os.write(reinterpret_cast<const char*>(kMagic), sizeof(kMagic));
+    os << prefix << buffer;
+    if (indexed) os << Index();
+    for (const auto& feature : features_) {
+      prefix.clear();
+      Put<uint32_t>(feature.buffer.size(), &prefix);
+      os << prefix << feature.buffer;
+    }
+    if (not os.good()) return Fail("can not write the FlatGeobuf file");
+    return true;
+  }
+
+  const std::string& error_msg() const { return error_msg_; }
+};
+
+}  // namespace cql2cpp
@@ -0,0 +1,77 @@
+/*
+ * File Name: folded_columns.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/07
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "feature_source.h"
+#include "string_fold.h"
+
+namespace cql2cpp {
+
+// Folded variants of string properties, one value per feature ordinal,
+// computed when features are loaded so that CASEI and ACCENTI of these
+// properties compare bytes instead of folding per evaluation. Values which
+// are not strings are kept as null.
+class FoldedColumns {
+ private:
+  struct Column {
+    std::string property_path;
+    int folding;
+    std::vector<ValueT> values;
+  };
+
+  std::vector<Column> columns_;
+
+ public:
+  // folding is a combination of StringFold::Folding
+  void Register(const std::string& property_path, int folding) {
+    columns_.push_back({property_path, folding, {}});
+  }
+
+  bool empty() const { return columns_.empty(); }
+
+  void Clear() {
+    for (auto& column : columns_) column.values.clear();
+  }
+
+  // fold the properties of the feature at ordinal
+  void Set(uint32_t ordinal, const FeatureSource& fs) {
+    for (auto& column : columns_) {
+      if (column.values.size() <= ordinal)
+        column.values.resize(ordinal + 1, NullValue);
+      ValueT value = fs.get_property(column.property_path);
+      std::string_view s;
+      column.values.at(ordinal) =
+          GetString(value, &s) ? ValueT(StringFold::Fold(s, column.folding))
+                               : ValueT(NullValue);
+    }
+  }
+
+  void Erase(uint32_t ordinal) {
+    for (auto& column : columns_)
+      if (ordinal < column.values.size())
+        column.values.at(ordinal) = NullValue;
+  }
+
+  // nullptr if the property is not folded so
+  const ValueT* Get(uint32_t ordinal, const std::string& property_path,
+                    int folding) const {
+    for (const auto& column : columns_)
+      if (column.folding == folding and column.property_path == property_path)
+        return ordinal < column.values.size() ? &column.values.at(ordinal)
+                                              : nullptr;
+    return nullptr;
+  }
+};
+
+}  // namespace cql2cpp
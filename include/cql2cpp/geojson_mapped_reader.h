@@ -0,0 +1,77 @@
+/*
+ * File Name: geojson_mapped_reader.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/28
+ *
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "feature_source_mapped.h"
+#include "json_span.h"
+#include "mapped_file.h"
+
+namespace cql2cpp {
+
+// Return false to stop reading
+using GeoJsonFeatureTextCallback = std::function<bool(std::string_view text)>;
+
+// Find the features of a GeoJSON FeatureCollection in its text without
+// parsing them, e.g. in a MappedFile. A feature is parsed only as far as a
+// query reads it by FeatureSourceMapped.
+class GeoJsonMappedReader {
+ private:
+  size_t count_ = 0;
+  std::string error_msg_;
+
+ public:
+  // Call f with the text of every feature in the order of the collection.
+  // Return false if the collection is malformed or f stopped reading.
+  bool Read(std::string_view text, const GeoJsonFeatureTextCallback& f) {
+    count_ = 0;
+    error_msg_.clear();
+    std::string_view features;
+    if (not JsonSpan::FindMember(text, "features", &features) or
+        features.front() != '[') {
+      error_msg_ = "no features array in the FeatureCollection";
+      return false;
+    }
+    bool stopped = false;
+    bool valid = JsonSpan::ForEachElement(features, [&](auto feature) {
+      if (feature.front() != '{') return true;
+      count_++;
+      stopped = not f(feature);
+      return not stopped;
+    });
+    if (stopped) error_msg_ = "stopped by callback";
+    if (not valid) error_msg_ = "malformed features array";
+    return valid and not stopped;
+  }
+
+  // Map a file and create a feature source for each of its features. The
+  // features share the mapping, it is unmapped with the last of them.
+  bool Load(const std::string& path, std::vector<FeatureSourcePtr>* features) {
+    std::shared_ptr<const MappedFile> file = MappedFile::Open(path, &error_msg_);
+    if (file == nullptr) return false;
+    return Read(file->text(), [&](auto text) {
+      features->emplace_back(std::make_shared<FeatureSourceMapped>(file, text));
+      return true;
+    });
+  }
+
+  // number of features read by the last Read
+  size_t count() const { return count_; }
+
+  const std::string& error_msg() const { return error_msg_; }
+};
+
+}  // namespace cql2cpp
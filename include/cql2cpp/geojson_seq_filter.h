@@ -0,0 +1,156 @@
+/*
+ * File Name: geojson_seq_filter.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/29
+ *
+ */
+
+#pragma once
+
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "feature_source_mapped.h"
+#include "json_span.h"
+
+namespace cql2cpp {
+
+// Return true if the feature is selected
+using FeaturePredicate = std::function<bool(const FeatureSource& fs)>;
+
+// Filter newline delimited GeoJSON, one feature per line (GeoJSONSeq,
+// RFC 8142). Three threads form a pipeline: the caller reads batches of
+// lines, a second one evaluates them in place and a third writes the
+// selected lines unchanged. Reading, evaluation and writing overlap while
+// the order of the input is kept.
+class GeoJsonSeqFilter {
+ private:
+  struct Batch {
+    std::string text;  // the lines of the batch, each followed by '\n'
+    std::vector<std::pair<size_t, size_t>> lines;  // offset and length
+    std::vector<bool> selected;
+  };
+
+  FeaturePredicate predicate_;
+  size_t batch_lines_;
+  size_t queue_batches_;
+
+  size_t count_ = 0;
+  size_t skipped_ = 0;
+  size_t selected_ = 0;
+  std::string error_msg_;
+
+  // the feature on a line without the record separator of RFC 8142 and
+  // surrounding white space, empty if the line holds no JSON object
+  static std::string_view Feature(std::string_view line) {
+    size_t begin = line.find_first_not_of(" \t\r\x1e");
+    if (begin == std::string_view::npos or line.at(begin) != '{') return {};
+    size_t end = line.find_last_not_of(" \t\r");
+    return line.substr(begin, end + 1 - begin);
+  }
+
+  bool ReadBatch(std::istream& in, Batch* batch) {
+    std::string line;
+    while (batch->lines.size() < batch_lines_ and std::getline(in, line)) {
+      if (Feature(line).empty()) {
+        if (line.find_first_not_of(" \t\r\x1e") != std::string::npos)
+          skipped_++;
+        continue;
+      }
+      batch->lines.emplace_back(batch->text.size(), line.size());
+      batch->text.append(line).push_back('\n');
+    }
+    count_ += batch->lines.size();
+    return not batch->lines.empty();
+  }
+
+  void Evaluate(Batch* batch) const {
+    batch->selected.resize(batch->lines.size());
+    std::string_view text = batch->text;
+    for (size_t i = 0; i < batch->lines.size(); i++) {
+      auto [offset, length] = batch->lines.at(i);
+      FeatureSourceMapped fs(nullptr, Feature(text.substr(offset, length)));
+      batch->selected[i] = predicate_(fs);
+    }
+  }
+
+  size_t Write(const Batch& batch, std::ostream& out) const {
+    size_t selected = 0;
+    for (size_t i = 0; i < batch.lines.size(); i++) {
+      if (not batch.selected.at(i)) continue;
+      auto [offset, length] = batch.lines.at(i);
+      out.write(batch.text.data() + offset, length + 1);
+      selected++;
+    }
+    return selected;
+  }
+
+ public:
+  GeoJsonSeqFilter(FeaturePredicate predicate, size_t batch_lines = 1024,
+                   size_t queue_batches = 4)
+      : predicate_(std::move(predicate)),
+        batch_lines_(batch_lines > 0 ? batch_lines : 1),
+        queue_batches_(queue_batches) {}
+
+  // Write the lines of the features selected by the predicate from in to
+  // out. Lines that are not JSON objects are skipped. The predicate is only
+  // called from one thread. Return false if in or out failed.
+  bool Run(std::istream& in, std::ostream& out) {
+    count_ = skipped_ = selected_ = 0;
+    error_msg_.clear();
+
+    BoundedQueue<Batch> to_evaluate(queue_batches_);
+    BoundedQueue<Batch> to_write(queue_batches_);
+    std::thread evaluator([&] {
+      Batch batch;
+      while (to_evaluate.Pop(&batch)) {
+        Evaluate(&batch);
+        to_write.Push(std::move(batch));
+      }
+      to_write.Close();
+    });
+    std::thread writer([&] {
+      Batch batch;
+      while (to_write.Pop(&batch))
+        if (out.good()) selected_ += Write(batch, out);
+      out.flush();
+    });
+
+    for (;;) {
+      Batch batch;
+      if (not ReadBatch(in, &batch)) break;
+      to_evaluate.Push(std::move(batch));
+    }
+    to_evaluate.Close();
+    evaluator.join();
+    writer.join();
+
+    if (in.bad())
+      error_msg_ = "read error after " + std::to_string(count_) + " lines";
+    else if (not out.good())
+      error_msg_ = "write error";
+    return error_msg_.empty();
+  }
+
+  // features read by the last Run
+  size_t count() const { return count_; }
+
+  // non empty lines that are not a JSON object
+  size_t skipped() const { return skipped_; }
+
+  // features selected and written
+  size_t selected() const { return selected_; }
+
+  const std::string& error_msg() const { return error_msg_; }
+};
+
+}  // namespace cql2cpp
@@ -0,0 +1,149 @@
+/*
+ * File Name: geojson_stream_reader.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/27
+ *
+ */
+
+#pragma once
+
+#include <geos/vend/include_nlohmann_json.hpp>
+
+#include <functional>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace cql2cpp {
+
+// Return false to stop reading
+using GeoJsonFeatureCallback =
+    std::function<bool(geos_nlohmann::json&& feature)>;
+
+// Read the features of a GeoJSON FeatureCollection one by one with a SAX
+// parser. Only the feature being read is held in memory, so collections
+// larger than memory can be filtered.
+class GeoJsonStreamReader {
+ private:
+  using json = geos_nlohmann::json;
+
+  class Handler {
+   private:
+    const GeoJsonFeatureCallback& callback_;
+    int depth_ = 0;  // of objects and arrays
+    std::string top_key_;  // last key of the FeatureCollection
+    bool in_features_ = false;
+
+    json feature_;
+    std::vector<json*> stack_;  // containers of the feature being built
+    std::string key_;           // key of the next value in an object
+
+   public:
+    size_t count = 0;
+    bool stopped = false;
+    std::string error_msg;
+
+    Handler(const GeoJsonFeatureCallback& callback) : callback_(callback) {}
+
+    // add a value to the feature being built, return it
+    json* Add(json&& value) {
+      json& top = *stack_.back();
+      if (top.is_array()) {
+        top.push_back(std::move(value));
+        return &top.back();
+      }
+      return &(top[key_] = std::move(value));
+    }
+
+    bool Value(json&& value) {
+      if (not stack_.empty()) Add(std::move(value));
+      return true;
+    }
+
+    bool Start(json&& container) {
+      if (not stack_.empty()) {
+        stack_.emplace_back(Add(std::move(container)));
+      } else if (in_features_ and depth_ == 2 and container.is_object()) {
+        feature_ = std::move(container);
+        stack_.emplace_back(&feature_);
+      } else if (depth_ == 1 and top_key_ == "features" and
+                 container.is_array()) {
+        in_features_ = true;
+      }
+      depth_++;
+      return true;
+    }
+
+    bool End() {
+      depth_--;
+      if (stack_.empty()) {
+        if (depth_ == 1) in_features_ = false;
+        return true;
+      }
+      stack_.pop_back();
+      if (not stack_.empty()) return true;
+      count++;
+      if (callback_(std::move(feature_))) return true;
+      stopped = true;
+      return false;
+    }
+
+    bool null() { return Value(nullptr); }
+    bool boolean(bool val) { return Value(val); }
+    bool number_integer(json::number_integer_t val) { return Value(val); }
+    bool number_unsigned(json::number_unsigned_t val) { return Value(val); }
+    bool number_float(json::number_float_t val, const json::string_t&) {
+      return Value(val);
+    }
+    bool string(json::string_t& val) { return Value(std::move(val)); }
+    bool binary(json::binary_t& val) { return Value(json::binary(val)); }
+
+    bool start_object(std::size_t) { return Start(json::object()); }
+    bool end_object() { return End(); }
+    bool start_array(std::size_t) { return Start(json::array()); }
+    bool end_array() { return End(); }
+
+    bool key(json::string_t& val) {
+      if (depth_ == 1) top_key_ = val;
+      key_ = val;
+      return true;
+    }
+
+    bool parse_error(std::size_t position, const std::string&,
+                     const geos_nlohmann::detail::exception& ex) {
+      error_msg = "GeoJSON parse error at " + std::to_string(position) +
+                  ": " + ex.what();
+      return false;
+    }
+  };
+
+  size_t count_ = 0;
+  std::string error_msg_;
+
+ public:
+  // Call f with every feature in the order of the collection. Return false
+  // if the input is not valid JSON or f stopped reading.
+  bool Read(std::istream& in, const GeoJsonFeatureCallback& f) {
+    Handler handler(f);
+    bool ok = json::sax_parse(in, &handler);
+    count_ = handler.count;
+    error_msg_ = handler.stopped ? "stopped by callback" : handler.error_msg;
+    return ok;
+  }
+
+  bool Read(const std::string& text, const GeoJsonFeatureCallback& f) {
+    std::istringstream iss(text);
+    return Read(iss, f);
+  }
+
+  // number of features read by the last Read
+  size_t count() const { return count_; }
+
+  const std::string& error_msg() const { return error_msg_; }
+};
+
+}  // namespace cql2cpp
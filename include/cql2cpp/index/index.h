@@ -0,0 +1,117 @@
+/*
+ * File Name: index.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/21
+ *
+ */
+
+#pragma once
+
+#include <cql2cpp/ast_node.h>
+#include <cql2cpp/feature_source.h>
+#include <cql2cpp/node_type.h>
+#include <cql2cpp/operator.h>
+#include <cql2cpp/selection_set.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cql2cpp {
+
+// Answer one predicate from an index into the empty rows. *exact is false if
+// rows is only a superset of the matching features, then the predicate must
+// still be evaluated on every candidate.
+using NodeLookup =
+    std::function<bool(const AstNodePtr, SelectionSet* rows, bool* exact)>;
+
+// Estimate the number of rows a lookup of the predicate returns without
+// doing the lookup, and whether the lookup would be exact.
+using NodeEstimate =
+    std::function<bool(const AstNodePtr, size_t* rows, bool* exact)>;
+
+class Index {
+ protected:
+  std::string property_path_;
+  std::map<NodeType, std::map<Operator, NodeLookup>> lookups_;
+  std::map<NodeType, std::map<Operator, NodeEstimate>> estimates_;
+
+  // the child of a predicate which is the indexed property
+  int PropertyChild(const AstNodePtr& n) const {
+    for (size_t i = 0; i < n->children().size(); i++) {
+      const AstNodePtr& child = n->children().at(i);
+      if (child->type() == PropertyName and
+          std::holds_alternative<std::string>(child->origin_value()) and
+          std::get<std::string>(child->origin_value()) == property_path_)
+        return i;
+    }
+    return -1;
+  }
+
+  template <typename F>
+  static const F* Find(const std::map<NodeType, std::map<Operator, F>>& fs,
+                       const AstNodePtr& n) {
+    auto type = fs.find(n->type());
+    if (type == fs.end()) return nullptr;
+    auto op = type->second.find(n->op());
+    if (op == type->second.end()) return nullptr;
+    return &op->second;
+  }
+
+ public:
+  Index(const std::string& property_path) : property_path_(property_path) {}
+  virtual ~Index() {}
+
+  virtual std::string name() const = 0;
+
+  const std::string& property_path() const { return property_path_; }
+
+  // the properties read by Insert, property_path() first
+  virtual std::vector<std::string> property_paths() const {
+    return {property_path_};
+  }
+
+  // number of features with a value in this index
+  virtual size_t size() const = 0;
+
+  // Insert replaces the value an ordinal had. Lookups see Insert and Erase
+  // at once, but an index may defer reorganizing itself until Commit.
+  virtual void Insert(uint32_t ordinal, const ValueT& value) = 0;
+
+  // Insert the values of a feature, indexes of more than one property
+  // override it
+  virtual void Insert(uint32_t ordinal, const FeatureSource& feature) {
+    Insert(ordinal, feature.get_property(property_path_));
+  }
+
+  virtual void Erase(uint32_t ordinal) = 0;
+
+  virtual void Commit() {}
+
+  virtual void Clear() = 0;
+
+  bool Lookup(const AstNodePtr predicate, SelectionSet* rows,
+              bool* exact) const {
+    const NodeLookup* lookup = Find(lookups_, predicate);
+    return lookup != nullptr and (*lookup)(predicate, rows, exact);
+  }
+
+  // predicates without an estimate are assumed to select every feature
+  bool Estimate(const AstNodePtr predicate, size_t* rows, bool* exact) const {
+    if (Find(lookups_, predicate) == nullptr) return false;
+    const NodeEstimate* estimate = Find(estimates_, predicate);
+    if (estimate != nullptr) return (*estimate)(predicate, rows, exact);
+    *rows = size();
+    *exact = false;
+    return true;
+  }
+};
+
+using IndexPtr = std::shared_ptr<Index>;
+
+}  // namespace cql2cpp
@@ -0,0 +1,324 @@
+/*
+ * File Name: interval.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/09
+ *
+ */
+
+#pragma once
+
+#include <cql2cpp/temporal.h>
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+
+#include "index.h"
+
+namespace cql2cpp {
+
+// Times of one property, or intervals from a begin property to an end
+// property, sorted by their beginning. A temporal predicate against a
+// literal time bounds the beginnings of its matches directly, and through
+// the ends it bounds as no interval is longer than the longest indexed.
+// Entries within these bounds are related to the literal as the evaluator
+// does, so lookups are exact. New entries go to an unsorted tail and erased
+// ones stay stale until Commit, as in IndexRange.
+class IndexInterval : public Index {
+ private:
+  static constexpr int64_t kMin = std::numeric_limits<int64_t>::min();
+  static constexpr int64_t kMax = std::numeric_limits<int64_t>::max();
+
+  using Entry = std::pair<int64_t, uint32_t>;  // begin and ordinal
+  std::string end_path_;                       // empty for times
+  std::vector<Entry> entries_;
+  size_t sorted_ = 0;  // entries_[0, sorted_) are sorted
+  std::vector<std::optional<TimeValue>> values_;
+  size_t size_ = 0;
+  size_t stale_ = 0;
+  int64_t longest_ = 0;  // end - begin of the longest interval, saturated
+
+  static constexpr size_t kMinTail = 1024;
+
+  bool Live(const Entry& entry) const {
+    return entry.second < values_.size() and
+           values_.at(entry.second).has_value() and
+           values_.at(entry.second)->begin == entry.first;
+  }
+
+  static int64_t Add(int64_t a, int64_t b) {
+    if (b > 0 and a > kMax - b) return kMax;
+    if (b < 0 and a < kMin - b) return kMin;
+    return a + b;
+  }
+
+  static int64_t Length(const TimeValue& time) {
+    uint64_t length = static_cast<uint64_t>(time.end) -
+                      static_cast<uint64_t>(time.begin);
+    return length > static_cast<uint64_t>(kMax) ? kMax
+                                                : static_cast<int64_t>(length);
+  }
+
+  static bool IsProperty(const AstNodePtr& n, const std::string& path) {
+    return n->type() == PropertyName and
+           std::holds_alternative<std::string>(n->origin_value()) and
+           std::get<std::string>(n->origin_value()) == path;
+  }
+
+  // the child of a predicate which is the indexed time or interval
+  int IndexedChild(const AstNodePtr& n) const {
+    if (end_path_.empty()) return PropertyChild(n);
+    for (size_t i = 0; i < n->children().size(); i++) {
+      const AstNodePtr& child = n->children().at(i);
+      if (child->type() == TemporalInstance and child->op() == Interval and
+          child->children().size() == 2 and
+          IsProperty(child->children().at(0), property_path_) and
+          IsProperty(child->children().at(1), end_path_))
+        return i;
+    }
+    return -1;
+  }
+
+  // The predicate as indexed OP window, with the operator mirrored if the
+  // window is on the left hand side
+  bool Window(const AstNodePtr& n, Operator* op, TimeValue* window) const {
+    int indexed = IndexedChild(n);
+    if (indexed < 0 or n->children().size() != 2) return false;
+    const AstNodePtr& other = n->children().at(1 - indexed);
+    if (not other->constant() or
+        not std::holds_alternative<TimeValue>(other->origin_value()))
+      return false;
+    *window = std::get<TimeValue>(other->origin_value());
+    *op = n->op();
+    if (indexed == 1) {
+      static const std::map<Operator, Operator> mirror = {
+          {T_After, T_Before},           {T_Before, T_After},
+          {T_Contains, T_During},        {T_During, T_Contains},
+          {T_FinishedBy, T_Finishes},    {T_Finishes, T_FinishedBy},
+          {T_Meets, T_MetBy},            {T_MetBy, T_Meets},
+          {T_OverlappedBy, T_Overlaps},  {T_Overlaps, T_OverlappedBy},
+          {T_StartedBy, T_Starts},       {T_Starts, T_StartedBy},
+          {T_Equals, T_Equals},          {T_Intersects, T_Intersects}};
+      *op = mirror.at(*op);
+    }
+    return true;
+  }
+
+  // The beginnings an interval [b, e] with op(interval, window) may have,
+  // inclusive. A superset is fine as entries are related exactly.
+  bool Bounds(Operator op, const TimeValue& w, int64_t* lower,
+              int64_t* upper) const {
+    int64_t begin_lower = kMin, begin_upper = kMax;
+    int64_t end_lower = kMin, end_upper = kMax;
+    switch (op) {
+      case T_After:  // b > w.end
+        begin_lower = Add(w.end, 1);
+        break;
+      case T_Before:  // e < w.begin
+        end_upper = Add(w.begin, -1);
+        break;
+      case T_Contains:  // b < w.begin, e > w.end
+        begin_upper = Add(w.begin, -1);
+        end_lower = Add(w.end, 1);
+        break;
+      case T_During:  // b > w.begin, e < w.end
+        begin_lower = Add(w.begin, 1);
+        end_upper = Add(w.end, -1);
+        break;
+      case T_Equals:
+        begin_lower = begin_upper = w.begin;
+        break;
+      case T_FinishedBy:  // b < w.begin, e == w.end
+        begin_upper = Add(w.begin, -1);
+        end_lower = end_upper = w.end;
+        break;
+      case T_Finishes:  // b > w.begin, e == w.end
+        begin_lower = Add(w.begin, 1);
+        end_lower = end_upper = w.end;
+        break;
+      case T_Intersects:  // b <= w.end, e >= w.begin
+        begin_upper = w.end;
+        end_lower = w.begin;
+        break;
+      case T_Meets:  // e == w.begin
+        end_lower = end_upper = w.begin;
+        break;
+      case T_MetBy:  // b == w.end
+        begin_lower = begin_upper = w.end;
+        break;
+      case T_OverlappedBy:  // w.begin < b < w.end, e > w.end
+        begin_lower = Add(w.begin, 1);
+        begin_upper = Add(w.end, -1);
+        break;
+      case T_Overlaps:  // b < w.begin, w.begin < e < w.end
+        begin_upper = Add(w.begin, -1);
+        end_lower = Add(w.begin, 1);
+        break;
+      case T_StartedBy:
+      case T_Starts:
+        begin_lower = begin_upper = w.begin;
+        break;
+      default:
+        return false;
+    }
+    // b <= e and e - b <= longest_
+    *lower = std::max(begin_lower, Add(end_lower, -longest_));
+    *upper = std::min(begin_upper, end_upper);
+    return true;
+  }
+
+  // the sorted entries beginning in [lower, upper]
+  std::pair<std::vector<Entry>::const_iterator,
+            std::vector<Entry>::const_iterator>
+  Span(int64_t lower, int64_t upper) const {
+    auto sorted_end = entries_.begin() + sorted_;
+    if (lower > upper) return {sorted_end, sorted_end};
+    auto begin =
+        std::lower_bound(entries_.begin(), sorted_end, Entry(lower, 0));
+    auto end = std::upper_bound(
+        begin, sorted_end, Entry(upper, std::numeric_limits<uint32_t>::max()));
+    return {begin, end};
+  }
+
+  void Set(uint32_t ordinal, const TimeValue& time) {
+    if (values_.size() <= ordinal) values_.resize(ordinal + 1);
+    values_.at(ordinal) = time;
+    entries_.emplace_back(time.begin, ordinal);
+    longest_ = std::max(longest_, Length(time));
+    size_++;
+  }
+
+ public:
+  // An index of the times of property_path, or with end_path of the
+  // intervals INTERVAL(property_path, end_path)
+  IndexInterval(const std::string& property_path,
+                const std::string& end_path = "")
+      : Index(property_path), end_path_(end_path) {
+    for (Operator op : Temporal::Predicates()) {
+      if (op == T_Disjoint) continue;  // not bounded
+      lookups_[TemporalPred][op] = [this](auto n, auto rows,
+                                          auto exact) -> bool {
+        Operator op;
+        TimeValue window;
+        int64_t lower, upper;
+        if (not Window(n, &op, &window) or
+            not Bounds(op, window, &lower, &upper))
+          return false;
+        std::vector<uint32_t> ordinals;
+        auto related = [&](const Entry& entry) {
+          if (entry.first < lower or entry.first > upper) return;
+          if (stale_ > 0 and not Live(entry)) return;
+          if (Temporal::Relate(op, *values_.at(entry.second), window))
+            ordinals.emplace_back(entry.second);
+        };
+        auto [begin, end] = Span(lower, upper);
+        for (auto it = begin; it != end; ++it) related(*it);
+        for (size_t i = sorted_; i < entries_.size(); i++)
+          related(entries_.at(i));
+        *rows = SelectionSet(std::move(ordinals));
+        *exact = true;
+        return true;
+      };
+      estimates_[TemporalPred][op] = [this](auto n, auto rows,
+                                            auto exact) -> bool {
+        Operator op;
+        TimeValue window;
+        int64_t lower, upper;
+        if (not Window(n, &op, &window) or
+            not Bounds(op, window, &lower, &upper))
+          return false;
+        auto [begin, end] = Span(lower, upper);
+        *rows = end - begin;
+        for (size_t i = sorted_; i < entries_.size(); i++)
+          if (entries_.at(i).first >= lower and entries_.at(i).first <= upper)
+            (*rows)++;
+        *exact = true;
+        return true;
+      };
+    }
+  }
+
+  std::string name() const override { return "interval"; }
+
+  std::vector<std::string> property_paths() const override {
+    if (end_path_.empty()) return {property_path_};
+    return {property_path_, end_path_};
+  }
+
+  size_t size() const override { return size_; }
+
+  // a time, a date or timestamp string, or an interval
+  void Insert(uint32_t ordinal, const ValueT& value) override {
+    Erase(ordinal);
+    ValueT time;
+    std::string errmsg;
+    if (Temporal::ToTime(value, &time, &errmsg) and
+        std::holds_alternative<TimeValue>(time))
+      Set(ordinal, std::get<TimeValue>(time));
+  }
+
+  void Insert(uint32_t ordinal, const FeatureSource& feature) override {
+    if (end_path_.empty()) return Index::Insert(ordinal, feature);
+    Erase(ordinal);
+    ValueT begin, end;
+    std::string errmsg;
+    if (not Temporal::ToTime(feature.get_property(property_path_), &begin,
+                             &errmsg) or
+        not Temporal::ToTime(feature.get_property(end_path_), &end, &errmsg) or
+        not std::holds_alternative<TimeValue>(begin) or
+        not std::holds_alternative<TimeValue>(end))
+      return;
+    TimeValue interval = {std::get<TimeValue>(begin).begin,
+                          std::get<TimeValue>(end).end};
+    if (interval.begin <= interval.end) Set(ordinal, interval);
+  }
+
+  void Erase(uint32_t ordinal) override {
+    if (ordinal >= values_.size() or not values_.at(ordinal).has_value())
+      return;
+    values_.at(ordinal).reset();
+    size_--;
+    stale_++;
+  }
+
+  void Commit() override {
+    // drop stale entries and duplicates, and shrink the longest interval
+    if (stale_ > 0 and stale_ * 4 >= entries_.size()) {
+      entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                    [this](const Entry& entry) {
+                                      return not Live(entry);
+                                    }),
+                     entries_.end());
+      std::sort(entries_.begin(), entries_.end());
+      entries_.erase(std::unique(entries_.begin(), entries_.end()),
+                     entries_.end());
+      sorted_ = entries_.size();
+      stale_ = 0;
+      longest_ = 0;
+      for (const auto& value : values_)
+        if (value.has_value()) longest_ = std::max(longest_, Length(*value));
+      return;
+    }
+
+    size_t tail = entries_.size() - sorted_;
+    if (tail == 0 or tail < std::max(kMinTail, sorted_ / 16)) return;
+    std::sort(entries_.begin() + sorted_, entries_.end());
+    std::inplace_merge(entries_.begin(), entries_.begin() + sorted_,
+                       entries_.end());
+    sorted_ = entries_.size();
+  }
+
+  void Clear() override {
+    entries_.clear();
+    sorted_ = 0;
+    values_.clear();
+    size_ = 0;
+    stale_ = 0;
+    longest_ = 0;
+  }
+};
+
+}  // namespace cql2cpp
@@ -0,0 +1,225 @@
+/*
+ * File Name: inverted.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/21
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "index.h"
+
+namespace cql2cpp {
+
+// Map string values of one property to the features having them. Scalar
+// values answer =, IN; elements of array values answer the array predicates.
+// Only strings are indexed: numbers are compared with a tolerance, and that
+// is the job of a range index.
+class IndexInverted : public Index {
+ private:
+  std::unordered_map<std::string, SelectionSet> scalar_;
+  std::unordered_map<std::string, SelectionSet> element_;
+  SelectionSet rows_;  // features with any indexed value
+  static const SelectionSet empty_;
+
+  // The keys each feature is indexed under, to erase it without knowing its
+  // value. Keys of an unordered_map do not move until they are erased.
+  struct Keys {
+    const std::string* scalar = nullptr;
+    std::vector<const std::string*> elements;
+  };
+  std::vector<Keys> keys_;
+
+  // The postings a predicate selects, combined by union or intersection.
+  // Not exact if the combination is only a superset of the result.
+  struct Terms {
+    std::vector<const SelectionSet*> postings;
+    bool intersect = false;
+    bool exact = true;
+  };
+  using NodeTerms = std::function<bool(const AstNodePtr, Terms*)>;
+  std::map<NodeType, std::map<Operator, NodeTerms>> terms_;
+
+  static void Remove(uint32_t ordinal, const std::string* key,
+                     std::unordered_map<std::string, SelectionSet>* postings) {
+    auto it = postings->find(*key);
+    it->second.Remove(ordinal);
+    if (it->second.Empty()) postings->erase(it);
+  }
+
+  static const SelectionSet& Postings(
+      const std::unordered_map<std::string, SelectionSet>& postings,
+      const std::string& key) {
+    auto it = postings.find(key);
+    return it == postings.end() ? empty_ : it->second;
+  }
+
+  // the literal array on the other side of an array predicate, all strings
+  static bool LiteralStrings(const AstNodePtr& n,
+                             std::vector<std::string>* strings) {
+    if (not n->constant() or
+        not std::holds_alternative<ArrayType>(n->origin_value()))
+      return false;
+    for (const auto& element : std::get<ArrayType>(n->origin_value())) {
+      if (not std::holds_alternative<std::string>(element.value))
+        return false;
+      strings->emplace_back(std::get<std::string>(element.value));
+    }
+    return true;
+  }
+
+  // postings of all elements of the literal array
+  bool Elements(const AstNodePtr& n, size_t property, Terms* terms) const {
+    std::vector<std::string> strings;
+    if (not LiteralStrings(n->children().at(1 - property), &strings))
+      return false;
+    for (const auto& s : strings)
+      terms->postings.emplace_back(&Postings(element_, s));
+    return true;
+  }
+
+  static void Combine(const Terms& terms, SelectionSet* rows) {
+    if (terms.postings.empty()) return;
+    *rows = *terms.postings.front();
+    for (size_t i = 1; i < terms.postings.size(); i++) {
+      if (terms.intersect)
+        *rows &= *terms.postings.at(i);
+      else
+        *rows |= *terms.postings.at(i);
+    }
+  }
+
+  // exact for a union, the smallest posting bounds an intersection
+  static size_t Count(const Terms& terms) {
+    size_t count = terms.intersect ? SIZE_MAX : 0;
+    for (const auto* postings : terms.postings)
+      count = terms.intersect ? std::min(count, postings->Count())
+                              : count + postings->Count();
+    return terms.postings.empty() ? 0 : count;
+  }
+
+ public:
+  IndexInverted(const std::string& property_path) : Index(property_path) {
+    terms_[BinCompPred][Equal] = [this](auto n, auto terms) -> bool {
+      int property = PropertyChild(n);
+      if (property < 0) return false;
+      const AstNodePtr& other = n->children().at(1 - property);
+      if (not other->constant() or
+          not std::holds_alternative<std::string>(other->origin_value()))
+        return false;
+      terms->postings.emplace_back(
+          &Postings(scalar_, std::get<std::string>(other->origin_value())));
+      return true;
+    };
+    terms_[IsInListPred][In] = [this](auto n, auto terms) -> bool {
+      if (PropertyChild(n) != 0) return false;
+      const auto& items = n->children().at(1)->children();
+      for (const auto& item : items) {
+        if (not item->constant() or
+            not std::holds_alternative<std::string>(item->origin_value()))
+          return false;
+        terms->postings.emplace_back(
+            &Postings(scalar_, std::get<std::string>(item->origin_value())));
+      }
+      return true;
+    };
+
+    // A_CONTAINS(prop, [...]) and A_CONTAINEDBY([...], prop): every element
+    terms_[ArrayPred][A_Contains] = [this](auto n, auto terms) -> bool {
+      terms->intersect = true;
+      return PropertyChild(n) == 0 and Elements(n, 0, terms) and
+             not terms->postings.empty();
+    };
+    terms_[ArrayPred][A_ContainedBy] = [this](auto n, auto terms) -> bool {
+      terms->intersect = true;
+      return PropertyChild(n) == 1 and Elements(n, 1, terms) and
+             not terms->postings.empty();
+    };
+    terms_[ArrayPred][A_Equals] = [this](auto n, auto terms) -> bool {
+      // equal arrays contain every element, but may contain more
+      terms->intersect = true;
+      terms->exact = false;
+      int property = PropertyChild(n);
+      return property >= 0 and Elements(n, property, terms) and
+             not terms->postings.empty();
+    };
+    terms_[ArrayPred][A_Overlaps] = [this](auto n, auto terms) -> bool {
+      int property = PropertyChild(n);
+      return property >= 0 and Elements(n, property, terms);
+    };
+
+    for (const auto& [type, ops] : terms_) {
+      for (const auto& [op, to_terms] : ops) {
+        lookups_[type][op] = [to_terms](auto n, auto rows,
+                                        auto exact) -> bool {
+          Terms terms;
+          if (not to_terms(n, &terms)) return false;
+          Combine(terms, rows);
+          *exact = terms.exact;
+          return true;
+        };
+        estimates_[type][op] = [to_terms](auto n, auto rows,
+                                          auto exact) -> bool {
+          Terms terms;
+          if (not to_terms(n, &terms)) return false;
+          *rows = Count(terms);
+          *exact = terms.exact;
+          return true;
+        };
+      }
+    }
+  }
+
+  std::string name() const override { return "inverted"; }
+
+  size_t size() const override { return rows_.Count(); }
+
+  void Insert(uint32_t ordinal, const ValueT& value) override {
+    Erase(ordinal);
+    std::string_view s;
+    bool scalar = GetString(value, &s);
+    if (not scalar and not std::holds_alternative<ArrayType>(value)) return;
+    if (keys_.size() <= ordinal) keys_.resize(ordinal + 1);
+    Keys& keys = keys_.at(ordinal);
+    if (scalar) {
+      auto it = scalar_.try_emplace(std::string(s)).first;
+      it->second.Add(ordinal);
+      keys.scalar = &it->first;
+    } else {
+      for (const auto& element : std::get<ArrayType>(value)) {
+        if (not GetString(element.value, &s)) continue;
+        auto it = element_.try_emplace(std::string(s)).first;
+        if (it->second.Contains(ordinal)) continue;  // repeated element
+        it->second.Add(ordinal);
+        keys.elements.emplace_back(&it->first);
+      }
+    }
+    rows_.Add(ordinal);
+  }
+
+  void Erase(uint32_t ordinal) override {
+    if (not rows_.Contains(ordinal)) return;
+    Keys& keys = keys_.at(ordinal);
+    if (keys.scalar != nullptr) Remove(ordinal, keys.scalar, &scalar_);
+    for (const auto* key : keys.elements) Remove(ordinal, key, &element_);
+    keys = Keys();
+    rows_.Remove(ordinal);
+  }
+
+  void Clear() override {
+    scalar_.clear();
+    element_.clear();
+    rows_.Clear();
+    keys_.clear();
+  }
+};
+
+inline const SelectionSet IndexInverted::empty_;
+
+}  // namespace cql2cpp
@@ -0,0 +1,261 @@
+/*
+ * File Name: range.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/22
+ *
+ */
+
+#pragma once
+
+#include <cql2cpp/evaluator/value_compare.h>
+
+#include <cmath>
+#include <limits>
+
+#include "index.h"
+
+namespace cql2cpp {
+
+// Numeric values of one property sorted in ascending order. Comparisons and
+// BETWEEN against a numeric literal become two binary searches bounding the
+// matching range. New values go to an unsorted tail which is scanned
+// linearly until Commit merges it, erased values stay as stale entries until
+// Commit drops them. Values are kept as doubles, which merge neighbouring
+// integers beyond 2^53, so lookups with bounds that far out are inexact.
+class IndexRange : public Index {
+ private:
+  using Entry = std::pair<double, uint32_t>;
+  std::vector<Entry> entries_;
+  size_t sorted_ = 0;           // entries_[0, sorted_) are sorted
+  std::vector<double> values_;  // current value of each ordinal, NaN if none
+  size_t size_ = 0;
+  size_t stale_ = 0;  // entries whose ordinal has another value or none
+
+  // doubles hold every integer up to 2^53 only
+  static constexpr double kExactInteger = 9007199254740992.0;
+
+  // Commit merges the tail once it is longer than this or than 1/16 of the
+  // sorted entries, and drops stale entries once they are 1/4 of all.
+  static constexpr size_t kMinTail = 1024;
+
+  bool Live(const Entry& entry) const {
+    return entry.second < values_.size() and
+           values_.at(entry.second) == entry.first;
+  }
+
+  static bool Numeric(const ValueT& value, double* number) {
+    if (std::holds_alternative<int64_t>(value))
+      *number = std::get<int64_t>(value);
+    else if (std::holds_alternative<uint64_t>(value))
+      *number = std::get<uint64_t>(value);
+    else if (std::holds_alternative<double>(value))
+      *number = std::get<double>(value);
+    else
+      return false;
+    return not std::isnan(*number);
+  }
+
+  static bool NumericLiteral(const AstNodePtr& n, double* number) {
+    return n->constant() and Numeric(n->origin_value(), number);
+  }
+
+  // values in a range, bounds are inclusive if closed
+  struct Bounds {
+    double lower = -std::numeric_limits<double>::infinity();
+    bool lower_closed = true;
+    double upper = std::numeric_limits<double>::infinity();
+    bool upper_closed = true;
+  };
+  using NodeBounds = std::function<bool(const AstNodePtr, Bounds*)>;
+  std::map<NodeType, std::map<Operator, NodeBounds>> bounds_;
+
+  static bool Beyond(double value) {
+    return not std::isinf(value) and std::abs(value) >= kExactInteger;
+  }
+
+  // True if the index decides the bounds: a value rounded to a double keeps
+  // its order to bounds holding every integer around them. Otherwise the
+  // bounds are closed, so that values rounded to one are candidates for the
+  // evaluator.
+  static bool Exact(Bounds* b) {
+    if (not Beyond(b->lower) and not Beyond(b->upper)) return true;
+    b->lower_closed = true;
+    b->upper_closed = true;
+    return false;
+  }
+
+  static bool InBounds(const Bounds& b, double value) {
+    return (b.lower_closed ? value >= b.lower : value > b.lower) and
+           (b.upper_closed ? value <= b.upper : value < b.upper);
+  }
+
+  // the sorted entries in bounds
+  std::pair<std::vector<Entry>::const_iterator,
+            std::vector<Entry>::const_iterator>
+  Span(const Bounds& b) const {
+    const uint32_t max = std::numeric_limits<uint32_t>::max();
+    auto sorted_end = entries_.begin() + sorted_;
+    auto begin =
+        b.lower_closed
+            ? std::lower_bound(entries_.begin(), sorted_end, Entry(b.lower, 0))
+            : std::upper_bound(entries_.begin(), sorted_end,
+                               Entry(b.lower, max));
+    auto end = b.upper_closed
+                   ? std::upper_bound(begin, sorted_end, Entry(b.upper, max))
+                   : std::lower_bound(begin, sorted_end, Entry(b.upper, 0));
+    return {begin, end};
+  }
+
+  // property OP literal, with the operator mirrored if the literal is on
+  // the left hand side
+  bool Compare(const AstNodePtr& n, Operator op, Bounds* b) const {
+    int property = PropertyChild(n);
+    double value;
+    if (property < 0 or
+        not NumericLiteral(n->children().at(1 - property), &value))
+      return false;
+    if (property == 1) {
+      const std::map<Operator, Operator> mirror = {
+          {Greater, Lesser},
+          {Lesser, Greater},
+          {GreaterEqual, LesserEqual},
+          {LesserEqual, GreaterEqual},
+          {Equal, Equal}};
+      op = mirror.at(op);
+    }
+
+    switch (op) {
+      case Greater:
+        b->lower = value;
+        b->lower_closed = false;
+        break;
+      case GreaterEqual:
+        b->lower = value;
+        break;
+      case Lesser:
+        b->upper = value;
+        b->upper_closed = false;
+        break;
+      case LesserEqual:
+        b->upper = value;
+        break;
+      case Equal:
+        // equal within kEpsilon, see EvaluatorCompare
+        b->lower = value - kEpsilon;
+        b->lower_closed = false;
+        b->upper = value + kEpsilon;
+        b->upper_closed = false;
+        break;
+      default:
+        return false;
+    }
+    return true;
+  }
+
+ public:
+  IndexRange(const std::string& property_path) : Index(property_path) {
+    for (Operator op : {Greater, GreaterEqual, Lesser, LesserEqual, Equal})
+      bounds_[BinCompPred][op] = [this, op](auto n, auto b) -> bool {
+        return Compare(n, op, b);
+      };
+    bounds_[IsBetweenPred][Between] = [this](auto n, auto b) -> bool {
+      return PropertyChild(n) == 0 and
+             NumericLiteral(n->children().at(1), &b->lower) and
+             NumericLiteral(n->children().at(2), &b->upper);
+    };
+
+    for (const auto& [type, ops] : bounds_) {
+      for (const auto& [op, to_bounds] : ops) {
+        lookups_[type][op] = [this, to_bounds](auto n, auto rows,
+                                               auto exact) -> bool {
+          Bounds b;
+          if (not to_bounds(n, &b)) return false;
+          *exact = Exact(&b);
+          auto [begin, end] = Span(b);
+          std::vector<uint32_t> ordinals;
+          ordinals.reserve(end - begin);
+          for (auto it = begin; it != end; ++it)
+            if (stale_ == 0 or Live(*it)) ordinals.emplace_back(it->second);
+          for (size_t i = sorted_; i < entries_.size(); i++)
+            if (InBounds(b, entries_.at(i).first) and
+                (stale_ == 0 or Live(entries_.at(i))))
+              ordinals.emplace_back(entries_.at(i).second);
+          *rows = SelectionSet(std::move(ordinals));
+          return true;
+        };
+        estimates_[type][op] = [this, to_bounds](auto n, auto rows,
+                                                 auto exact) -> bool {
+          Bounds b;
+          if (not to_bounds(n, &b)) return false;
+          *exact = Exact(&b);
+          auto [begin, end] = Span(b);
+          *rows = end - begin;
+          for (size_t i = sorted_; i < entries_.size(); i++)
+            if (InBounds(b, entries_.at(i).first)) (*rows)++;
+          return true;
+        };
+      }
+    }
+  }
+
+  std::string name() const override { return "range"; }
+
+  size_t size() const override { return size_; }
+
+  void Insert(uint32_t ordinal, const ValueT& value) override {
+    Erase(ordinal);
+    double number;
+    if (not Numeric(value, &number)) return;
+    if (values_.size() <= ordinal)
+      values_.resize(ordinal + 1, std::numeric_limits<double>::quiet_NaN());
+    values_.at(ordinal) = number;
+    entries_.emplace_back(number, ordinal);
+    size_++;
+  }
+
+  void Erase(uint32_t ordinal) override {
+    if (ordinal >= values_.size() or std::isnan(values_.at(ordinal))) return;
+    values_.at(ordinal) = std::numeric_limits<double>::quiet_NaN();
+    size_--;
+    stale_++;
+  }
+
+  void Commit() override {
+    // drop stale entries and duplicates left by erasing and inserting the
+    // same value again
+    if (stale_ > 0 and stale_ * 4 >= entries_.size()) {
+      entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                    [this](const Entry& entry) {
+                                      return not Live(entry);
+                                    }),
+                     entries_.end());
+      std::sort(entries_.begin(), entries_.end());
+      entries_.erase(std::unique(entries_.begin(), entries_.end()),
+                     entries_.end());
+      sorted_ = entries_.size();
+      stale_ = 0;
+      return;
+    }
+
+    // sort the tail and merge it into the sorted entries
+    size_t tail = entries_.size() - sorted_;
+    if (tail == 0 or tail < std::max(kMinTail, sorted_ / 16)) return;
+    std::sort(entries_.begin() + sorted_, entries_.end());
+    std::inplace_merge(entries_.begin(), entries_.begin() + sorted_,
+                       entries_.end());
+    sorted_ = entries_.size();
+  }
+
+  void Clear() override {
+    entries_.clear();
+    sorted_ = 0;
+    values_.clear();
+    size_ = 0;
+    stale_ = 0;
+  }
+};
+
+}  // namespace cql2cpp
@@ -0,0 +1,145 @@
+/*
+ * File Name: spatial.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/24
+ *
+ */
+
+#pragma once
+
+#include <geos/geom/Envelope.h>
+#include <geos/geom/Geometry.h>
+#include <geos/index/quadtree/Quadtree.h>
+
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+#include "index.h"
+
+namespace cql2cpp {
+
+// Envelopes of the geometries of one property in a quadtree. A spatial
+// predicate other than S_DISJOINT against a literal geometry selects the
+// features whose envelope intersects the envelope of the literal, which is
+// only a superset of the result, so the predicate stays residual.
+class IndexSpatial : public Index {
+ private:
+  std::unique_ptr<geos::index::quadtree::Quadtree> tree_;
+  std::unordered_map<uint32_t, geos::geom::Envelope> envelopes_;
+  geos::geom::Envelope extent_;  // only grows, for estimates
+
+  static bool GetEnvelope(const ValueT& value, geos::geom::Envelope* env) {
+    if (std::holds_alternative<const geos::geom::Geometry*>(value) and
+        std::get<const geos::geom::Geometry*>(value) != nullptr)
+      *env = *std::get<const geos::geom::Geometry*>(value)
+                  ->getEnvelopeInternal();
+    else if (std::holds_alternative<const geos::geom::Envelope*>(value) and
+             std::get<const geos::geom::Envelope*>(value) != nullptr)
+      *env = *std::get<const geos::geom::Envelope*>(value);
+    else
+      return false;
+    return not env->isNull();
+  }
+
+  // envelope of the literal on the other side of the property
+  bool Window(const AstNodePtr& n, geos::geom::Envelope* env) const {
+    int property = PropertyChild(n);
+    if (property < 0 or n->children().size() != 2) return false;
+    const AstNodePtr& other = n->children().at(1 - property);
+    return other->constant() and GetEnvelope(other->origin_value(), env);
+  }
+
+  static void* Item(uint32_t ordinal) {
+    return reinterpret_cast<void*>(static_cast<uintptr_t>(ordinal));
+  }
+
+ public:
+  IndexSpatial(const std::string& property_path)
+      : Index(property_path),
+        tree_(std::make_unique<geos::index::quadtree::Quadtree>()) {
+    // every predicate but S_DISJOINT is false for geometries with disjoint
+    // envelopes
+    for (Operator op : {S_Contains, S_Crosses, S_Equals, S_Intersects,
+                        S_Overlaps, S_Touches, S_Within}) {
+      lookups_[SpatialPred][op] = [this](auto n, auto rows,
+                                         auto exact) -> bool {
+        geos::geom::Envelope window;
+        if (not Window(n, &window)) return false;
+        std::vector<void*> items;
+        tree_->query(&window, items);
+        std::vector<uint32_t> ordinals;
+        for (void* item : items) {
+          uint32_t ordinal = reinterpret_cast<uintptr_t>(item);
+          // the quadtree returns the items of every node it visits
+          if (envelopes_.at(ordinal).intersects(window))
+            ordinals.emplace_back(ordinal);
+        }
+        *rows = SelectionSet(std::move(ordinals));
+        *exact = false;
+        return true;
+      };
+
+      // assume envelopes are uniformly distributed over the extent
+      estimates_[SpatialPred][op] = [this](auto n, auto rows,
+                                           auto exact) -> bool {
+        geos::geom::Envelope window;
+        if (not Window(n, &window)) return false;
+        geos::geom::Envelope overlap;
+        if (not extent_.intersection(window, overlap)) {
+          *rows = 0;
+        } else if (extent_.getArea() == 0) {
+          *rows = envelopes_.size();
+        } else {
+          *rows = std::ceil(
+              envelopes_.size() *
+              std::min(1.0, overlap.getArea() / extent_.getArea()));
+        }
+        *exact = false;
+        return true;
+      };
+    }
+  }
+
+  std::string name() const override { return "spatial"; }
+
+  size_t size() const override { return envelopes_.size(); }
+
+  void Insert(uint32_t ordinal, const ValueT& value) override {
+    Erase(ordinal);
+    geos::geom::Envelope env;
+    if (not GetEnvelope(value, &env)) return;
+    envelopes_[ordinal] = env;
+    tree_->insert(&envelopes_.at(ordinal), Item(ordinal));
+    extent_.expandToInclude(env);
+  }
+
+  // by the envelope of the feature, which sources keeping geometries
+  // undecoded answer without building the geometry
+  void Insert(uint32_t ordinal, const FeatureSource& feature) override {
+    geos::geom::Envelope env;
+    const geos::geom::Envelope* envelope = &env;
+    if (feature.get_envelope(property_path(), &env))
+      Insert(ordinal, ValueT(envelope));
+    else
+      Insert(ordinal, feature.get_property(property_path()));
+  }
+
+  void Erase(uint32_t ordinal) override {
+    auto it = envelopes_.find(ordinal);
+    if (it == envelopes_.end()) return;
+    tree_->remove(&it->second, Item(ordinal));
+    envelopes_.erase(it);
+  }
+
+  void Clear() override {
+    tree_ = std::make_unique<geos::index::quadtree::Quadtree>();
+    envelopes_.clear();
+    extent_.setToNull();
+  }
+};
+
+}  // namespace cql2cpp
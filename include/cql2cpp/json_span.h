@@ -0,0 +1,208 @@
+/*
+ * File Name: json_span.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/28
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace cql2cpp {
+
+// Find values in JSON text without building a DOM. A value is the span of
+// text it occupies, so strings without escapes can be used in place. The
+// structure is checked as far as it is scanned, nested values are skipped
+// by matching brackets only.
+class JsonSpan {
+ public:
+  static constexpr size_t npos = std::string_view::npos;
+
+  using MemberCallback =
+      std::function<bool(std::string_view key, std::string_view value)>;
+  using ElementCallback = std::function<bool(std::string_view value)>;
+
+  static size_t SkipSpace(std::string_view text, size_t pos) {
+    while (pos < text.size() and (text[pos] == ' ' or text[pos] == '\n' or
+                                  text[pos] == '\r' or text[pos] == '\t'))
+      pos++;
+    return pos;
+  }
+
+  // pos is at the opening quote, returns the position after the closing one
+  static size_t SkipString(std::string_view text, size_t pos) {
+    for (pos++; pos < text.size(); pos++) {
+      if (text[pos] == '\\')
+        pos++;
+      else if (text[pos] == '"')
+        return pos + 1;
+    }
+    return npos;
+  }
+
+  // pos is at the first character of a value, returns the position after it
+  static size_t SkipValue(std::string_view text, size_t pos) {
+    if (pos >= text.size()) return npos;
+    char c = text[pos];
+    if (c == '"') return SkipString(text, pos);
+    if (c == '{' or c == '[') {
+      int depth = 0;
+      for (; pos < text.size(); pos++) {
+        c = text[pos];
+        if (c == '"') {
+          pos = SkipString(text, pos);
+          if (pos == npos) return npos;
+          pos--;
+        } else if (c == '{' or c == '[') {
+          depth++;
+        } else if (c == '}' or c == ']') {
+          if (--depth == 0) return pos + 1;
+        }
+      }
+      return npos;
+    }
+    size_t begin = pos;
+    while (pos < text.size() and text[pos] != ',' and text[pos] != '}' and
+           text[pos] != ']' and text[pos] != ' ' and text[pos] != '\n' and
+           text[pos] != '\r' and text[pos] != '\t')
+      pos++;
+    return pos == begin ? npos : pos;
+  }
+
+  // call f for the members of an object in order until it returns false,
+  // keys are raw, i.e. still escaped
+  static bool ForEachMember(std::string_view object, const MemberCallback& f) {
+    size_t pos = SkipSpace(object, 0);
+    if (pos >= object.size() or object[pos] != '{') return false;
+    pos = SkipSpace(object, pos + 1);
+    if (pos < object.size() and object[pos] == '}') return true;
+    while (pos < object.size()) {
+      if (object[pos] != '"') return false;
+      size_t key_end = SkipString(object, pos);
+      if (key_end == npos) return false;
+      std::string_view key = object.substr(pos + 1, key_end - pos - 2);
+      pos = SkipSpace(object, key_end);
+      if (pos >= object.size() or object[pos] != ':') return false;
+      pos = SkipSpace(object, pos + 1);
+      size_t value_end = SkipValue(object, pos);
+      if (value_end == npos) return false;
+      if (not f(key, object.substr(pos, value_end - pos))) return true;
+      pos = SkipSpace(object, value_end);
+      if (pos >= object.size()) return false;
+      if (object[pos] == '}') return true;
+      if (object[pos] != ',') return false;
+      pos = SkipSpace(object, pos + 1);
+    }
+    return false;
+  }
+
+  // call f for the elements of an array in order until it returns false
+  static bool ForEachElement(std::string_view array, const ElementCallback& f) {
+    size_t pos = SkipSpace(array, 0);
+    if (pos >= array.size() or array[pos] != '[') return false;
+    pos = SkipSpace(array, pos + 1);
+    if (pos < array.size() and array[pos] == ']') return true;
+    while (pos < array.size()) {
+      size_t value_end = SkipValue(array, pos);
+      if (value_end == npos) return false;
+      if (not f(array.substr(pos, value_end - pos))) return true;
+      pos = SkipSpace(array, value_end);
+      if (pos >= array.size()) return false;
+      if (array[pos] == ']') return true;
+      if (array[pos] != ',') return false;
+      pos = SkipSpace(array, pos + 1);
+    }
+    return false;
+  }
+
+  // the value of the first member named key
+  static bool FindMember(std::string_view object, std::string_view key,
+                         std::string_view* value) {
+    bool found = false;
+    bool valid = ForEachMember(object, [&](auto k, auto v) {
+      if (k == key or (k.find('\\') != npos and Unescape(k) == key)) {
+        *value = v;
+        found = true;
+      }
+      return not found;
+    });
+    return valid and found;
+  }
+
+  // decode the characters between the quotes of a string
+  static std::string Unescape(std::string_view raw) {
+    std::string s;
+    s.reserve(raw.size());
+    for (size_t i = 0; i < raw.size(); i++) {
+      if (raw[i] != '\\' or i + 1 == raw.size()) {
+        s += raw[i];
+        continue;
+      }
+      char c = raw[++i];
+      switch (c) {
+        case 'b': s += '\b'; break;
+        case 'f': s += '\f'; break;
+        case 'n': s += '\n'; break;
+        case 'r': s += '\r'; break;
+        case 't': s += '\t'; break;
+        case 'u': {
+          uint32_t code = Hex(raw, i + 1);
+          i += 4;
+          // a surrogate pair encodes one code point beyond the BMP
+          if (code >= 0xD800 and code < 0xDC00 and i + 6 < raw.size() and
+              raw.substr(i + 1, 2) == "\\u") {
+            uint32_t low = Hex(raw, i + 3);
+            if (low >= 0xDC00 and low < 0xE000) {
+              code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+              i += 6;
+            }
+          }
+          AppendUtf8(code, &s);
+          break;
+        }
+        default: s += c;  // '"', '\\' and '/'
+      }
+    }
+    return s;
+  }
+
+ private:
+  static uint32_t Hex(std::string_view raw, size_t pos) {
+    uint32_t code = 0;
+    for (size_t i = pos; i < pos + 4 and i < raw.size(); i++) {
+      char c = raw[i];
+      code = code * 16 + (c >= '0' and c <= '9'   ? c - '0'
+                          : c >= 'a' and c <= 'f' ? c - 'a' + 10
+                          : c >= 'A' and c <= 'F' ? c - 'A' + 10
+                                                  : 0);
+    }
+    return code;
+  }
+
+  static void AppendUtf8(uint32_t code, std::string* s) {
+    if (code < 0x80) {
+      *s += static_cast<char>(code);
+    } else if (code < 0x800) {
+      *s += static_cast<char>(0xC0 | (code >> 6));
+      *s += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+      *s += static_cast<char>(0xE0 | (code >> 12));
+      *s += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+      *s += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+      *s += static_cast<char>(0xF0 | (code >> 18));
+      *s += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+      *s += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+      *s += static_cast<char>(0x80 | (code & 0x3F));
+    }
+  }
+};
+
+}  // namespace cql2cpp
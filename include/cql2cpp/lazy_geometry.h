@@ -0,0 +1,224 @@
+/*
+ * File Name: lazy_geometry.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/31
+ *
+ */
+
+#pragma once
+
+#include <geos/geom/Envelope.h>
+#include <geos/geom/Geometry.h>
+#include <geos/io/WKBReader.h>
+#include <geos/io/WKBWriter.h>
+#include <glog/logging.h>
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cql2cpp {
+
+class LazyGeometry;
+
+// The geometries built most recently by LazyGeometry, at most capacity of
+// them. Building one more drops the least recently used. Thread safe.
+class GeometryCache {
+ private:
+  mutable std::mutex mutex_;
+  size_t capacity_;
+  std::list<const LazyGeometry*> order_;  // most recently used first
+  std::unordered_map<const LazyGeometry*,
+                     std::list<const LazyGeometry*>::iterator>
+      entries_;
+  size_t builds_ = 0;
+
+  friend class LazyGeometry;
+
+  // a geometry is used, return the one to drop if any
+  const LazyGeometry* Touch(const LazyGeometry* geometry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(geometry);
+    if (it != entries_.end()) {
+      order_.splice(order_.begin(), order_, it->second);
+      return nullptr;
+    }
+    builds_++;
+    order_.emplace_front(geometry);
+    entries_.emplace(geometry, order_.begin());
+    if (order_.size() <= capacity_) return nullptr;
+    const LazyGeometry* oldest = order_.back();
+    Erase(oldest);
+    return oldest;
+  }
+
+  void Forget(const LazyGeometry* geometry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Erase(geometry);
+  }
+
+  bool Contains(const LazyGeometry* geometry) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.find(geometry) != entries_.end();
+  }
+
+  void Erase(const LazyGeometry* geometry) {
+    auto it = entries_.find(geometry);
+    if (it == entries_.end()) return;
+    order_.erase(it->second);
+    entries_.erase(it);
+  }
+
+ public:
+  // a query reading two geometries of a feature needs both at once
+  GeometryCache(size_t capacity) : capacity_(std::max<size_t>(capacity, 2)) {}
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return order_.size();
+  }
+
+  // geometries built since the cache was created
+  size_t builds() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return builds_;
+  }
+};
+
+// Keeps the geometries pinned on a thread while it lives, so a geometry
+// given by pointer to the evaluator is not freed when another thread makes
+// a GeometryCache drop it. Only the outermost of nested scopes keeps them.
+class GeometryPins {
+ private:
+  std::vector<std::shared_ptr<const geos::geom::Geometry>> pinned_;
+
+  static GeometryPins*& Current() {
+    thread_local GeometryPins* current = nullptr;
+    return current;
+  }
+
+ public:
+  GeometryPins() {
+    if (Current() == nullptr) Current() = this;
+  }
+
+  ~GeometryPins() {
+    if (Current() == this) Current() = nullptr;
+  }
+
+  GeometryPins(const GeometryPins&) = delete;
+  GeometryPins& operator=(const GeometryPins&) = delete;
+
+  // the geometry, kept until the scope of this thread ends if there is one
+  static const geos::geom::Geometry* Pin(
+      std::shared_ptr<const geos::geom::Geometry> geometry) {
+    const geos::geom::Geometry* pointer = geometry.get();
+    if (pointer != nullptr and Current() != nullptr)
+      Current()->pinned_.emplace_back(std::move(geometry));
+    return pointer;
+  }
+};
+
+// A geometry kept as WKB with its envelope. The GEOS geometry is built when
+// it is used and kept, or kept only while it is among the most recently
+// used of a GeometryCache. get() may be called from several threads, a
+// geometry it returns stays valid while it is held after the cache drops
+// it.
+class LazyGeometry {
+ private:
+  std::string wkb_;
+  geos::geom::Envelope envelope_;
+  std::shared_ptr<GeometryCache> cache_;
+  mutable std::mutex mutex_;  // guards geometry_ and invalid_
+  mutable std::shared_ptr<const geos::geom::Geometry> geometry_;
+  mutable bool invalid_ = false;
+
+  // the geometry the cache drops to keep this one, if any
+  const LazyGeometry* Touch() const {
+    if (cache_ == nullptr) return nullptr;
+    return cache_->Touch(this);
+  }
+
+  // Not while holding the mutex of another geometry, which may be dropping
+  // this one. A geometry used again since it was dropped is kept.
+  static void Drop(const LazyGeometry* dropped) {
+    if (dropped == nullptr) return;
+    std::lock_guard<std::mutex> lock(dropped->mutex_);
+    if (not dropped->cache_->Contains(dropped)) dropped->geometry_.reset();
+  }
+
+ public:
+  LazyGeometry(std::string wkb, const geos::geom::Envelope& envelope,
+               std::shared_ptr<GeometryCache> cache = nullptr)
+      : wkb_(std::move(wkb)), envelope_(envelope), cache_(std::move(cache)) {}
+
+  LazyGeometry(const geos::geom::Geometry& geometry,
+               std::shared_ptr<GeometryCache> cache = nullptr)
+      : envelope_(*geometry.getEnvelopeInternal()), cache_(std::move(cache)) {
+    std::stringstream ss;
+    geos::io::WKBWriter writer;
+    writer.setOutputDimension(3);  // keep z if there is one
+    writer.write(geometry, ss);
+    wkb_ = ss.str();
+  }
+
+  // a geometry already built, kept until the cache drops it
+  LazyGeometry(std::unique_ptr<geos::geom::Geometry> geometry,
+               std::shared_ptr<GeometryCache> cache = nullptr)
+      : LazyGeometry(*geometry, std::move(cache)) {
+    geometry_ = std::move(geometry);
+    Drop(Touch());
+  }
+
+  LazyGeometry(const LazyGeometry&) = delete;
+  LazyGeometry& operator=(const LazyGeometry&) = delete;
+
+  ~LazyGeometry() {
+    if (cache_ != nullptr) cache_->Forget(this);
+  }
+
+  const geos::geom::Envelope& envelope() const { return envelope_; }
+
+  const std::string& wkb() const { return wkb_; }
+
+  bool built() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return geometry_ != nullptr;
+  }
+
+  // nullptr if the WKB is invalid
+  std::shared_ptr<const geos::geom::Geometry> get() const {
+    const LazyGeometry* dropped;
+    std::shared_ptr<const geos::geom::Geometry> geometry;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (invalid_) return nullptr;
+      dropped = Touch();
+      if (geometry_ == nullptr) {
+        try {
+          geometry_ = geos::io::WKBReader().read(
+              reinterpret_cast<const unsigned char*>(wkb_.data()),
+              wkb_.size());
+        } catch (const std::exception& e) {
+          LOG(WARNING) << "invalid geometry: " << e.what();
+        }
+        if (geometry_ == nullptr) {
+          invalid_ = true;
+          if (cache_ != nullptr) cache_->Forget(this);
+        }
+      }
+      geometry = geometry_;
+    }
+    Drop(dropped);
+    return geometry;
+  }
+};
+
+}  // namespace cql2cpp
@@ -0,0 +1,163 @@
+/*
+ * File Name: like_matcher.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/06
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast_node.h"
+
+namespace cql2cpp {
+
+// A LIKE pattern compiled once: % matches any characters, _ one character
+// and \ escapes the next one. Patterns whose only wildcards are a leading
+// or trailing % are answered by one comparison or substring search, others
+// by simulating a small NFA over the characters of the string. Characters
+// are UTF-8 code points.
+class LikeMatcher : public CompiledState {
+ public:
+  enum Kind { Exact, Prefix, Suffix, Contains, General };
+
+ private:
+  struct Token {
+    enum { Char, One, Any } kind;
+    std::string text;  // the code point of a Char
+  };
+
+  Kind kind_;
+  std::string literal_;         // the text of all kinds but General
+  std::vector<Token> tokens_;  // of General, no two Any in a row
+
+  static size_t Length(unsigned char c) {
+    return c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xe ? 3
+                        : (c >> 3) == 0x1e ? 4 : 1;
+  }
+
+  // the character at i, truncated at the end of s
+  static std::string_view Next(std::string_view s, size_t i) {
+    return s.substr(i, Length(s.at(i)));
+  }
+
+  bool Find(std::string_view s) const {
+    if (literal_.empty()) return true;
+    const char* begin = s.data();
+    const char* end = s.data() + s.size();
+    const char first = literal_.front();
+    while (static_cast<size_t>(end - begin) >= literal_.size()) {
+      begin = static_cast<const char*>(
+          std::memchr(begin, first, end - begin - literal_.size() + 1));
+      if (begin == nullptr) return false;
+      if (std::memcmp(begin, literal_.data(), literal_.size()) == 0)
+        return true;
+      begin++;
+    }
+    return false;
+  }
+
+  // states are the numbers of tokens matched, a state before an Any also
+  // reaches the one after it
+  bool Simulate(std::string_view s) const {
+    size_t n = tokens_.size();
+    std::vector<char> current(n + 1, 0), next(n + 1, 0);
+    auto close = [&](std::vector<char>* states) {
+      for (size_t t = 0; t < n; t++)
+        if ((*states)[t] and tokens_[t].kind == Token::Any)
+          (*states)[t + 1] = 1;
+    };
+    current[0] = 1;
+    close(&current);
+    for (size_t i = 0; i < s.size();) {
+      std::string_view c = Next(s, i);
+      i += c.size();
+      std::fill(next.begin(), next.end(), 0);
+      bool alive = false;
+      for (size_t t = 0; t < n; t++) {
+        if (not current[t]) continue;
+        const Token& token = tokens_[t];
+        if (token.kind == Token::Any)
+          next[t] = 1;
+        else if (token.kind == Token::One or token.text == c)
+          next[t + 1] = 1;
+        else
+          continue;
+        alive = true;
+      }
+      if (not alive) return false;
+      close(&next);
+      current.swap(next);
+    }
+    return current[n];
+  }
+
+ public:
+  explicit LikeMatcher(std::string_view pattern) {
+    for (size_t i = 0; i < pattern.size();) {
+      char c = pattern.at(i);
+      if (c == '%') {
+        if (tokens_.empty() or tokens_.back().kind != Token::Any)
+          tokens_.push_back({Token::Any, ""});
+        i++;
+      } else if (c == '_') {
+        tokens_.push_back({Token::One, ""});
+        i++;
+      } else {
+        if (c == '\\' and i + 1 < pattern.size()) i++;
+        std::string_view character = Next(pattern, i);
+        tokens_.push_back({Token::Char, std::string(character)});
+        i += character.size();
+      }
+    }
+
+    // the characters between a leading and a trailing Any
+    size_t begin = 0, end = tokens_.size();
+    bool leading = begin < end and tokens_.at(begin).kind == Token::Any;
+    if (leading) begin++;
+    bool trailing = begin < end and tokens_.at(end - 1).kind == Token::Any;
+    if (trailing) end--;
+    for (size_t t = begin; t < end; t++) {
+      if (tokens_.at(t).kind != Token::Char) {
+        kind_ = General;
+        literal_.clear();
+        return;
+      }
+      literal_ += tokens_.at(t).text;
+    }
+    kind_ = leading ? (trailing ? Contains : Suffix)
+                    : (trailing ? Prefix : Exact);
+    tokens_.clear();
+  }
+
+  Kind kind() const { return kind_; }
+
+  bool Match(std::string_view s) const {
+    switch (kind_) {
+      case Exact:
+        return s == literal_;
+      case Prefix:
+        return s.size() >= literal_.size() and
+               s.compare(0, literal_.size(), literal_) == 0;
+      case Suffix:
+        return s.size() >= literal_.size() and
+               s.compare(s.size() - literal_.size(), literal_.size(),
+                         literal_) == 0;
+      case Contains:
+        return Find(s);
+      case General:
+        return Simulate(s);
+    }
+    return false;
+  }
+};
+
+}  // namespace cql2cpp
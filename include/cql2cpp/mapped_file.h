@@ -0,0 +1,85 @@
+/*
+ * File Name: mapped_file.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/28
+ *
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace cql2cpp {
+
+// A file mapped read only into memory. Pages are loaded by the kernel when
+// they are touched and can be dropped again under memory pressure, so text
+// views into a large file cost no heap memory.
+class MappedFile {
+ private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+
+  MappedFile() = default;
+
+ public:
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    if (data_ != nullptr) munmap(const_cast<char*>(data_), size_);
+  }
+
+  // nullptr on failure, e.g. for pipes, which can not be mapped
+  static std::shared_ptr<MappedFile> Open(const std::string& path,
+                                          std::string* error_msg) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      *error_msg = "can not open " + path + ": " + std::strerror(errno);
+      return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 or not S_ISREG(st.st_mode)) {
+      *error_msg = path + " is not a regular file";
+      close(fd);
+      return nullptr;
+    }
+
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    file->size_ = st.st_size;
+    if (file->size_ > 0) {
+      void* data = mmap(nullptr, file->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+        *error_msg = "can not map " + path + ": " + std::strerror(errno);
+        close(fd);
+        return nullptr;
+      }
+      file->data_ = static_cast<const char*>(data);
+    }
+    close(fd);  // the mapping stays valid
+    return file;
+  }
+
+  // the file is read once from the beginning to the end
+  void AdviseSequential() const {
+    if (data_ != nullptr)
+      madvise(const_cast<char*>(data_), size_, MADV_SEQUENTIAL);
+  }
+
+  std::string_view text() const { return std::string_view(data_, size_); }
+
+  size_t size() const { return size_; }
+};
+
+}  // namespace cql2cpp
@@ -0,0 +1,208 @@
+/*
+ * File Name: metrics_sink.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/04
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace cql2cpp {
+
+// Counts of latencies in buckets growing by powers of two, bucket i holding
+// times below 2^i microseconds and the last one everything slower.
+struct LatencyHistogram {
+  static constexpr size_t kBuckets = 24;  // up to 4.2 s
+
+  std::array<uint64_t, kBuckets> buckets{};
+  uint64_t count = 0;
+  std::chrono::nanoseconds sum{0};
+
+  static size_t Bucket(std::chrono::nanoseconds time) {
+    uint64_t us = std::max<int64_t>(time.count(), 0) / 1000;
+    size_t i = 0;
+    while (us > 0 and i < kBuckets - 1) {
+      us >>= 1;
+      i++;
+    }
+    return i;
+  }
+
+  // exclusive, the last bucket has none
+  static std::chrono::microseconds UpperBound(size_t i) {
+    return i + 1 < kBuckets ? std::chrono::microseconds(1ULL << i)
+                            : std::chrono::microseconds::max();
+  }
+
+  // the upper bound of the bucket holding the q quantile, 0 <= q <= 1
+  std::chrono::microseconds Quantile(double q) const {
+    uint64_t rank = static_cast<uint64_t>(q * count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; i++) {
+      seen += buckets.at(i);
+      if (seen > rank or seen == count) return UpperBound(i);
+    }
+    return UpperBound(kBuckets - 1);
+  }
+};
+
+// Where Cql2Cpp, Evaluator and DbFilter report what they do, for services
+// exporting it to their monitoring. Calls are made from the threads
+// filtering, so implementations must be thread safe. Features are counted
+// once per query where possible, but envelope shortcuts and errors are
+// reported as they happen. This base class discards everything.
+class MetricsSink {
+ public:
+  enum Counter {
+    QueriesCompiled,    // parsed and compiled
+    CompileCacheHits,   // compilations saved by the QueryCache
+    FeaturesEvaluated,  // features a residual was evaluated on
+    Matches,            // features returned
+    IndexPlans,         // queries planned with at least one index lookup
+    FullScans,          // queries planned on every feature
+    EnvelopeShortcuts,  // spatial predicates decided by envelopes
+    UnsupportedErrors,  // no evaluator for a node
+    EvaluationErrors,   // an evaluator failed
+    FunctionErrors,     // a functor failed
+    ResultTypeErrors,   // a query did not evaluate to a boolean
+    kCounters
+  };
+
+  enum Latency {
+    CompileLatency,  // Parse
+    FilterLatency,   // filter, count and for_each, including Parse
+    kLatencies
+  };
+
+  static const char* Name(Counter counter) {
+    static const char* names[kCounters] = {
+        "queries_compiled",   "compile_cache_hits", "features_evaluated",
+        "matches",            "index_plans",        "full_scans",
+        "envelope_shortcuts", "unsupported_errors", "evaluation_errors",
+        "function_errors",    "result_type_errors"};
+    return names[counter];
+  }
+
+  static const char* Name(Latency latency) {
+    static const char* names[kLatencies] = {"compile_latency",
+                                            "filter_latency"};
+    return names[latency];
+  }
+
+  // the default sink of the library
+  static MetricsSink* Noop() {
+    static MetricsSink noop;
+    return &noop;
+  }
+
+  virtual ~MetricsSink() = default;
+
+  virtual void Add(Counter counter, uint64_t n) {}
+
+  virtual void Record(Latency latency, std::chrono::nanoseconds time) {}
+};
+
+struct MetricsSnapshot {
+  std::array<uint64_t, MetricsSink::kCounters> counters{};
+  std::array<LatencyHistogram, MetricsSink::kLatencies> latencies{};
+
+  uint64_t operator[](MetricsSink::Counter counter) const {
+    return counters.at(counter);
+  }
+
+  const LatencyHistogram& operator[](MetricsSink::Latency latency) const {
+    return latencies.at(latency);
+  }
+};
+
+// Accumulates into counters owned by each reporting thread, so reporting
+// takes no lock and shares no cache line with other threads. A thread
+// takes a mutex once to register its counters on its first report.
+// Snapshot sums the counters of all threads, including those which have
+// exited, and may run concurrently with reports.
+class ThreadLocalMetricsSink : public MetricsSink {
+ private:
+  struct alignas(64) Slot {
+    std::array<std::atomic<uint64_t>, kCounters> counters{};
+    std::array<std::array<std::atomic<uint64_t>, LatencyHistogram::kBuckets>,
+               kLatencies>
+        buckets{};
+    std::array<std::atomic<int64_t>, kLatencies> sums{};
+  };
+
+  // only the owning thread writes a slot, so no read-modify-write is needed
+  template <typename T>
+  static void Bump(std::atomic<T>* a, T n) {
+    a->store(a->load(std::memory_order_relaxed) + n,
+             std::memory_order_relaxed);
+  }
+
+  static uint64_t NextId() {
+    static std::atomic<uint64_t> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // never reused, unlike addresses, so stale thread local entries of a
+  // destroyed sink never match a new one
+  const uint64_t id_ = NextId();
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Slot>> slots_;
+
+  Slot* Local() {
+    thread_local std::vector<std::pair<uint64_t, Slot*>> local;
+    for (const auto& [id, slot] : local)
+      if (id == id_) return slot;
+    std::lock_guard<std::mutex> lock(mutex_);
+    slots_.emplace_back(std::make_unique<Slot>());
+    local.emplace_back(id_, slots_.back().get());
+    return slots_.back().get();
+  }
+
+ public:
+  void Add(Counter counter, uint64_t n) override {
+    Bump(&Local()->counters[counter], n);
+  }
+
+  void Record(Latency latency, std::chrono::nanoseconds time) override {
+    Slot* slot = Local();
+    Bump(&slot->buckets[latency][LatencyHistogram::Bucket(time)],
+         uint64_t(1));
+    Bump(&slot->sums[latency], static_cast<int64_t>(time.count()));
+  }
+
+  MetricsSnapshot Snapshot() const {
+    MetricsSnapshot snapshot;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& slot : slots_) {
+      for (size_t c = 0; c < kCounters; c++)
+        snapshot.counters[c] +=
+            slot->counters[c].load(std::memory_order_relaxed);
+      for (size_t l = 0; l < kLatencies; l++) {
+        LatencyHistogram& histogram = snapshot.latencies[l];
+        for (size_t b = 0; b < LatencyHistogram::kBuckets; b++) {
+          uint64_t n = slot->buckets[l][b].load(std::memory_order_relaxed);
+          histogram.buckets[b] += n;
+          histogram.count += n;
+        }
+        histogram.sum += std::chrono::nanoseconds(
+            slot->sums[l].load(std::memory_order_relaxed));
+      }
+    }
+    return snapshot;
+  }
+};
+
+}  // namespace cql2cpp
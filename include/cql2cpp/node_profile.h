@@ -0,0 +1,121 @@
+/*
+ * File Name: node_profile.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/03
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "ast_node.h"
+
+namespace cql2cpp {
+
+// what an Evaluator recorded for one node of a query
+struct NodeProfile {
+  uint64_t calls = 0;
+  uint64_t trues = 0;
+  uint64_t falses = 0;
+  uint64_t nulls = 0;
+  uint64_t errors = 0;
+  std::chrono::nanoseconds time{0};  // including the children
+};
+
+// Per node counters of the evaluations of queries, for Evaluator::
+// set_profile. Nodes are identified by address, so a profile describes the
+// trees it was recorded on as long as they are alive. Not thread safe.
+class EvaluationProfile {
+ private:
+  std::unordered_map<const AstNode*, NodeProfile> nodes_;
+
+ public:
+  void Record(const AstNode* node, bool ok, const ValueT& value,
+              std::chrono::nanoseconds time) {
+    NodeProfile& p = nodes_[node];
+    p.calls++;
+    p.time += time;
+    if (not ok)
+      p.errors++;
+    else if (std::holds_alternative<bool>(value))
+      (std::get<bool>(value) ? p.trues : p.falses)++;
+    else if (std::holds_alternative<NullStruct>(value))
+      p.nulls++;
+  }
+
+  // nullptr if the node was never evaluated
+  const NodeProfile* Get(const AstNode* node) const {
+    auto it = nodes_.find(node);
+    return it == nodes_.end() ? nullptr : &it->second;
+  }
+
+  // time of the node less the time of its children
+  std::chrono::nanoseconds SelfTime(const AstNodePtr& node) const {
+    const NodeProfile* p = Get(node.get());
+    if (p == nullptr) return std::chrono::nanoseconds(0);
+    std::chrono::nanoseconds self = p->time;
+    for (const auto& child : node->children()) {
+      const NodeProfile* c = Get(child.get());
+      if (c != nullptr) self -= c->time;
+    }
+    return std::max(self, std::chrono::nanoseconds(0));
+  }
+
+  // the n evaluated nodes of a tree taking most self time, most first
+  std::vector<AstNodePtr> Top(const AstNodePtr& root, size_t n) const {
+    std::vector<std::pair<std::chrono::nanoseconds, AstNodePtr>> nodes;
+    for (const auto& node : *root)
+      if (Get(node.get()) != nullptr) nodes.emplace_back(SelfTime(node), node);
+    std::stable_sort(
+        nodes.begin(), nodes.end(),
+        [](const auto& a, const auto& b) { return a.first > b.first; });
+    std::vector<AstNodePtr> top;
+    for (size_t i = 0; i < std::min(n, nodes.size()); i++)
+      top.emplace_back(nodes.at(i).second);
+    return top;
+  }
+
+  // a table of the top n nodes of a tree
+  void Print(std::ostream& ous, const AstNodePtr& root, size_t n) const {
+    auto ms = [](std::chrono::nanoseconds t) { return t.count() / 1e6; };
+    ous << std::setw(6) << "node" << std::setw(16) << "operator"
+        << std::setw(12) << "calls" << std::setw(12) << "true"
+        << std::setw(12) << "false" << std::setw(10) << "null"
+        << std::setw(10) << "error" << std::setw(12) << "self ms"
+        << std::setw(12) << "total ms" << std::endl;
+    for (const auto& node : Top(root, n)) {
+      const NodeProfile& p = *Get(node.get());
+      ous << std::setw(6) << node->id() << std::setw(16)
+          << (node->op() != NullOp ? OpName.at(node->op())
+                                   : TypeName.at(node->type()))
+          << std::setw(12) << p.calls << std::setw(12) << p.trues
+          << std::setw(12) << p.falses << std::setw(10) << p.nulls
+          << std::setw(10) << p.errors << std::fixed << std::setprecision(3)
+          << std::setw(12) << ms(SelfTime(node)) << std::setw(12)
+          << ms(p.time) << std::defaultfloat << std::endl;
+    }
+  }
+
+  // the nodes recorded, in no particular order
+  std::vector<const AstNode*> nodes() const {
+    std::vector<const AstNode*> nodes;
+    for (const auto& [node, p] : nodes_) nodes.emplace_back(node);
+    return nodes;
+  }
+
+  bool empty() const { return nodes_.empty(); }
+
+  void Clear() { nodes_.clear(); }
+};
+
+}  // namespace cql2cpp
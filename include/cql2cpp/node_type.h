@@ -34,6 +34,8 @@ enum NodeType {
 
   CharacterClause,
 
+  TemporalInstance,
+
   ArithExpr,
 
   Array,
@@ -59,6 +61,7 @@ const std::map<NodeType, std::string> TypeName {
   TYPE_2_NAME(TemporalPred)
   TYPE_2_NAME(ArrayPred)
   TYPE_2_NAME(CharacterClause)
+  TYPE_2_NAME(TemporalInstance)
   TYPE_2_NAME(ArithExpr)
   TYPE_2_NAME(Array)
   TYPE_2_NAME(PropertyName)
@@ -79,6 +79,11 @@ enum Operator {
   T_StartedBy,
   T_Starts,
 
+  // temporal instances
+  Timestamp,
+  Date,
+  Interval,
+
   // array operators
   A_Equals,
   A_Contains,
@@ -147,6 +152,10 @@ const std::map<Operator, std::string> OpName {
   OP_2_NAME(T_StartedBy)
   OP_2_NAME(T_Starts)
 
+  OP_2_NAME(Timestamp)
+  OP_2_NAME(Date)
+  OP_2_NAME(Interval)
+
   OP_2_NAME(A_ContainedBy)
   OP_2_NAME(A_Contains)
   OP_2_NAME(A_Equals)
@@ -0,0 +1,182 @@
+/*
+ * File Name: query_cache.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/05
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <list>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "ast_node.h"
+
+namespace cql2cpp {
+
+// Compiled queries by their normalised text, at most capacity of them, the
+// least recently used dropped first. The evaluator keeps the values of a
+// feature in the nodes of a tree, so the cache keeps a tree nobody evaluates
+// and gives each caller a clone of it, which is cheaper than parsing and
+// compiling the query again. Thread safe.
+class QueryCache {
+ private:
+  mutable std::mutex mutex_;
+  size_t capacity_;
+  std::list<std::pair<std::string, AstNodePtr>> queries_;  // MRU first
+  std::unordered_map<std::string, decltype(queries_)::iterator> index_;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+
+  static bool IsWordChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) or c == '_' or
+           c == ':' or c == '.';
+  }
+
+  // Keywords the lexer takes the same in upper or lower case. NOT, IS and
+  // NULL are not, as NOT IN, NOT LIKE, IS NULL and IS NOT NULL are tokens
+  // in upper case only.
+  static bool IsKeyword(const std::string& upper) {
+    static const std::set<std::string> keywords = {
+        "AND", "OR", "DIV", "CASEI", "ACCENTI", "TIMESTAMP", "DATE",
+        "INTERVAL", "IN", "LIKE", "BETWEEN", "S_INTERSECTS", "S_EQUALS",
+        "S_DISJOINT", "S_TOUCHES", "S_WITHIN", "S_OVERLAPS", "S_CROSSES",
+        "S_CONTAINS", "T_AFTER", "T_BEFORE", "T_CONTAINS", "T_DISJOINT",
+        "T_DURING", "T_EQUALS", "T_FINISHEDBY", "T_FINISHES", "T_INTERSECTS",
+        "T_MEETS", "T_METBY", "T_OVERLAPPEDBY", "T_OVERLAPS", "T_STARTEDBY",
+        "T_STARTS", "A_EQUALS", "A_CONTAINS", "A_CONTAINEDBY", "A_OVERLAPS"};
+    return keywords.count(upper) > 0;
+  }
+
+  // the word in upper case if it is a keyword, unless it follows NOT
+  static std::string Word(const std::string& word, const std::string& last) {
+    if (last == "NOT") return word;
+    std::string upper = word, lower = word;
+    std::transform(word.begin(), word.end(), upper.begin(),
+                   [](unsigned char c) { return std::toupper(c); });
+    std::transform(word.begin(), word.end(), lower.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    if ((word == upper or word == lower) and IsKeyword(upper)) return upper;
+    return word;
+  }
+
+ public:
+  QueryCache(size_t capacity = 256)
+      : capacity_(std::max<size_t>(capacity, 1)) {}
+
+  // The key of a query: white space outside of quotes collapsed to one
+  // space, or none after an opening bracket or a comma and before a closing
+  // bracket or a comma, and keywords in upper case. Names and strings are
+  // kept as they are, being case sensitive.
+  static std::string Normalize(const std::string& cql2_query) {
+    std::string key;
+    key.reserve(cql2_query.size());
+    bool space = false;
+    std::string last;  // the word before, empty if something else was
+    for (size_t i = 0; i < cql2_query.size();) {
+      char c = cql2_query.at(i);
+      if (std::isspace(static_cast<unsigned char>(c))) {
+        space = true;
+        i++;
+        continue;
+      }
+      if (space and not key.empty() and c != ')' and c != ']' and
+          c != ',' and key.back() != '(' and key.back() != '[' and
+          key.back() != ',')
+        key.push_back(' ');
+      space = false;
+      if (c == '\'' or c == '"') {
+        size_t end = cql2_query.find(c, i + 1);
+        end = end == std::string::npos ? cql2_query.size() : end + 1;
+        key.append(cql2_query, i, end - i);
+        i = end;
+        last.clear();
+      } else if (IsWordChar(c)) {
+        size_t end = i;
+        while (end < cql2_query.size() and IsWordChar(cql2_query.at(end)))
+          end++;
+        std::string word = cql2_query.substr(i, end - i);
+        key.append(Word(word, last));
+        last = word;
+        i = end;
+      } else {
+        key.push_back(c);
+        i++;
+        last.clear();
+      }
+    }
+    return key;
+  }
+
+  // a clone of the cached tree, false if the query of the key is not cached
+  bool Get(const std::string& key, AstNodePtr* root) {
+    AstNodePtr cached;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = index_.find(key);
+      if (it == index_.end()) {
+        misses_++;
+        return false;
+      }
+      hits_++;
+      queries_.splice(queries_.begin(), queries_, it->second);
+      cached = it->second->second;
+    }
+    *root = cached->Clone();
+    return true;
+  }
+
+  // caches a clone, so the caller may go on to evaluate root
+  void Put(const std::string& key, const AstNodePtr& root) {
+    AstNodePtr cached = root->Clone();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      it->second->second = cached;
+      queries_.splice(queries_.begin(), queries_, it->second);
+      return;
+    }
+    queries_.emplace_front(key, cached);
+    index_.emplace(key, queries_.begin());
+    if (queries_.size() > capacity_) {
+      index_.erase(queries_.back().first);
+      queries_.pop_back();
+    }
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queries_.clear();
+    index_.clear();
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queries_.size();
+  }
+
+  size_t capacity() const { return capacity_; }
+
+  // lookups answered by a query compiled before
+  size_t hits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+  }
+
+  // lookups of queries which had to be compiled
+  size_t misses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+  }
+};
+
+}  // namespace cql2cpp
@@ -0,0 +1,188 @@
+/*
+ * File Name: query_planner.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/21
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include "ast_node.h"
+#include "index/index.h"
+
+namespace cql2cpp {
+
+// The access paths chosen for one query: index lookups intersected in order
+// into the candidates, and residual conjuncts evaluated on each candidate.
+struct QueryPlan {
+  struct Access {
+    AstNodePtr conjunct;
+    IndexPtr index;
+    size_t estimate;
+    bool exact;
+    size_t rows;  // candidates left after intersecting this lookup
+  };
+
+  size_t feature_count = 0;
+  std::vector<Access> accesses;
+  std::vector<AstNodePtr> residual;
+  SelectionSet candidates;  // all features if accesses is empty
+
+  static std::string Describe(const AstNodePtr& node) {
+    if (node->type() == PropertyName or node->constant())
+      return value_str(node->origin_value());
+    std::string s = (node->op() == NullOp ? TypeName.at(node->type())
+                                          : OpName.at(node->op())) +
+                    "(";
+    for (size_t i = 0; i < node->children().size(); i++)
+      s += (i == 0 ? "" : ", ") + Describe(node->children().at(i));
+    return s + ")";
+  }
+
+  std::string Explain() const {
+    std::stringstream ss;
+    ss << "features: " << feature_count << std::endl;
+    if (accesses.empty()) ss << "full scan" << std::endl;
+    for (const auto& access : accesses)
+      ss << "index " << access.index->name() << "("
+         << access.index->property_path() << "): "
+         << Describe(access.conjunct) << " estimate " << access.estimate
+         << (access.exact ? " exact" : "") << " rows " << access.rows
+         << std::endl;
+    for (const auto& conjunct : residual)
+      ss << "residual: " << Describe(conjunct) << std::endl;
+    ss << "candidates: " << candidates.Count() << std::endl;
+    return ss.str();
+  }
+};
+
+// Split the top level AND of a query into conjuncts and pick an access path
+// for each of them. Conjuncts are looked up from the index with the smallest
+// estimate, most selective first, as long as the lookup is cheaper than
+// evaluating the conjunct on the candidates found so far. All others are
+// residual.
+class QueryPlanner {
+ private:
+  // evaluating a predicate on a feature costs about as much as producing
+  // this many ordinals from an index
+  static constexpr double kEvaluateCost = 10;
+
+  // an inexact lookup only prunes candidates and must select less than this
+  // fraction of the features to pay off
+  static constexpr double kInexactSelectivity = 0.5;
+
+  const std::map<std::string, std::vector<IndexPtr>>& indexes_;
+
+  // the properties of a conjunct, and those of its intervals
+  static void Properties(const AstNodePtr& conjunct,
+                         std::vector<std::string>* paths) {
+    for (const auto& child : conjunct->children()) {
+      if (child->type() == TemporalInstance) {
+        Properties(child, paths);
+        continue;
+      }
+      if (child->type() == PropertyName and
+          std::holds_alternative<std::string>(child->origin_value()))
+        paths->emplace_back(std::get<std::string>(child->origin_value()));
+    }
+  }
+
+  // the index with the smallest estimate among those of the properties
+  bool Cheapest(const AstNodePtr& conjunct, QueryPlan::Access* access) const {
+    bool found = false;
+    std::vector<std::string> paths;
+    Properties(conjunct, &paths);
+    for (const auto& path : paths) {
+      auto it = indexes_.find(path);
+      if (it == indexes_.end()) continue;
+      for (const auto& index : it->second) {
+        size_t estimate;
+        bool exact;
+        if (not index->Estimate(conjunct, &estimate, &exact)) continue;
+        if (found and (estimate > access->estimate or
+                       (estimate == access->estimate and not exact)))
+          continue;
+        *access = {conjunct, index, estimate, exact, 0};
+        found = true;
+      }
+    }
+    return found;
+  }
+
+ public:
+  QueryPlanner(const std::map<std::string, std::vector<IndexPtr>>& indexes)
+      : indexes_(indexes) {}
+
+  static void Conjuncts(const AstNodePtr& node,
+                        std::vector<AstNodePtr>* conjuncts) {
+    if (node->type() == BoolExpr and node->op() == And) {
+      for (const auto& child : node->children()) Conjuncts(child, conjuncts);
+    } else {
+      conjuncts->emplace_back(node);
+    }
+  }
+
+  // features are the ordinals of all features, as indexes have no entries
+  // for erased ones
+  void Plan(const AstNodePtr& root, const SelectionSet& features,
+            QueryPlan* plan) const {
+    size_t feature_count = features.Count();
+    plan->feature_count = feature_count;
+    std::vector<AstNodePtr> conjuncts;
+    Conjuncts(root, &conjuncts);
+
+    std::vector<QueryPlan::Access> options;
+    for (const auto& conjunct : conjuncts) {
+      QueryPlan::Access access;
+      if (Cheapest(conjunct, &access)) options.emplace_back(access);
+    }
+    std::stable_sort(options.begin(), options.end(),
+                     [](const auto& a, const auto& b) {
+                       return a.estimate < b.estimate;
+                     });
+
+    std::vector<AstNodePtr> answered;
+    double rows = feature_count;
+    for (const auto& option : options) {
+      if (not plan->accesses.empty() and plan->candidates.Empty()) break;
+      bool cheaper = option.estimate < rows * kEvaluateCost;
+      if (not option.exact)
+        cheaper = cheaper and
+                  option.estimate < feature_count * kInexactSelectivity;
+      if (not cheaper) continue;
+
+      SelectionSet selected;
+      bool exact = false;
+      if (not option.index->Lookup(option.conjunct, &selected, &exact))
+        continue;
+      if (plan->accesses.empty())
+        plan->candidates = std::move(selected);
+      else
+        plan->candidates &= selected;
+      rows = plan->candidates.Count();
+
+      plan->accesses.emplace_back(option);
+      plan->accesses.back().exact = exact;
+      plan->accesses.back().rows = rows;
+      if (exact) answered.emplace_back(option.conjunct);
+    }
+
+    // keep the order of the query for the residual
+    for (const auto& conjunct : conjuncts)
+      if (std::find(answered.begin(), answered.end(), conjunct) ==
+          answered.end())
+        plan->residual.emplace_back(conjunct);
+
+    if (plan->accesses.empty()) plan->candidates = features;
+  }
+};
+
+}  // namespace cql2cpp
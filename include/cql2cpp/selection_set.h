@@ -0,0 +1,361 @@
+/*
+ * File Name: selection_set.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/23
+ *
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+namespace cql2cpp {
+
+// A set of feature ordinals stored as a roaring bitmap: ordinals are grouped
+// by their high 16 bits, each group is a sorted array of the low 16 bits
+// while sparse and a 65536 bit bitmap when dense.
+class SelectionSet {
+ private:
+  class Container {
+   private:
+    static constexpr size_t kWords = 1024;
+    static constexpr size_t kMaxArray = 4096;
+
+    std::vector<uint16_t> array_;
+    std::vector<uint64_t> bitmap_;  // empty while the container is an array
+    uint32_t cardinality_ = 0;
+
+    bool is_bitmap() const { return not bitmap_.empty(); }
+
+    void ToBitmap() {
+      bitmap_.assign(kWords, 0);
+      for (uint16_t low : array_)
+        bitmap_[low / 64] |= uint64_t(1) << (low % 64);
+      array_.clear();
+      array_.shrink_to_fit();
+    }
+
+    // recount a bitmap and fall back to an array if it is sparse
+    void ToArray() {
+      array_.clear();
+      array_.reserve(cardinality_);
+      ForEach(0, [this](uint32_t low) { array_.emplace_back(low); });
+      bitmap_.clear();
+      bitmap_.shrink_to_fit();
+    }
+
+    void Shrink() {
+      cardinality_ = 0;
+      for (uint64_t word : bitmap_) cardinality_ += __builtin_popcountll(word);
+      if (cardinality_ <= kMaxArray) ToArray();
+    }
+
+   public:
+    uint32_t cardinality() const { return cardinality_; }
+
+    bool Contains(uint16_t low) const {
+      if (is_bitmap()) return (bitmap_[low / 64] >> (low % 64)) & 1;
+      return std::binary_search(array_.begin(), array_.end(), low);
+    }
+
+    void Add(uint16_t low) {
+      if (is_bitmap()) {
+        uint64_t& word = bitmap_[low / 64];
+        uint64_t bit = uint64_t(1) << (low % 64);
+        if ((word & bit) == 0) cardinality_++;
+        word |= bit;
+        return;
+      }
+      if (array_.empty() or array_.back() < low) {
+        array_.emplace_back(low);
+      } else {
+        auto it = std::lower_bound(array_.begin(), array_.end(), low);
+        if (*it == low) return;
+        array_.insert(it, low);
+      }
+      if (++cardinality_ > kMaxArray) ToBitmap();
+    }
+
+    void Remove(uint16_t low) {
+      if (not Contains(low)) return;
+      if (is_bitmap()) {
+        bitmap_[low / 64] &= ~(uint64_t(1) << (low % 64));
+        // an array again only below the size at which Add made a bitmap, so
+        // alternating Add and Remove do not convert each time
+        if (--cardinality_ < kMaxArray) ToArray();
+      } else {
+        array_.erase(std::lower_bound(array_.begin(), array_.end(), low));
+        cardinality_--;
+      }
+    }
+
+    void And(const Container& other) {
+      if (is_bitmap() and other.is_bitmap()) {
+        for (size_t i = 0; i < kWords; i++) bitmap_[i] &= other.bitmap_[i];
+        Shrink();
+        return;
+      }
+      std::vector<uint16_t> result;
+      if (is_bitmap()) {
+        for (uint16_t low : other.array_)
+          if (Contains(low)) result.emplace_back(low);
+        bitmap_.clear();
+        bitmap_.shrink_to_fit();
+      } else if (other.is_bitmap()) {
+        for (uint16_t low : array_)
+          if (other.Contains(low)) result.emplace_back(low);
+      } else {
+        std::set_intersection(array_.begin(), array_.end(),
+                              other.array_.begin(), other.array_.end(),
+                              std::back_inserter(result));
+      }
+      array_.swap(result);
+      cardinality_ = array_.size();
+    }
+
+    void Or(const Container& other) {
+      if (not is_bitmap() and not other.is_bitmap() and
+          cardinality_ + other.cardinality_ <= kMaxArray) {
+        std::vector<uint16_t> result;
+        std::set_union(array_.begin(), array_.end(), other.array_.begin(),
+                       other.array_.end(), std::back_inserter(result));
+        array_.swap(result);
+        cardinality_ = array_.size();
+        return;
+      }
+      if (not is_bitmap()) ToBitmap();
+      if (other.is_bitmap()) {
+        for (size_t i = 0; i < kWords; i++) bitmap_[i] |= other.bitmap_[i];
+      } else {
+        for (uint16_t low : other.array_)
+          bitmap_[low / 64] |= uint64_t(1) << (low % 64);
+      }
+      Shrink();
+    }
+
+    void AndNot(const Container& other) {
+      if (is_bitmap()) {
+        if (other.is_bitmap()) {
+          for (size_t i = 0; i < kWords; i++) bitmap_[i] &= ~other.bitmap_[i];
+        } else {
+          for (uint16_t low : other.array_)
+            bitmap_[low / 64] &= ~(uint64_t(1) << (low % 64));
+        }
+        Shrink();
+        return;
+      }
+      std::vector<uint16_t> result;
+      for (uint16_t low : array_)
+        if (not other.Contains(low)) result.emplace_back(low);
+      array_.swap(result);
+      cardinality_ = array_.size();
+    }
+
+    // all values in [begin, end)
+    static Container Range(uint32_t begin, uint32_t end) {
+      Container c;
+      if (end - begin > kMaxArray) {
+        c.bitmap_.assign(kWords, 0);
+        for (uint32_t low = begin; low < end; low++)
+          c.bitmap_[low / 64] |= uint64_t(1) << (low % 64);
+      } else {
+        for (uint32_t low = begin; low < end; low++) c.array_.emplace_back(low);
+      }
+      c.cardinality_ = end - begin;
+      return c;
+    }
+
+    template <typename F>
+    void ForEach(uint32_t high, F f) const {
+      if (not is_bitmap()) {
+        for (uint16_t low : array_) f(high | low);
+        return;
+      }
+      for (size_t i = 0; i < kWords; i++) {
+        uint64_t word = bitmap_[i];
+        while (word != 0) {
+          f(high | uint32_t(i * 64 + __builtin_ctzll(word)));
+          word &= word - 1;
+        }
+      }
+    }
+  };
+
+  std::vector<uint16_t> keys_;  // sorted high 16 bits
+  std::vector<Container> containers_;
+
+  static uint16_t High(uint32_t ordinal) { return ordinal >> 16; }
+  static uint16_t Low(uint32_t ordinal) { return ordinal & 0xFFFF; }
+
+  size_t Find(uint16_t key) const {
+    return std::lower_bound(keys_.begin(), keys_.end(), key) - keys_.begin();
+  }
+
+  void RemoveEmpty() {
+    size_t n = 0;
+    for (size_t i = 0; i < keys_.size(); i++) {
+      if (containers_[i].cardinality() == 0) continue;
+      if (n != i) {
+        keys_[n] = keys_[i];
+        containers_[n] = std::move(containers_[i]);
+      }
+      n++;
+    }
+    keys_.resize(n);
+    containers_.resize(n);
+  }
+
+ public:
+  SelectionSet() {}
+
+  // from ordinals in any order
+  SelectionSet(std::vector<uint32_t> ordinals) {
+    std::sort(ordinals.begin(), ordinals.end());
+    for (uint32_t ordinal : ordinals) Add(ordinal);
+  }
+
+  // all ordinals in [0, size)
+  static SelectionSet All(uint32_t size) {
+    SelectionSet s;
+    for (uint32_t begin = 0; begin < size; begin += 0x10000) {
+      uint32_t end = std::min<uint64_t>(size, uint64_t(begin) + 0x10000);
+      s.keys_.emplace_back(High(begin));
+      s.containers_.emplace_back(Container::Range(0, end - begin));
+    }
+    return s;
+  }
+
+  void Add(uint32_t ordinal) {
+    uint16_t key = High(ordinal);
+    if (keys_.empty() or keys_.back() < key) {
+      keys_.emplace_back(key);
+      containers_.emplace_back();
+      containers_.back().Add(Low(ordinal));
+      return;
+    }
+    size_t i = Find(key);
+    if (keys_[i] != key) {
+      keys_.insert(keys_.begin() + i, key);
+      containers_.insert(containers_.begin() + i, Container());
+    }
+    containers_[i].Add(Low(ordinal));
+  }
+
+  void Remove(uint32_t ordinal) {
+    size_t i = Find(High(ordinal));
+    if (i == keys_.size() or keys_[i] != High(ordinal)) return;
+    containers_[i].Remove(Low(ordinal));
+    if (containers_[i].cardinality() == 0) {
+      keys_.erase(keys_.begin() + i);
+      containers_.erase(containers_.begin() + i);
+    }
+  }
+
+  bool Contains(uint32_t ordinal) const {
+    size_t i = Find(High(ordinal));
+    return i < keys_.size() and keys_[i] == High(ordinal) and
+           containers_[i].Contains(Low(ordinal));
+  }
+
+  size_t Count() const {
+    size_t count = 0;
+    for (const auto& c : containers_) count += c.cardinality();
+    return count;
+  }
+
+  bool Empty() const { return keys_.empty(); }
+
+  void Clear() {
+    keys_.clear();
+    containers_.clear();
+  }
+
+  SelectionSet& operator&=(const SelectionSet& other) {
+    size_t j = 0;
+    for (size_t i = 0; i < keys_.size(); i++) {
+      while (j < other.keys_.size() and other.keys_[j] < keys_[i]) j++;
+      if (j < other.keys_.size() and other.keys_[j] == keys_[i])
+        containers_[i].And(other.containers_[j]);
+      else
+        containers_[i] = Container();
+    }
+    RemoveEmpty();
+    return *this;
+  }
+
+  SelectionSet& operator|=(const SelectionSet& other) {
+    for (size_t j = 0; j < other.keys_.size(); j++) {
+      size_t i = Find(other.keys_[j]);
+      if (i < keys_.size() and keys_[i] == other.keys_[j]) {
+        containers_[i].Or(other.containers_[j]);
+      } else {
+        keys_.insert(keys_.begin() + i, other.keys_[j]);
+        containers_.insert(containers_.begin() + i, other.containers_[j]);
+      }
+    }
+    return *this;
+  }
+
+  SelectionSet& operator-=(const SelectionSet& other) {
+    for (size_t i = 0; i < keys_.size(); i++) {
+      size_t j = other.Find(keys_[i]);
+      if (j < other.keys_.size() and other.keys_[j] == keys_[i])
+        containers_[i].AndNot(other.containers_[j]);
+    }
+    RemoveEmpty();
+    return *this;
+  }
+
+  // complement in [0, size)
+  SelectionSet Not(uint32_t size) const {
+    SelectionSet s = All(size);
+    s -= *this;
+    return s;
+  }
+
+  friend SelectionSet operator&(SelectionSet a, const SelectionSet& b) {
+    return a &= b;
+  }
+  friend SelectionSet operator|(SelectionSet a, const SelectionSet& b) {
+    return a |= b;
+  }
+  friend SelectionSet operator-(SelectionSet a, const SelectionSet& b) {
+    return a -= b;
+  }
+
+  bool operator==(const SelectionSet& other) const {
+    if (keys_ != other.keys_) return false;
+    for (size_t i = 0; i < keys_.size(); i++) {
+      if (containers_[i].cardinality() != other.containers_[i].cardinality())
+        return false;
+      bool equal = true;
+      containers_[i].ForEach(0, [&](uint32_t low) {
+        equal = equal and other.containers_[i].Contains(low);
+      });
+      if (not equal) return false;
+    }
+    return true;
+  }
+
+  // call f with every ordinal in ascending order
+  template <typename F>
+  void ForEach(F f) const {
+    for (size_t i = 0; i < keys_.size(); i++)
+      containers_[i].ForEach(uint32_t(keys_[i]) << 16, f);
+  }
+
+  std::vector<uint32_t> ToVector() const {
+    std::vector<uint32_t> ordinals;
+    ordinals.reserve(Count());
+    ForEach([&ordinals](uint32_t ordinal) { ordinals.emplace_back(ordinal); });
+    return ordinals;
+  }
+};
+
+}  // namespace cql2cpp
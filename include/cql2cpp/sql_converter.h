@@ -11,8 +11,13 @@
 #pragma once
 #include <cql2cpp/ast_node.h>
 
+#include <cstdlib>
+#include <limits>
+#include <sstream>
 #include <variant>
 
+#include "geos/geom/GeometryFactory.h"
+#include "geos/io/WKBWriter.h"
 #include "geos/io/WKTWriter.h"
 
 namespace cql2cpp {
@@ -20,13 +25,117 @@ namespace cql2cpp {
 using NodeConv = std::function<std::string(const AstNodePtr,
                                            const std::vector<std::string>&)>;
 
+// a value bound to a placeholder ?N of parameterised SQL, geometries as WKB
+using SqlParameter =
+    std::variant<int64_t, double, std::string, std::vector<unsigned char>>;
+
+// SQLite: ST_ functions as they are, e.g. for SpatiaLite without indexes
+// SpatiaLite: spatial predicates also look up the SpatialIndex of a table
+// PostGIS: spatial predicates also compare bboxes with &&, placeholders $N
+enum class SqlDialect { SQLite, SpatiaLite, PostGIS };
+
 class SqlConverter {
  private:
   std::map<NodeType, std::map<Operator, NodeConv>> converters;
   mutable std::string error_msg_;
   std::map<std::string, std::string> queryable_column_;
+  std::vector<SqlParameter>* parameters_ = nullptr;
+  SqlDialect dialect_ = SqlDialect::SQLite;
+  std::string table_;
+
+  std::string Column(const std::string& property) const {
+    auto it = queryable_column_.find(property);
+    return it == queryable_column_.end() ? property : it->second;
+  }
+
+  static std::string Text(const std::string& text) {
+    std::string quoted = "'";
+    for (char ch : text) quoted += ch == '\'' ? "''" : std::string(1, ch);
+    return quoted + "'";
+  }
+
+  // Spatial predicates other than S_DISJOINT imply intersecting bboxes, so
+  // they can be answered from a spatial index first.
+  std::string Spatial(const AstNodePtr& n, const std::vector<std::string>& c,
+                      const std::string& function) const {
+    std::string exact = function + "(" + c.at(0) + "," + c.at(1) + ")";
+    if (n->op() == S_Disjoint) return exact;
+    if (dialect_ == SqlDialect::PostGIS)
+      return "(" + c.at(0) + " && " + c.at(1) + " AND " + exact + ")";
+    if (dialect_ != SqlDialect::SpatiaLite or table_.empty()) return exact;
+    // the index of a column of the table against a literal
+    for (int i = 0; i < 2; i++) {
+      const AstNodePtr& property = n->children().at(i);
+      if (property->type() != PropertyName or
+          not std::holds_alternative<std::string>(property->origin_value()) or
+          not n->children().at(1 - i)->constant())
+        continue;
+      std::string column =
+          Column(std::get<std::string>(property->origin_value()));
+      return "(" + exact + " AND " + QuoteIdentifier(table_) +
+             ".ROWID IN (SELECT ROWID FROM SpatialIndex WHERE f_table_name = " +
+             Text(table_) + " AND f_geometry_column = " + Text(column) +
+             " AND search_frame = " + c.at(1 - i) + "))";
+    }
+    return exact;
+  }
+
+  static std::vector<unsigned char> Wkb(const geos::geom::Geometry& geometry) {
+    std::stringstream ss;
+    geos::io::WKBWriter().write(geometry, ss);
+    std::string wkb = ss.str();
+    return std::vector<unsigned char>(wkb.begin(), wkb.end());
+  }
+
+  // the placeholder of a literal, false if it can not be bound
+  bool Parameter(const ValueT& value, std::string* sql) const {
+    std::string placeholder = (dialect_ == SqlDialect::PostGIS ? "$" : "?") +
+                              std::to_string(parameters_->size() + 1);
+    if (std::holds_alternative<bool>(value)) {
+      parameters_->emplace_back(int64_t(std::get<bool>(value) ? 1 : 0));
+    } else if (std::holds_alternative<int64_t>(value)) {
+      parameters_->emplace_back(std::get<int64_t>(value));
+    } else if (std::holds_alternative<uint64_t>(value)) {
+      uint64_t u = std::get<uint64_t>(value);
+      if (u <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+        parameters_->emplace_back(static_cast<int64_t>(u));
+      else
+        parameters_->emplace_back(static_cast<double>(u));
+    } else if (std::holds_alternative<double>(value)) {
+      parameters_->emplace_back(std::get<double>(value));
+    } else if (IsString(value)) {
+      std::string_view text;
+      GetString(value, &text);
+      parameters_->emplace_back(std::string(text));
+    } else if (std::holds_alternative<const geos::geom::Geometry*>(value)) {
+      parameters_->emplace_back(
+          Wkb(*std::get<const geos::geom::Geometry*>(value)));
+      placeholder = "ST_GeomFromWKB(" + placeholder + ")";
+    } else if (std::holds_alternative<const geos::geom::Envelope*>(value)) {
+      auto polygon = geos::geom::GeometryFactory::create()->toGeometry(
+          std::get<const geos::geom::Envelope*>(value));
+      parameters_->emplace_back(Wkb(*polygon));
+      placeholder = "ST_GeomFromWKB(" + placeholder + ")";
+    } else {
+      return false;
+    }
+    *sql = placeholder;
+    return true;
+  }
 
  public:
+  // the shortest of 15 or 17 digits which reads back as the same double
+  static std::string Number(double d) {
+    std::stringstream ss;
+    ss.precision(15);
+    ss << d;
+    if (std::strtod(ss.str().c_str(), nullptr) == d) return ss.str();
+    ss.str("");
+    ss.precision(17);
+    ss << d;
+    return ss.str();
+  }
+
   SqlConverter() : SqlConverter(std::map<std::string, std::string>()) {}
   SqlConverter(const std::map<std::string, std::string>& queryable_column)
       : queryable_column_(queryable_column) {
@@ -34,10 +143,10 @@ class SqlConverter {
       return c.at(0) + " AND " + c.at(1);
     };
     converters[BoolExpr][Or] = [](auto n, auto c) -> std::string {
-      return c.at(0) + " OR " + c.at(1);
+      return "(" + c.at(0) + " OR " + c.at(1) + ")";
     };
     converters[BoolExpr][Not] = [](auto n, auto c) -> std::string {
-      return "NOT " + c.at(0);
+      return "NOT (" + c.at(0) + ")";
     };
     converters[BinCompPred][Greater] = [](auto n, auto c) -> std::string {
       return c.at(0) + " > " + c.at(1);
@@ -84,7 +193,10 @@ class SqlConverter {
       }
       return ss.str();
     };
-    converters[Literal][NullOp] = [](auto n, auto c) -> std::string {
+    converters[Literal][NullOp] = [this](auto n, auto c) -> std::string {
+      std::string placeholder;
+      if (parameters_ != nullptr and Parameter(n->origin_value(), &placeholder))
+        return placeholder;
       if (std::holds_alternative<bool>(n->origin_value()))
         return std::get<bool>(n->origin_value()) ? "TRUE" : "FALSE";
       else if (std::holds_alternative<int64_t>(n->origin_value()))
@@ -92,9 +204,9 @@ class SqlConverter {
       else if (std::holds_alternative<uint64_t>(n->origin_value()))
         return std::to_string(std::get<uint64_t>(n->origin_value()));
       else if (std::holds_alternative<double>(n->origin_value()))
-        return std::to_string(std::get<double>(n->origin_value()));
+        return Number(std::get<double>(n->origin_value()));
       else if (std::holds_alternative<std::string>(n->origin_value()))
-        return "'" + std::get<std::string>(n->origin_value()) + "'";
+        return Text(std::get<std::string>(n->origin_value()));
       else if (std::holds_alternative<const geos::geom::Geometry*>(
                    n->origin_value())) {
         geos::io::WKTWriter writer;
@@ -109,14 +221,19 @@ class SqlConverter {
         double miny = env->getMinY();
         double maxx = env->getMaxX();
         double maxy = env->getMaxY();
+        if (dialect_ == SqlDialect::PostGIS)
+          return "ST_MakeEnvelope(" + Number(minx) + "," + Number(miny) + "," +
+                 Number(maxx) + "," + Number(maxy) + ")";
 
+        std::string x1 = Number(minx), y1 = Number(miny);
+        std::string x2 = Number(maxx), y2 = Number(maxy);
         std::stringstream ss;
-        ss << "ST_GeomFromText('POLYGON(";
-        ss << minx << " " << miny << ",";
-        ss << maxx << " " << miny << ",";
-        ss << maxx << " " << maxy << ",";
-        ss << minx << " " << maxy << ",";
-        ss << minx << " " << miny << ")";
+        ss << "ST_GeomFromText('POLYGON((";
+        ss << x1 << " " << y1 << ",";
+        ss << x2 << " " << y1 << ",";
+        ss << x2 << " " << y2 << ",";
+        ss << x1 << " " << y2 << ",";
+        ss << x1 << " " << y1 << "))";
         ss << "')";
 
         return ss.str();
@@ -128,63 +245,41 @@ class SqlConverter {
     };
 
     converters[PropertyName][NullOp] = [this](auto n, auto c) -> std::string {
-      // TODO: this is database related. We should add an option for dialects
-      // sqlite: "" / []
-      // Oracle: ""
-      // PostgreSQL: ""
-      // MySQL: ``
-      // SQL Server: []
-
-      std::string property_name = std::get<std::string>(n->origin_value());
-      std::string column_name = property_name;
-      if (queryable_column_.find(property_name) != queryable_column_.end())
-        column_name = queryable_column_[property_name];
-      return "\"" + column_name + "\"";
-    };
-    converters[SpatialPred][S_Contains] = [](auto n, auto c) -> std::string {
-      return "ST_Contains(" + c.at(0) + "," + c.at(1) + ")";
-    };
-    converters[SpatialPred][S_Crosses] = [](auto n, auto c) -> std::string {
-      return "ST_Crosses(" + c.at(0) + "," + c.at(1) + ")";
-    };
-    converters[SpatialPred][S_Disjoint] = [](auto n, auto c) -> std::string {
-      return "ST_Disjoint(" + c.at(0) + "," + c.at(1) + ")";
-    };
-    converters[SpatialPred][S_Equals] = [](auto n, auto c) -> std::string {
-      return "ST_Equals(" + c.at(0) + "," + c.at(1) + ")";
-    };
-    converters[SpatialPred][S_Intersects] = [](auto n, auto c) -> std::string {
-      return "ST_Intersects(" + c.at(0) + "," + c.at(1) + ")";
-    };
-    converters[SpatialPred][S_Overlaps] = [](auto n, auto c) -> std::string {
-      return "ST_Overlaps(" + c.at(0) + "," + c.at(1) + ")";
-    };
-    converters[SpatialPred][S_Touches] = [](auto n, auto c) -> std::string {
-      return "ST_Touches(" + c.at(0) + "," + c.at(1) + ")";
-    };
-    converters[SpatialPred][S_Within] = [](auto n, auto c) -> std::string {
-      return "ST_Within(" + c.at(0) + "," + c.at(1) + ")";
-    };
+      return QuoteIdentifier(Column(std::get<std::string>(n->origin_value())));
+    };
+    for (auto [op, function] : std::map<Operator, std::string>{
+             {S_Contains, "ST_Contains"},
+             {S_Crosses, "ST_Crosses"},
+             {S_Disjoint, "ST_Disjoint"},
+             {S_Equals, "ST_Equals"},
+             {S_Intersects, "ST_Intersects"},
+             {S_Overlaps, "ST_Overlaps"},
+             {S_Touches, "ST_Touches"},
+             {S_Within, "ST_Within"}})
+      converters[SpatialPred][op] = [this, function = function](
+                                        auto n, auto c) -> std::string {
+        return Spatial(n, c, function);
+      };
     converters[ArithExpr][PLUS] = [](auto n, auto c) -> std::string {
-      return c.at(0) + " + " + c.at(1);
+      return "(" + c.at(0) + " + " + c.at(1) + ")";
     };
     converters[ArithExpr][MINUS] = [](auto n, auto c) -> std::string {
       if (c.size() == 1)
         return "- " + c.at(0);
       else
-        return c.at(0) + " - " + c.at(1);
+        return "(" + c.at(0) + " - " + c.at(1) + ")";
     };
     converters[ArithExpr][MULT] = [](auto n, auto c) -> std::string {
-      return c.at(0) + " * " + c.at(1);
+      return "(" + c.at(0) + " * " + c.at(1) + ")";
     };
     converters[ArithExpr][DIV] = [](auto n, auto c) -> std::string {
-      return c.at(0) + " / " + c.at(1);
+      return "(" + c.at(0) + " / " + c.at(1) + ")";
     };
     converters[ArithExpr][DIVINT] = [](auto n, auto c) -> std::string {
-      return c.at(0) + " / " + c.at(1);
+      return "(" + c.at(0) + " / " + c.at(1) + ")";
     };
     converters[ArithExpr][MOD] = [](auto n, auto c) -> std::string {
-      return c.at(0) + " % " + c.at(1);
+      return "(" + c.at(0) + " % " + c.at(1) + ")";
     };
     converters[ArithExpr][POWER] = [](auto n, auto c) -> std::string {
       return "POWER(" + c.at(0) + "," + c.at(1) + ")";
@@ -193,7 +288,7 @@ class SqlConverter {
       return c.at(0) + " LIKE " + c.at(1);
     };
     converters[IsLikePred][NotLike] = [](auto n, auto c) -> std::string {
-      return c.at(0) + " LIKE " + c.at(1);
+      return c.at(0) + " NOT LIKE " + c.at(1);
     };
     converters[IsNullPred][IsNull] = [](auto n, auto c) -> std::string {
       return c.at(0) + " IS NULL";
@@ -291,6 +386,30 @@ class SqlConverter {
     converters.insert(evaluators.begin(), evaluators.end());
   }
 
+  // Quote a table or column name. All dialects here use double quotes,
+  // doubling those in the name.
+  static std::string QuoteIdentifier(const std::string& identifier) {
+    std::string quoted = "\"";
+    for (char ch : identifier)
+      quoted += ch == '"' ? "\"\"" : std::string(1, ch);
+    return quoted + "\"";
+  }
+
+  // The SpatiaLite dialect needs the table the query runs on to look up its
+  // spatial index.
+  void set_dialect(SqlDialect dialect, const std::string& table = "") {
+    dialect_ = dialect;
+    table_ = table;
+  }
+
+  // Emit literals as placeholders ?N ($N for PostGIS) and append their
+  // values to parameters, so queries differing only in literals convert to
+  // the same SQL. Convert numbers the placeholders after those already in
+  // parameters.
+  void set_parameters(std::vector<SqlParameter>* parameters) {
+    parameters_ = parameters;
+  }
+
   bool Convert(const AstNodePtr& root, std::string* sql_where) {
     if (converters.find(root->type()) == converters.end() ||
         converters.at(root->type()).find(root->op()) ==
@@ -304,7 +423,10 @@ class SqlConverter {
     std::vector<std::string> children_sql;
     for (AstNodePtr child : root->children()) {
       std::string sub_sql;
-      if (Convert(child, &sub_sql))
+      // the name of a function is not a value
+      if (root->type() == Function and child == root->children().front())
+        children_sql.emplace_back(value_str(child->origin_value()));
+      else if (Convert(child, &sub_sql))
         children_sql.emplace_back(sub_sql);
       else
         return false;
@@ -317,6 +439,8 @@ class SqlConverter {
 
     return true;
   }
+
+  const std::string& error_msg() const { return error_msg_; }
 };
 
 }  // namespace cql2cpp
@@ -0,0 +1,118 @@
+/*
+ * File Name: sql_statement_cache.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/01
+ *
+ */
+
+#pragma once
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "sql_converter.h"
+
+namespace cql2cpp {
+
+// Prepared statements of a SQLite connection by their SQL, at most capacity
+// of them, the least recently used finalized first. With parameterised SQL
+// queries differing only in their literals share one statement.
+class SqlStatementCache {
+ private:
+  sqlite3* db_;
+  size_t capacity_;
+  std::list<std::pair<std::string, sqlite3_stmt*>> statements_;  // MRU first
+  std::unordered_map<std::string, decltype(statements_)::iterator> index_;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+
+ public:
+  SqlStatementCache(sqlite3* db, size_t capacity = 16)
+      : db_(db), capacity_(std::max<size_t>(capacity, 1)) {}
+
+  SqlStatementCache(const SqlStatementCache&) = delete;
+  SqlStatementCache& operator=(const SqlStatementCache&) = delete;
+
+  ~SqlStatementCache() {
+    for (auto& [sql, stmt] : statements_) sqlite3_finalize(stmt);
+  }
+
+  static bool Bind(sqlite3_stmt* stmt,
+                   const std::vector<SqlParameter>& parameters,
+                   std::string* error_msg) {
+    for (size_t i = 0; i < parameters.size(); i++) {
+      int index = static_cast<int>(i + 1);
+      const SqlParameter& p = parameters.at(i);
+      int rc;
+      if (std::holds_alternative<int64_t>(p)) {
+        rc = sqlite3_bind_int64(stmt, index, std::get<int64_t>(p));
+      } else if (std::holds_alternative<double>(p)) {
+        rc = sqlite3_bind_double(stmt, index, std::get<double>(p));
+      } else if (std::holds_alternative<std::string>(p)) {
+        const std::string& text = std::get<std::string>(p);
+        rc = sqlite3_bind_text(stmt, index, text.data(), text.size(),
+                               SQLITE_TRANSIENT);
+      } else {
+        const auto& blob = std::get<std::vector<unsigned char>>(p);
+        rc = sqlite3_bind_blob(stmt, index, blob.data(), blob.size(),
+                               SQLITE_TRANSIENT);
+      }
+      if (rc != SQLITE_OK) {
+        *error_msg = "can not bind parameter " + std::to_string(index) + ": " +
+                     sqlite3_errstr(rc);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // A statement reset and bound to parameters, nullptr on error. It is
+  // valid until capacity other statements are prepared; reset it when done.
+  sqlite3_stmt* Prepare(const std::string& sql,
+                        const std::vector<SqlParameter>& parameters,
+                        std::string* error_msg) {
+    sqlite3_stmt* stmt;
+    auto it = index_.find(sql);
+    if (it != index_.end()) {
+      hits_++;
+      statements_.splice(statements_.begin(), statements_, it->second);
+      stmt = it->second->second;
+      sqlite3_reset(stmt);
+      sqlite3_clear_bindings(stmt);
+    } else {
+      misses_++;
+      if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) !=
+          SQLITE_OK) {
+        *error_msg = std::string(sqlite3_errmsg(db_)) + ": " + sql;
+        return nullptr;
+      }
+      statements_.emplace_front(sql, stmt);
+      index_.emplace(sql, statements_.begin());
+      if (statements_.size() > capacity_) {
+        sqlite3_finalize(statements_.back().second);
+        index_.erase(statements_.back().first);
+        statements_.pop_back();
+      }
+    }
+    return Bind(stmt, parameters, error_msg) ? stmt : nullptr;
+  }
+
+  size_t size() const { return statements_.size(); }
+
+  // lookups answered by a statement prepared before
+  size_t hits() const { return hits_; }
+
+  // lookups which prepared a statement
+  size_t misses() const { return misses_; }
+};
+
+}  // namespace cql2cpp
@@ -0,0 +1,111 @@
+/*
+ * File Name: standing_query.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/26
+ *
+ */
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "ast_node.h"
+#include "selection_set.h"
+
+namespace cql2cpp {
+
+// A query registered once whose result is kept up to date as features change
+struct StandingQuery {
+  AstNodePtr root;
+  std::set<std::string> property_paths;
+  SelectionSet result;
+};
+
+// A feature entering or leaving the result of a standing query
+struct Transition {
+  uint32_t query;
+  uint32_t ordinal;
+  bool entered;
+};
+
+// Standing queries and the property paths they read, so that a change of
+// some properties of a feature only re-evaluates the queries reading them.
+class StandingQueries {
+ private:
+  std::map<uint32_t, StandingQuery> queries_;
+  std::map<std::string, std::set<uint32_t>> readers_;
+  uint32_t next_id_ = 0;
+
+  static bool IsPrefix(const std::string& prefix, const std::string& path) {
+    return path.size() > prefix.size() and
+           path.compare(0, prefix.size(), prefix) == 0 and
+           path.at(prefix.size()) == '.';
+  }
+
+ public:
+  // a change of a path changes the path itself, its parents and children
+  static bool Overlap(const std::string& a, const std::string& b) {
+    return a == b or IsPrefix(a, b) or IsPrefix(b, a);
+  }
+
+  uint32_t Add(StandingQuery query) {
+    uint32_t id = next_id_++;
+    for (const auto& path : query.property_paths) readers_[path].insert(id);
+    queries_.emplace(id, std::move(query));
+    return id;
+  }
+
+  bool Remove(uint32_t id) {
+    auto it = queries_.find(id);
+    if (it == queries_.end()) return false;
+    for (const auto& path : it->second.property_paths) {
+      readers_.at(path).erase(id);
+      if (readers_.at(path).empty()) readers_.erase(path);
+    }
+    queries_.erase(it);
+    return true;
+  }
+
+  StandingQuery* Get(uint32_t id) {
+    auto it = queries_.find(id);
+    return it == queries_.end() ? nullptr : &it->second;
+  }
+
+  const StandingQuery* Get(uint32_t id) const {
+    auto it = queries_.find(id);
+    return it == queries_.end() ? nullptr : &it->second;
+  }
+
+  std::map<uint32_t, StandingQuery>& queries() { return queries_; }
+
+  // ids of the queries reading a path overlapping any of the changed ones
+  std::set<uint32_t> Readers(const std::vector<std::string>& changed) const {
+    std::set<uint32_t> ids;
+    auto collect = [&](const std::set<uint32_t>& readers) {
+      ids.insert(readers.begin(), readers.end());
+    };
+    for (const auto& path : changed) {
+      // the path itself and its children
+      for (auto it = readers_.lower_bound(path); it != readers_.end(); ++it) {
+        if (it->first.compare(0, path.size(), path) != 0) break;
+        if (Overlap(path, it->first)) collect(it->second);
+      }
+
+      // its parents
+      for (size_t dot = path.find('.'); dot != std::string::npos;
+           dot = path.find('.', dot + 1)) {
+        auto it = readers_.find(path.substr(0, dot));
+        if (it != readers_.end()) collect(it->second);
+      }
+    }
+    return ids;
+  }
+};
+
+}  // namespace cql2cpp
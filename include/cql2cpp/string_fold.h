@@ -0,0 +1,151 @@
+/*
+ * File Name: string_fold.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/06
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "operator.h"
+
+namespace cql2cpp {
+
+// Folding of UTF-8 strings for CASEI and ACCENTI. Case is folded for Latin,
+// Greek and Cyrillic letters, accents are removed from Latin letters and
+// combining diacritical marks. Other characters and invalid bytes are kept.
+class StringFold {
+ private:
+  static constexpr uint32_t kInvalid = 0xffffffff;
+
+  // the code point at i, advancing i past it, or kInvalid past the byte at
+  // i if it does not start a valid sequence
+  static uint32_t Decode(std::string_view s, size_t* i) {
+    unsigned char c = s.at(*i);
+    size_t length = c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xe ? 3
+                                 : (c >> 3) == 0x1e ? 4 : 0;
+    (*i)++;
+    if (length == 0 or *i + length - 1 > s.size()) return kInvalid;
+    uint32_t cp = length == 1 ? c : c & (0x7f >> length);
+    for (size_t k = 1; k < length; k++) {
+      unsigned char next = s.at(*i + k - 1);
+      if ((next >> 6) != 0x2) return kInvalid;
+      cp = (cp << 6) | (next & 0x3f);
+    }
+    *i += length - 1;
+    return cp;
+  }
+
+  static void Encode(uint32_t cp, std::string* out) {
+    if (cp < 0x80) {
+      out->push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+      out->push_back(static_cast<char>(0xc0 | (cp >> 6)));
+      out->push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    } else if (cp < 0x10000) {
+      out->push_back(static_cast<char>(0xe0 | (cp >> 12)));
+      out->push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+      out->push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    } else {
+      out->push_back(static_cast<char>(0xf0 | (cp >> 18)));
+      out->push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+      out->push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+      out->push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    }
+  }
+
+  static bool Ascii(std::string_view s) {
+    for (char c : s)
+      if (static_cast<unsigned char>(c) >= 0x80) return false;
+    return true;
+  }
+
+  static uint32_t Lower(uint32_t cp) {
+    if (cp < 0x80) return cp >= 'A' and cp <= 'Z' ? cp + 0x20 : cp;
+    if (cp >= 0xc0 and cp <= 0xde and cp != 0xd7) return cp + 0x20;
+    if (cp == 0x130) return 'i';
+    if (cp == 0x178) return 0xff;
+    if ((cp >= 0x100 and cp <= 0x137) or (cp >= 0x14a and cp <= 0x177))
+      return cp | 1;
+    if ((cp >= 0x139 and cp <= 0x148) or (cp >= 0x179 and cp <= 0x17e))
+      return cp % 2 == 1 ? cp + 1 : cp;
+    if (cp >= 0x391 and cp <= 0x3ab and cp != 0x3a2) return cp + 0x20;
+    if (cp >= 0x410 and cp <= 0x42f) return cp + 0x20;
+    if (cp >= 0x400 and cp <= 0x40f) return cp + 0x50;
+    return cp;
+  }
+
+  // the base letter of an accented Latin one, 0 if it has none
+  static char Base(uint32_t cp) {
+    // U+00C0 to U+017F
+    static const char* bases =
+        "AAAAAA.CEEEEIIII.NOOOOO.OUUUUY.."
+        "aaaaaa.ceeeeiiii.nooooo.ouuuuy.y"
+        "AaAaAaCcCcCcCcDdDdEeEeEeEeEeGgGg"
+        "GgGgHhHhIiIiIiIiIi..JjKk.LlLlLlL"
+        "lLlNnNnNn...OoOoOo..RrRrRrSsSsSs"
+        "SsTtTtTtUuUuUuUuUuUuWwYyYZzZzZz.";
+    if (cp < 0xc0 or cp > 0x17f) return 0;
+    char base = bases[cp - 0xc0];
+    return base == '.' ? 0 : base;
+  }
+
+ public:
+  // what a fold removes, CASEI and ACCENTI of one string may be combined
+  enum Folding { CaseFolding = 1, AccentFolding = 2 };
+
+  static int FoldingOf(Operator op) {
+    return op == CaseI ? CaseFolding : op == AccentI ? AccentFolding : 0;
+  }
+
+  static std::string Fold(std::string_view s, int folding) {
+    if ((folding & AccentFolding) == 0)
+      return (folding & CaseFolding) != 0 ? FoldCase(s) : std::string(s);
+    std::string folded = FoldAccents(s);
+    return (folding & CaseFolding) != 0 ? FoldCase(folded) : folded;
+  }
+
+  static std::string FoldCase(std::string_view s) {
+    std::string folded;
+    folded.reserve(s.size());
+    if (Ascii(s)) {
+      for (char c : s) folded.push_back(c >= 'A' and c <= 'Z' ? c + 0x20 : c);
+      return folded;
+    }
+    for (size_t i = 0; i < s.size();) {
+      uint32_t cp = Decode(s, &i);
+      if (cp == kInvalid)
+        folded.push_back(s.at(i - 1));
+      else
+        Encode(Lower(cp), &folded);
+    }
+    return folded;
+  }
+
+  static std::string FoldAccents(std::string_view s) {
+    if (Ascii(s)) return std::string(s);
+    std::string folded;
+    folded.reserve(s.size());
+    for (size_t i = 0; i < s.size();) {
+      uint32_t cp = Decode(s, &i);
+      if (cp >= 0x300 and cp <= 0x36f) continue;  // combining marks
+      char base = Base(cp);
+      if (cp == kInvalid)
+        folded.push_back(s.at(i - 1));
+      else if (base != 0)
+        folded.push_back(base);
+      else
+        Encode(cp, &folded);
+    }
+    return folded;
+  }
+};
+
+}  // namespace cql2cpp
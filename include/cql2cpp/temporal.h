@@ -0,0 +1,154 @@
+/*
+ * File Name: temporal.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/08
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "operator.h"
+#include "value.h"
+
+namespace cql2cpp {
+
+// Temporal instances of values, and the relations of the temporal
+// predicates between them as comparisons of their ends.
+// https://docs.ogc.org/is/21-065r2/21-065r2.html#temporal-functions
+class Temporal {
+ public:
+  static const std::vector<Operator>& Predicates() {
+    static const std::vector<Operator> predicates = {
+        T_After,  T_Before,       T_Contains, T_Disjoint,  T_During,
+        T_Equals, T_FinishedBy,   T_Finishes, T_Intersects, T_Meets,
+        T_MetBy,  T_OverlappedBy, T_Overlaps, T_StartedBy,  T_Starts};
+    return predicates;
+  }
+
+  static bool Relate(Operator op, const TimeValue& a, const TimeValue& b) {
+    switch (op) {
+      case T_After:
+        return a.begin > b.end;
+      case T_Before:
+        return a.end < b.begin;
+      case T_Contains:
+        return a.begin < b.begin and a.end > b.end;
+      case T_Disjoint:
+        return a.end < b.begin or a.begin > b.end;
+      case T_During:
+        return a.begin > b.begin and a.end < b.end;
+      case T_Equals:
+        return a.begin == b.begin and a.end == b.end;
+      case T_FinishedBy:
+        return a.begin < b.begin and a.end == b.end;
+      case T_Finishes:
+        return a.begin > b.begin and a.end == b.end;
+      case T_Intersects:
+        return a.begin <= b.end and a.end >= b.begin;
+      case T_Meets:
+        return a.end == b.begin;
+      case T_MetBy:
+        return a.begin == b.end;
+      case T_OverlappedBy:
+        return a.begin > b.begin and a.begin < b.end and a.end > b.end;
+      case T_Overlaps:
+        return a.begin < b.begin and a.end > b.begin and a.end < b.end;
+      case T_StartedBy:
+        return a.begin == b.begin and a.end > b.end;
+      case T_Starts:
+        return a.begin == b.begin and a.end < b.end;
+      default:
+        return false;
+    }
+  }
+
+  // the time of a value: itself, or a date or timestamp string. Null of
+  // null.
+  static bool ToTime(const ValueT& v, ValueT* time, std::string* errmsg) {
+    if (std::holds_alternative<TimeValue>(v) or
+        std::holds_alternative<NullStruct>(v)) {
+      *time = v;
+      return true;
+    }
+    std::string_view s;
+    if (not GetString(v, &s)) {
+      *errmsg = "time needs a date or a timestamp but we have " +
+                value_str(v, true);
+      return false;
+    }
+    TimeValue parsed;
+    if (not TimeParser::ParseInstant(s, &parsed)) {
+      *errmsg = "can not parse time '" + std::string(s) + "'";
+      return false;
+    }
+    *time = parsed;
+    return true;
+  }
+
+  // DATE or TIMESTAMP of one value, INTERVAL of two
+  static bool Instance(Operator op, const std::vector<ValueT>& vs,
+                       ValueT* value, std::string* errmsg) {
+    if (op == Interval) {
+      if (vs.size() != 2) {
+        *errmsg = "INTERVAL needs two values but we have " +
+                  std::to_string(vs.size());
+        return false;
+      }
+      return MakeInterval(vs.at(0), vs.at(1), value, errmsg);
+    }
+
+    std::string name = op == Date ? "DATE" : "TIMESTAMP";
+    if (vs.size() != 1) {
+      *errmsg = name + " needs one value but we have " +
+                std::to_string(vs.size());
+      return false;
+    }
+    std::string_view s;
+    if (not GetString(vs.at(0), &s)) return ToTime(vs.at(0), value, errmsg);
+    TimeValue parsed;
+    if (not(op == Date ? TimeParser::ParseDate(s, &parsed)
+                       : TimeParser::ParseTimestamp(s, &parsed))) {
+      *errmsg = "can not parse " + name + " '" + std::string(s) + "'";
+      return false;
+    }
+    *value = parsed;
+    return true;
+  }
+
+ private:
+  // from the beginning of begin to the end of end, '..' being unbounded
+  static bool MakeInterval(const ValueT& begin, const ValueT& end,
+                           ValueT* value, std::string* errmsg) {
+    static const TimeValue unbounded = {TimeValue::kUnboundedBegin,
+                                        TimeValue::kUnboundedEnd};
+    ValueT ends[2];
+    for (int i = 0; i < 2; i++) {
+      const ValueT& v = i == 0 ? begin : end;
+      std::string_view s;
+      if (GetString(v, &s) and s == "..")
+        ends[i] = unbounded;
+      else if (not ToTime(v, &ends[i], errmsg))
+        return false;
+      if (std::holds_alternative<NullStruct>(ends[i])) {
+        *value = NullValue;
+        return true;
+      }
+    }
+    TimeValue interval = {std::get<TimeValue>(ends[0]).begin,
+                          std::get<TimeValue>(ends[1]).end};
+    if (interval.begin > interval.end) {
+      *errmsg = "INTERVAL ends before it begins";
+      return false;
+    }
+    *value = interval;
+    return true;
+  }
+};
+
+}  // namespace cql2cpp
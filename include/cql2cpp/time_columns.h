@@ -0,0 +1,83 @@
+/*
+ * File Name: time_columns.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/08
+ *
+ */
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "feature_source.h"
+#include "temporal.h"
+
+namespace cql2cpp {
+
+// Date and timestamp properties parsed into times, one per feature ordinal,
+// when features are loaded so that temporal predicates on these properties
+// compare integers instead of parsing strings per evaluation. Values which
+// are not times are kept as none and parsed, or reported, by the
+// evaluator.
+class TimeColumns {
+ private:
+  struct Column {
+    std::string property_path;
+    std::vector<std::optional<TimeValue>> values;
+  };
+
+  std::vector<Column> columns_;
+
+ public:
+  void Register(const std::string& property_path) {
+    columns_.push_back({property_path, {}});
+  }
+
+  bool empty() const { return columns_.empty(); }
+
+  void Clear() {
+    for (auto& column : columns_) column.values.clear();
+  }
+
+  // parse the properties of the feature at ordinal
+  void Set(uint32_t ordinal, const FeatureSource& fs) {
+    for (auto& column : columns_) {
+      if (column.values.size() <= ordinal)
+        column.values.resize(ordinal + 1);
+      ValueT time;
+      std::string errmsg;
+      if (Temporal::ToTime(fs.get_property(column.property_path), &time,
+                           &errmsg) and
+          std::holds_alternative<TimeValue>(time))
+        column.values.at(ordinal) = std::get<TimeValue>(time);
+      else
+        column.values.at(ordinal).reset();
+    }
+  }
+
+  void Erase(uint32_t ordinal) {
+    for (auto& column : columns_)
+      if (ordinal < column.values.size()) column.values.at(ordinal).reset();
+  }
+
+  // false if the property is not a time parsed so
+  bool Get(uint32_t ordinal, const std::string& property_path,
+           TimeValue* time) const {
+    for (const auto& column : columns_) {
+      if (column.property_path != property_path) continue;
+      if (ordinal >= column.values.size() or
+          not column.values.at(ordinal).has_value())
+        return false;
+      *time = *column.values.at(ordinal);
+      return true;
+    }
+    return false;
+  }
+};
+
+}  // namespace cql2cpp
@@ -0,0 +1,215 @@
+/*
+ * File Name: time_value.h
+ *
+ * Copyright (c) 2024-2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/06/08
+ *
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <string_view>
+
+namespace cql2cpp {
+
+// An instant or an interval of time in nanoseconds since the Unix epoch,
+// UTC. Both ends are included, an instant has begin == end and unbounded
+// ends are the limits of int64_t.
+struct TimeValue {
+  static constexpr int64_t kUnboundedBegin =
+      std::numeric_limits<int64_t>::min();
+  static constexpr int64_t kUnboundedEnd = std::numeric_limits<int64_t>::max();
+
+  int64_t begin;
+  int64_t end;
+
+  bool instant() const { return begin == end; }
+
+  bool operator==(const TimeValue& other) const {
+    return begin == other.begin and end == other.end;
+  }
+  bool operator<(const TimeValue& other) const {
+    return begin < other.begin or (begin == other.begin and end < other.end);
+  }
+};
+
+// Parse and format dates and RFC 3339 timestamps. Years 1678 to 2261 are
+// supported, the range of int64_t nanoseconds.
+class TimeParser {
+ public:
+  static constexpr int64_t kSecond = 1000000000;
+  static constexpr int64_t kDay = 86400 * kSecond;
+
+ private:
+  // digits of s from i, advancing i past them
+  static bool Digits(std::string_view s, size_t* i, size_t count,
+                     int64_t* number) {
+    if (*i + count > s.size()) return false;
+    *number = 0;
+    for (size_t k = 0; k < count; k++) {
+      char c = s.at(*i + k);
+      if (c < '0' or c > '9') return false;
+      *number = *number * 10 + (c - '0');
+    }
+    *i += count;
+    return true;
+  }
+
+  static bool Expect(std::string_view s, size_t* i, char c) {
+    if (*i >= s.size() or s.at(*i) != c) return false;
+    (*i)++;
+    return true;
+  }
+
+  static bool Leap(int64_t year) {
+    return year % 4 == 0 and (year % 100 != 0 or year % 400 == 0);
+  }
+
+  // YYYY-MM-DD from i as days since the epoch
+  static bool Day(std::string_view s, size_t* i, int64_t* days) {
+    static const int kMonthDays[] = {31, 28, 31, 30, 31, 30,
+                                     31, 31, 30, 31, 30, 31};
+    int64_t year, month, day;
+    if (not Digits(s, i, 4, &year) or not Expect(s, i, '-') or
+        not Digits(s, i, 2, &month) or not Expect(s, i, '-') or
+        not Digits(s, i, 2, &day))
+      return false;
+    if (year < 1678 or year > 2261 or month < 1 or month > 12 or day < 1 or
+        day > kMonthDays[month - 1] + (month == 2 and Leap(year)))
+      return false;
+    *days = DaysFromCivil(year, month, day);
+    return true;
+  }
+
+ public:
+  // days since 1970-01-01 of a date of the proleptic Gregorian calendar
+  static int64_t DaysFromCivil(int64_t year, int64_t month, int64_t day) {
+    year -= month <= 2;
+    int64_t era = (year >= 0 ? year : year - 399) / 400;
+    int64_t year_of_era = year - era * 400;
+    int64_t day_of_year =
+        (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int64_t day_of_era =
+        year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+  }
+
+  static void CivilFromDays(int64_t days, int64_t* year, int64_t* month,
+                            int64_t* day) {
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t day_of_era = days - era * 146097;
+    int64_t year_of_era = (day_of_era - day_of_era / 1460 +
+                           day_of_era / 36524 - day_of_era / 146096) /
+                          365;
+    int64_t day_of_year =
+        day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    int64_t mp = (5 * day_of_year + 2) / 153;
+    *day = day_of_year - (153 * mp + 2) / 5 + 1;
+    *month = mp < 10 ? mp + 3 : mp - 9;
+    *year = year_of_era + era * 400 + (*month <= 2);
+  }
+
+  // YYYY-MM-DD, the whole day
+  static bool ParseDate(std::string_view s, TimeValue* time) {
+    size_t i = 0;
+    int64_t days;
+    if (not Day(s, &i, &days) or i != s.size()) return false;
+    *time = {days * kDay, days * kDay + kDay - 1};
+    return true;
+  }
+
+  // YYYY-MM-DDTHH:MM:SS[.fraction](Z|+HH:MM|-HH:MM), digits of the fraction
+  // past nanoseconds are dropped
+  static bool ParseTimestamp(std::string_view s, TimeValue* time) {
+    size_t i = 0;
+    int64_t days, hour, minute, second, fraction = 0;
+    if (not Day(s, &i, &days)) return false;
+    if (i >= s.size() or (s.at(i) != 'T' and s.at(i) != 't')) return false;
+    i++;
+    if (not Digits(s, &i, 2, &hour) or not Expect(s, &i, ':') or
+        not Digits(s, &i, 2, &minute) or not Expect(s, &i, ':') or
+        not Digits(s, &i, 2, &second))
+      return false;
+    if (hour > 23 or minute > 59 or second > 60) return false;
+    if (i < s.size() and s.at(i) == '.') {
+      i++;
+      size_t digits = 0;
+      while (i < s.size() and s.at(i) >= '0' and s.at(i) <= '9') {
+        if (digits++ < 9) fraction = fraction * 10 + (s.at(i) - '0');
+        i++;
+      }
+      if (digits == 0) return false;
+      for (; digits < 9; digits++) fraction *= 10;
+    }
+    int64_t offset = 0;  // minutes east of UTC
+    if (i < s.size() and (s.at(i) == 'Z' or s.at(i) == 'z')) {
+      i++;
+    } else if (i < s.size() and (s.at(i) == '+' or s.at(i) == '-')) {
+      int sign = s.at(i++) == '-' ? -1 : 1;
+      int64_t offset_hour, offset_minute;
+      if (not Digits(s, &i, 2, &offset_hour) or not Expect(s, &i, ':') or
+          not Digits(s, &i, 2, &offset_minute) or offset_hour > 23 or
+          offset_minute > 59)
+        return false;
+      offset = sign * (offset_hour * 60 + offset_minute);
+    } else {
+      return false;
+    }
+    if (i != s.size()) return false;
+    int64_t seconds =
+        days * 86400 + hour * 3600 + (minute - offset) * 60 + second;
+    int64_t ns = seconds * kSecond + fraction;
+    *time = {ns, ns};
+    return true;
+  }
+
+  // a timestamp or a date
+  static bool ParseInstant(std::string_view s, TimeValue* time) {
+    return s.size() == 10 ? ParseDate(s, time) : ParseTimestamp(s, time);
+  }
+
+  // YYYY-MM-DDTHH:MM:SS[.fraction]Z
+  static std::string Format(int64_t ns) {
+    int64_t days = ns / kDay;
+    int64_t rest = ns % kDay;
+    if (rest < 0) {
+      days--;
+      rest += kDay;
+    }
+    int64_t year, month, day;
+    CivilFromDays(days, &year, &month, &day);
+    int64_t seconds = rest / kSecond, fraction = rest % kSecond;
+    char text[40];
+    int length = std::snprintf(
+        text, sizeof(text), "%04d-%02d-%02dT%02d:%02d:%02d",
+        static_cast<int>(year), static_cast<int>(month), static_cast<int>(day),
+        static_cast<int>(seconds / 3600), static_cast<int>(seconds / 60 % 60),
+        static_cast<int>(seconds % 60));
+    std::string formatted(text, length);
+    if (fraction != 0) {
+      std::snprintf(text, sizeof(text), ".%09d", static_cast<int>(fraction));
+      std::string digits(text);
+      digits.erase(digits.find_last_not_of('0') + 1);
+      formatted += digits;
+    }
+    return formatted + "Z";
+  }
+
+  // an instant, or the ends of an interval with .. if unbounded
+  static std::string Format(const TimeValue& time) {
+    if (time.instant()) return Format(time.begin);
+    return (time.begin == TimeValue::kUnboundedBegin ? ".."
+                                                     : Format(time.begin)) +
+           "/" +
+           (time.end == TimeValue::kUnboundedEnd ? ".." : Format(time.end));
+  }
+};
+
+}  // namespace cql2cpp
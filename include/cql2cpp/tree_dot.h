@@ -10,10 +10,15 @@
 
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
 #include <ostream>
+#include <sstream>
 #include <regex>
 
 #include "ast_node.h"
+#include "node_profile.h"
 
 namespace cql2cpp {
 
@@ -26,6 +31,12 @@ class Tree2Dot {
       return TypeName.at(node->type());
   }
 
+  static std::string Fixed(double v) {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(3) << v;
+    return ss.str();
+  }
+
   static bool GenerateDot(std::ostream& ous, const AstNodePtr node) {
     ous << "digraph G {" << std::endl;
     GenerateDotNode(ous, node);
@@ -35,27 +46,51 @@ class Tree2Dot {
     return true;
   }
 
+  // With a profile nodes are labeled with their counters and filled the
+  // redder the more self time they took.
   static bool GenerateDot(std::ostream& ous, const AstNodePtr node,
-                          const std::string& title) {
+                          const std::string& title,
+                          const EvaluationProfile* profile = nullptr) {
     ous << "digraph G {" << std::endl;
     ous << "label=\"" << std::regex_replace(title, std::regex("\""), "\\\"")
         << "\";";
     ous << "labelloc = top;";
-    GenerateDotNode(ous, node);
+    std::chrono::nanoseconds hottest(0);
+    if (profile != nullptr)
+      for (const auto& n : *node)
+        hottest = std::max(hottest, profile->SelfTime(n));
+    GenerateDotNode(ous, node, profile, hottest);
     ous << std::endl;
     GenerateDotEdge(ous, node);
     ous << "}" << std::endl;
     return true;
   }
 
-  static bool GenerateDotNode(std::ostream& ous, const AstNodePtr node) {
+  static bool GenerateDotNode(
+      std::ostream& ous, const AstNodePtr node,
+      const EvaluationProfile* profile = nullptr,
+      std::chrono::nanoseconds hottest = std::chrono::nanoseconds(0)) {
     if (node == nullptr) return true;
 
     ous << "  \"" << node->id() << "\" [label=\"" << node->id() << ". "
         << node_name(node) << "("
-        << value_str(node->origin_value(), node->value()) << ")"
-        << "\"];" << std::endl;
-    for (const auto& child : node->children()) GenerateDotNode(ous, child);
+        << value_str(node->origin_value(), node->value()) << ")";
+    const NodeProfile* p =
+        profile == nullptr ? nullptr : profile->Get(node.get());
+    if (p != nullptr) {
+      std::chrono::nanoseconds self = profile->SelfTime(node);
+      double heat = hottest.count() > 0
+                        ? static_cast<double>(self.count()) / hottest.count()
+                        : 0.0;
+      ous << "\\ncalls " << p->calls << " T " << p->trues << " F "
+          << p->falses << " N " << p->nulls << " E " << p->errors
+          << "\\nself " << self.count() / 1e6 << " ms, total "
+          << p->time.count() / 1e6 << " ms\", style=filled, fillcolor=\"0.000 "
+          << Fixed(heat) << " 1.000";
+    }
+    ous << "\"];" << std::endl;
+    for (const auto& child : node->children())
+      GenerateDotNode(ous, child, profile, hottest);
 
     return true;
   }
@@ -18,8 +18,11 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <variant>
 
+#include "time_value.h"
+
 namespace cql2cpp {
 
 enum NullStruct { NullValue };
@@ -33,6 +36,10 @@ class ArrayElementComp {
  public:
   bool operator()(const Element& a, const Element& b) const;
 
+  bool equivalent(const Element& a, const Element& b) const {
+    return not operator()(a, b) and not operator()(b, a);
+  }
+
  private:
   template <typename T, typename U>
   bool less(const U& lhs, const U& rhs) const {
@@ -48,15 +55,42 @@ using SetType = std::set<Element, ArrayElementComp>;
 
 using ArrayType = std::vector<Element>;
 
+// std::string_view is a string property read in place from the input of its
+// feature, e.g. a mapped file. It is valid as long as the feature source is.
 using ValueT = std::variant<NullStruct, bool, int64_t, uint64_t, double,
-                            std::string, ArrayType, const geos::geom::Geometry*,
-                            const geos::geom::Envelope*>;
+                            std::string, std::string_view, ArrayType,
+                            const geos::geom::Geometry*,
+                            const geos::geom::Envelope*, TimeValue>;
 
 struct Element {
   ValueT value;
   Element(const ValueT& value) : value(value) {}
 };
 
+// true if the value is a string, owned or a view
+inline bool IsString(const ValueT& value) {
+  return std::holds_alternative<std::string>(value) or
+         std::holds_alternative<std::string_view>(value);
+}
+
+// the characters of a string value, owned or a view
+inline bool GetString(const ValueT& value, std::string_view* s) {
+  if (std::holds_alternative<std::string>(value))
+    *s = std::get<std::string>(value);
+  else if (std::holds_alternative<std::string_view>(value))
+    *s = std::get<std::string_view>(value);
+  else
+    return false;
+  return true;
+}
+
+// An array is in set form if it is sorted by ArrayElementComp and has no
+// equivalent elements. Array predicates work on this form with linear merges.
+bool IsSortedSet(const ArrayType& array);
+
+// sort and deduplicate in place, cheap if the array is already in set form
+void NormalizeArray(ArrayType* array);
+
 static std::string value_str(ValueT value, bool with_type = false) {
   if (std::holds_alternative<NullStruct>(value)) return "null";
 
@@ -80,6 +114,10 @@ static std::string value_str(ValueT value, bool with_type = false) {
     return std::get<std::string>(value) +
            std::string(with_type ? " string" : "");
 
+  if (std::holds_alternative<std::string_view>(value))
+    return std::string(std::get<std::string_view>(value)) +
+           std::string(with_type ? " string_view" : "");
+
   if (std::holds_alternative<ArrayType>(value)) {
     std::stringstream ss;
     ss << "[";
@@ -99,6 +137,10 @@ static std::string value_str(ValueT value, bool with_type = false) {
     return std::get<const geos::geom::Envelope*>(value)->toString();
   }
 
+  if (std::holds_alternative<TimeValue>(value))
+    return TimeParser::Format(std::get<TimeValue>(value)) +
+           std::string(with_type ? " time" : "");
+
   return "unknown type";
 }
 
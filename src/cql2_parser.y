@@ -13,6 +13,8 @@ using cql2cpp::BinCompPred;
 using cql2cpp::IsLikePred;
 using cql2cpp::IsBetweenPred;
 using cql2cpp::SpatialPred;
+using cql2cpp::TemporalPred;
+using cql2cpp::TemporalInstance;
 using cql2cpp::PropertyName;
 using cql2cpp::IsInListPred;
 using cql2cpp::InList;
@@ -110,6 +112,12 @@ void cql2cpp::Cql2ParserBase::error(const std::string& msg) {
 %type <AstNodePtr> spatialPredicate
 %type <AstNodePtr> geomExpression
 %type <AstNodePtr> spatialInstance
+%type <AstNodePtr> temporalPredicate
+%type <AstNodePtr> temporalExpression
+%type <AstNodePtr> temporalInstance
+%type <AstNodePtr> instantInstance
+%type <AstNodePtr> intervalInstance
+%type <AstNodePtr> instantParameter
 %type <AstNodePtr> isInListPredicate
 %type <AstNodePtr> inList
 %type <AstNodePtr> arrayPredicate
@@ -171,6 +179,7 @@ booleanLiteral:
 predicate:
   comparisonPredicate
   | spatialPredicate
+  | temporalPredicate
   | arrayPredicate
 
 comparisonPredicate:
@@ -290,6 +299,32 @@ spatialInstance:
     }
   }
 
+temporalPredicate:
+  TIME_FUNC LPT temporalExpression COMMA temporalExpression RPT { PL; $$ = MakeAstNode(TemporalPred, NameOp.at($1), std::vector({$3, $5})); }
+
+temporalExpression:
+  temporalInstance
+  | propertyName
+  | function
+
+temporalInstance:
+  instantInstance
+  | intervalInstance
+
+instantInstance:
+  DATE LPT CHAR_LIT RPT { PL; std::string s = std::string($3); $$ = MakeAstNode(TemporalInstance, cql2cpp::Date, std::vector({MakeAstNode(s.substr(1, s.size() - 2))})); }
+  | TIMESTAMP LPT CHAR_LIT RPT { PL; std::string s = std::string($3); $$ = MakeAstNode(TemporalInstance, cql2cpp::Timestamp, std::vector({MakeAstNode(s.substr(1, s.size() - 2))})); }
+
+intervalInstance:
+  INTERVAL LPT instantParameter COMMA instantParameter RPT { PL; $$ = MakeAstNode(TemporalInstance, cql2cpp::Interval, std::vector({$3, $5})); }
+
+// a date, a timestamp or '..' for an unbounded end
+instantParameter:
+  instantInstance
+  | CHAR_LIT { PL; std::string s = std::string($1); $$ = MakeAstNode(s.substr(1, s.size() - 2)); }
+  | propertyName
+  | function
+
 arrayPredicate:
   ARR_FUNC LPT arrayExpression COMMA arrayExpression RPT { PL; $$ = MakeAstNode(ArrayPred, NameOp.at($1), std::vector({$3, $5})); }
 
@@ -11,6 +11,12 @@
 #include <cql2cpp/cql2cpp.h>
 #include <cql2cpp/feature_source.h>
 #include <cql2cpp/feature_source_geojson.h>
+#include <cql2cpp/feature_source_geojson_object.h>
+#include <cql2cpp/feature_source_mapped.h>
+#include <cql2cpp/flatgeobuf_reader.h>
+#include <cql2cpp/geojson_mapped_reader.h>
+#include <cql2cpp/geojson_seq_filter.h>
+#include <cql2cpp/geojson_stream_reader.h>
 #include <cql2cpp/global_yylex.h>
 #include <geos/geom/GeometryFactory.h>
 #include <geos/geom/Point.h>
@@ -45,7 +51,21 @@ int main(int argc, char** argv) {
   filter_command.add_argument("query").help("cql2 query string");
   filter_command.add_argument("--features")
       .help(
-          "geojson file contains multiple features in one feature collection");
+          "geojson file contains multiple features in one feature collection, "
+          "- for stdin")
+      .default_value(std::string("-"));
+  filter_command.add_argument("--ndjson")
+      .help(
+          "read one feature per line and write the matching lines to stdout")
+      .flag();
+  filter_command.add_argument("--profile")
+      .help("print the N nodes of the query taking most time")
+      .default_value(0)
+      .implicit_value(10)
+      .nargs(argparse::nargs_pattern::optional)
+      .scan<'i', int>();
+  filter_command.add_argument("-O", "--output")
+      .help("the output dot file of the profile as a heat map");
   filter_command.add_argument("-V", "--verbose")
       .help("print verbose debug log")
       .flag();
@@ -93,6 +113,10 @@ int main(int argc, char** argv) {
   google::InstallFailureSignalHandler();
   google::LogToStderr();
 
+  // filled by filter --profile
+  cql2cpp::EvaluationProfile profile;
+  cql2cpp::AstNodePtr profiled;
+
   if (program.is_subcommand_used("parse")) {
     if (parse_command.get<bool>("--verbose"))
       cql2cpp::AstNode::set_ostream(&std::cout);
@@ -123,52 +147,114 @@ int main(int argc, char** argv) {
   } else if (program.is_subcommand_used("filter")) {
     if (filter_command.get<bool>("--verbose"))
       cql2cpp::AstNode::set_ostream(&std::cout);
-    std::string geojson_text;
     std::string features = filter_command.get<std::string>("--features");
-    std::ifstream fin(features);
-
-    if (not fin.good()) {
-      LOG(ERROR) << features << " not exist";
+    std::string query = filter_command.get<std::string>("query");
+    std::string error_msg;
+    cql2cpp::AstNodePtr root =
+        cql2cpp::Cql2Cpp::ParseAsAst(query, &error_msg);
+    if (root == nullptr) {
+      LOG(ERROR) << "filter error: " << error_msg;
       goto FAILED;
     }
-    if (not fin.is_open()) {
-      LOG(ERROR) << "can not open " << features;
-      goto FAILED;
+    cql2cpp::Cql2Cpp cql2cpp;
+    size_t matched = 0;
+    if (filter_command.get<int>("--profile") > 0) {
+      cql2cpp.set_profile(&profile);
+      profiled = root;
     }
-    geojson_text.assign(std::istreambuf_iterator<char>(fin),
-                        std::istreambuf_iterator<char>());
-    fin.close();
 
-    geos::io::GeoJSONFeatureCollection fc({});
-    // read geojson features
-    geos::io::GeoJSONReader reader;
-    fc = reader.readFeatures(geojson_text);
-    LOG(INFO) << "load " << fc.getFeatures().size() << " features from "
-              << features;
+    // FlatGeobuf, only the features its index finds in the spatial window
+    // of the query are decoded
+    if (features.size() > 4 and
+        features.compare(features.size() - 4, 4, ".fgb") == 0) {
+      cql2cpp::FlatGeobufReader reader;
+      std::vector<cql2cpp::FeatureSourcePtr> candidates;
+      if (not reader.Open(features) or not reader.Load(root, &candidates)) {
+        LOG(ERROR) << "read " << features << " error: " << reader.error_msg();
+        goto FAILED;
+      }
+      for (const auto& fs : candidates) {
+        if (not cql2cpp.Matches(root, *fs)) continue;
+        matched++;
+        LOG(INFO) << cql2cpp::value_str(fs->get_property("geom"));
+      }
+      LOG(INFO) << matched << " of " << reader.features_count()
+                << " features match the filter, " << reader.decoded()
+                << " decoded";
+      goto DONE;
+    }
 
-    std::vector<cql2cpp::FeatureSourcePtr> fs_feature;
-    std::map<cql2cpp::FeatureSourcePtr, const geos::io::GeoJSONFeature*>
-        fs_to_geojson;
-    for (const auto& feature : fc.getFeatures()) {
-      cql2cpp::FeatureSourcePtr fp =
-          std::make_shared<cql2cpp::FeatureSourceGeoJson>(feature);
-      fs_feature.emplace_back(fp);
-      fs_to_geojson[fp] = &feature;
+    // evaluate features in place in the mapped file
+    std::shared_ptr<const cql2cpp::MappedFile> file;
+    if (features != "-" and not filter_command.get<bool>("--ndjson"))
+      file = cql2cpp::MappedFile::Open(features, &error_msg);
+    if (file != nullptr) {
+      file->AdviseSequential();
+      cql2cpp::GeoJsonMappedReader reader;
+      bool read = reader.Read(file->text(), [&](std::string_view text) {
+        cql2cpp::FeatureSourceMapped fs(file, text);
+        if (cql2cpp.Matches(root, fs)) {
+          matched++;
+          LOG(INFO) << text;
+        }
+        return true;
+      });
+      if (not read) {
+        LOG(ERROR) << "read " << features << " error: " << reader.error_msg();
+        goto FAILED;
+      }
+      LOG(INFO) << matched << " of " << reader.count()
+                << " features match the filter";
+      goto DONE;
     }
 
-    std::string query = filter_command.get<std::string>("query");
+    std::ifstream fin;
+    if (features != "-") {
+      fin.open(features);
+      if (not fin.is_open()) {
+        LOG(ERROR) << "can not open " << features;
+        goto FAILED;
+      }
+    }
+    std::istream& in = features == "-" ? std::cin : fin;
 
-    cql2cpp::Cql2Cpp cql2cpp;
-    cql2cpp.set_feature_source(fs_feature);
-    std::vector<cql2cpp::FeatureSourcePtr> result;
-    if (cql2cpp.filter(query, &result)) {
-      LOG(INFO) << result.size() << " features match the filter:";
-      geos::io::GeoJSONWriter writer;
-      for (const auto& feature : result)
-        LOG(INFO) << writer.write(*fs_to_geojson[feature]);
-    } else {
-      LOG(ERROR) << "filter error: " << cql2cpp.error_msg();
+    // one feature per line, matching lines go to stdout unchanged
+    if (filter_command.get<bool>("--ndjson")) {
+      std::ios::sync_with_stdio(false);
+      cql2cpp::GeoJsonSeqFilter seq_filter(
+          [&](const cql2cpp::FeatureSource& fs) {
+            return cql2cpp.Matches(root, fs);
+          });
+      bool run = seq_filter.Run(in, std::cout);
+      if (seq_filter.skipped() > 0)
+        LOG(WARNING) << "skip " << seq_filter.skipped()
+                     << " lines which are not features";
+      if (not run) {
+        LOG(ERROR) << "filter " << features
+                   << " error: " << seq_filter.error_msg();
+        goto FAILED;
+      }
+      LOG(INFO) << seq_filter.selected() << " of " << seq_filter.count()
+                << " features match the filter";
+      goto DONE;
     }
+
+    // not a regular file, evaluate features while reading them
+    cql2cpp::GeoJsonStreamReader reader;
+    bool read = reader.Read(in, [&](geos_nlohmann::json&& feature) {
+      cql2cpp::FeatureSourceGeoJsonObject fs(feature);
+      if (cql2cpp.Matches(root, fs)) {
+        matched++;
+        LOG(INFO) << feature.dump();
+      }
+      return true;
+    });
+    if (not read) {
+      LOG(ERROR) << "read " << features << " error: " << reader.error_msg();
+      goto FAILED;
+    }
+    LOG(INFO) << matched << " of " << reader.count()
+              << " features match the filter";
   } else if (program.is_subcommand_used("sql")) {
     if (sql_command.get<bool>("--verbose"))
       cql2cpp::AstNode::set_ostream(&std::cout);
@@ -185,42 +271,39 @@ int main(int argc, char** argv) {
     if (eval_command.get<bool>("--verbose")) {
       cql2cpp::AstNode::set_ostream(&std::cout);
     }
-    std::string geojson_text;
     std::string features = eval_command.get<std::string>("--features");
-    std::ifstream fin(features);
-    if (not fin.good()) {
-      LOG(ERROR) << features << " not exist";
-      goto FAILED;
-    }
-    if (not fin.is_open()) {
-      LOG(ERROR) << "can not open " << features;
+    std::string error_msg;
+    std::shared_ptr<const cql2cpp::MappedFile> file =
+        cql2cpp::MappedFile::Open(features, &error_msg);
+    if (file == nullptr) {
+      LOG(ERROR) << error_msg;
       goto FAILED;
     }
-    geojson_text.assign(std::istreambuf_iterator<char>(fin),
-                        std::istreambuf_iterator<char>());
-    fin.close();
-
-    geos::io::GeoJSONFeatureCollection fc({});
-    // read geojson features
-    geos::io::GeoJSONReader reader;
-    fc = reader.readFeatures(geojson_text);
-    LOG(INFO) << "load " << fc.getFeatures().size() << " features from "
-              << features;
 
+    // only the feature evaluated is parsed, the others are skipped
     int index = eval_command.get<int>("index");
-    if (index >= fc.getFeatures().size()) {
-      LOG(ERROR) << "index(" << index << ") out of range [0.."
-                 << fc.getFeatures().size() - 1 << "]";
+    std::string_view feature_text;
+    cql2cpp::GeoJsonMappedReader reader;
+    reader.Read(file->text(), [&](std::string_view text) {
+      if (reader.count() <= index) return true;
+      feature_text = text;
+      return false;
+    });
+    if (feature_text.empty()) {
+      if (reader.error_msg().empty())
+        LOG(ERROR) << "index(" << index << ") out of range [0.."
+                   << static_cast<int>(reader.count()) - 1 << "]";
+      else
+        LOG(ERROR) << "read " << features << " error: " << reader.error_msg();
       goto FAILED;
     }
-    cql2cpp::FeatureSourceGeoJson fs(fc.getFeatures().at(index));
+    cql2cpp::FeatureSourceMapped fs(file, feature_text);
     std::string query = eval_command.get<std::string>("query");
 
     cql2cpp::Cql2Cpp cql2cpp;
 
     std::string dot;
     bool eval_result;
-    std::string error_msg;
     if (cql2cpp.Evaluate(query, fs, &eval_result, &error_msg, &dot)) {
       if (eval_command.is_used("--output")) {
         std::string dot_filename = eval_command.get<std::string>("--output");
@@ -246,6 +329,27 @@ int main(int argc, char** argv) {
     LOG(ERROR) << "unknown sub-command";
   }
 
+DONE:
+
+  if (profiled != nullptr) {
+    std::ostringstream table;
+    profile.Print(table, profiled, filter_command.get<int>("--profile"));
+    LOG(INFO) << "nodes taking most time:\n" << table.str();
+    if (filter_command.is_used("--output")) {
+      std::string dot_filename = filter_command.get<std::string>("--output");
+      if (dot_filename.find(".dot") == std::string::npos)
+        dot_filename += ".dot";
+      std::ofstream fout(dot_filename);
+      if (fout.is_open()) {
+        cql2cpp::Tree2Dot::GenerateDot(
+            fout, profiled, filter_command.get<std::string>("query"), &profile);
+        LOG(INFO) << "dump profile into " << dot_filename;
+      } else {
+        LOG(ERROR) << "Can not open file " << dot_filename;
+      }
+    }
+  }
+
   gflags::ShutDownCommandLineFlags();
   google::ShutdownGoogleLogging();
   return 0;
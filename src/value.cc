@@ -10,19 +10,29 @@
 
 #include <cql2cpp/value.h>
 
+#include <algorithm>
+
 namespace cql2cpp {
 
+// owned strings and views order alike
+static size_t Rank(const ValueT& value) {
+  static const size_t string_index = ValueT(std::string()).index();
+  return IsString(value) ? string_index : value.index();
+}
+
 bool ArrayElementComp::operator()(const Element& lhs,
                                   const Element& rhs) const {
   const auto& a = lhs.value;
   const auto& b = rhs.value;
-  if (a.index() != b.index()) return std::less()(a.index(), b.index());
+  if (Rank(a) != Rank(b)) return std::less()(Rank(a), Rank(b));
 
   if (std::holds_alternative<NullStruct>(a)) return less<NullStruct>(a, b);
   if (std::holds_alternative<bool>(a)) return less<bool>(a, b);
   if (std::holds_alternative<int64_t>(a)) return less<int64_t>(a, b);
   if (std::holds_alternative<uint64_t>(a)) return less<uint64_t>(a, b);
-  if (std::holds_alternative<std::string>(a)) return less<std::string>(a, b);
+  if (std::holds_alternative<TimeValue>(a)) return less<TimeValue>(a, b);
+  std::string_view s_a, s_b;
+  if (GetString(a, &s_a) and GetString(b, &s_b)) return s_a < s_b;
 
   if (std::holds_alternative<double>(a)) {
     double d_a = std::get<double>(a);
@@ -31,7 +41,38 @@ bool ArrayElementComp::operator()(const Element& lhs,
     return std::less()(d_a, d_b);
   }
 
+  if (std::holds_alternative<ArrayType>(a)) {
+    const auto& a_array = std::get<ArrayType>(a);
+    const auto& b_array = std::get<ArrayType>(b);
+    return std::lexicographical_compare(a_array.begin(), a_array.end(),
+                                        b_array.begin(), b_array.end(), *this);
+  }
+
+  // geometries and envelopes have no natural order, compare by identity
+  if (std::holds_alternative<const geos::geom::Geometry*>(a))
+    return less<const geos::geom::Geometry*>(a, b);
+  if (std::holds_alternative<const geos::geom::Envelope*>(a))
+    return less<const geos::geom::Envelope*>(a, b);
+
+  return false;
+}
+
+bool IsSortedSet(const ArrayType& array) {
+  ArrayElementComp comp;
+  for (size_t i = 1; i < array.size(); i++)
+    if (not comp(array[i - 1], array[i])) return false;
   return true;
 }
 
+void NormalizeArray(ArrayType* array) {
+  if (IsSortedSet(*array)) return;
+  ArrayElementComp comp;
+  std::sort(array->begin(), array->end(), comp);
+  array->erase(std::unique(array->begin(), array->end(),
+                           [&comp](const Element& a, const Element& b) {
+                             return comp.equivalent(a, b);
+                           }),
+               array->end());
+}
+
 }  // namespace cql2cpp
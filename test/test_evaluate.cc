@@ -0,0 +1,212 @@
+/*
+ * File Name: test_evaluate.cc
+ *
+ * Copyright (c) 2024 - 2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/20
+ *
+ */
+#include <cql2cpp/cql2cpp.h>
+#include <cql2cpp/feature_source_json.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+class EvaluateTest : public testing::Test {
+ protected:
+  cql2cpp::Cql2Cpp cql2cpp_;
+  std::shared_ptr<cql2cpp::FeatureSourceJson> feature_;
+
+ public:
+  void SetUp() override {
+    FLAGS_colorlogtostderr = true;
+    feature_ = std::make_shared<cql2cpp::FeatureSourceJson>(
+        geos_nlohmann::json::parse(R"({
+          "labels": ["PICKING", "A-01", "PICKING", "CONTAINER"],
+          "empty": [],
+          "status": "OCCUPIED",
+          "name": "Café Ünter",
+          "created": "2025-06-08T10:00:00Z",
+          "floor": 3,
+          "weight": -12.5,
+          "serial": 9007199254740993,
+          "note": null
+        })"));
+  }
+
+  bool Eval(const std::string& query) {
+    bool result = false;
+    std::string error_msg;
+    EXPECT_TRUE(
+        cql2cpp_.Evaluate(query, *feature_, &result, &error_msg, nullptr))
+        << query << ": " << error_msg;
+    return result;
+  }
+};
+
+TEST_F(EvaluateTest, array_contains) {
+  EXPECT_TRUE(Eval("A_CONTAINS(labels, ['CONTAINER', 'PICKING'])"));
+  EXPECT_TRUE(Eval("A_CONTAINS(labels, ['PICKING', 'PICKING'])"));
+  EXPECT_TRUE(Eval("A_CONTAINS(labels, [])"));
+  EXPECT_FALSE(Eval("A_CONTAINS(labels, ['PICKING', 'B-01'])"));
+  EXPECT_FALSE(Eval("A_CONTAINS(empty, ['PICKING'])"));
+}
+
+TEST_F(EvaluateTest, array_contained_by) {
+  EXPECT_TRUE(
+      Eval("A_CONTAINEDBY(labels, ['A-01', 'CONTAINER', 'PICKING', 'X'])"));
+  EXPECT_TRUE(Eval("A_CONTAINEDBY(empty, ['PICKING'])"));
+  EXPECT_FALSE(Eval("A_CONTAINEDBY(labels, ['PICKING', 'CONTAINER'])"));
+}
+
+TEST_F(EvaluateTest, array_equals) {
+  EXPECT_TRUE(Eval("A_EQUALS(['CONTAINER', 'A-01', 'PICKING'], labels)"));
+  EXPECT_TRUE(
+      Eval("A_EQUALS(labels, ['A-01', 'A-01', 'CONTAINER', 'PICKING'])"));
+  EXPECT_FALSE(Eval("A_EQUALS(labels, ['A-01', 'PICKING'])"));
+}
+
+TEST_F(EvaluateTest, array_overlaps) {
+  EXPECT_TRUE(Eval("A_OVERLAPS(labels, ['B-01', 'A-01'])"));
+  EXPECT_FALSE(Eval("A_OVERLAPS(labels, ['B-01', 'B-02'])"));
+  EXPECT_FALSE(Eval("A_OVERLAPS(empty, ['B-01'])"));
+}
+
+TEST_F(EvaluateTest, like) {
+  EXPECT_TRUE(Eval("status LIKE 'OCCUPIED'"));
+  EXPECT_TRUE(Eval("status LIKE 'OCC%'"));
+  EXPECT_TRUE(Eval("status LIKE '%PIED'"));
+  EXPECT_TRUE(Eval("status LIKE '%CUP%'"));
+  EXPECT_TRUE(Eval("status LIKE 'O_CUP%D'"));
+  EXPECT_FALSE(Eval("status LIKE 'O_CUP%X'"));
+  EXPECT_FALSE(Eval("status LIKE 'occ%'"));
+  EXPECT_TRUE(Eval("status NOT LIKE 'occ%'"));
+  EXPECT_TRUE(Eval("CASEI(status) LIKE CASEI('occ%')"));
+  EXPECT_TRUE(Eval("ACCENTI(name) LIKE 'Cafe U%'"));
+  EXPECT_TRUE(Eval("CASEI(ACCENTI(name)) LIKE CASEI('CAFE_UNTER')"));
+  EXPECT_TRUE(Eval("CASEI(status) = CASEI('Occupied')"));
+}
+
+TEST_F(EvaluateTest, between) {
+  EXPECT_TRUE(Eval("floor BETWEEN 3 AND 5"));
+  EXPECT_TRUE(Eval("floor BETWEEN 1 AND 3"));
+  EXPECT_FALSE(Eval("floor BETWEEN 4 AND 5"));
+  EXPECT_TRUE(Eval("floor NOT BETWEEN 4 AND 5"));
+  EXPECT_TRUE(Eval("weight BETWEEN -13 AND -12"));
+  EXPECT_TRUE(Eval("floor BETWEEN 2.5 AND 3.5"));
+  // 2^53 + 1 is not rounded to 2^53
+  EXPECT_TRUE(Eval("serial BETWEEN 9007199254740993 AND 9007199254740993"));
+  EXPECT_FALSE(Eval("serial BETWEEN 9007199254740992 AND 9007199254740992"));
+  EXPECT_TRUE(Eval("3 BETWEEN floor AND 4"));
+
+  bool result;
+  std::string error_msg;
+  EXPECT_FALSE(cql2cpp_.Evaluate("status BETWEEN 1 AND 2", *feature_, &result,
+                                 &error_msg, nullptr));
+}
+
+TEST_F(EvaluateTest, is_null) {
+  EXPECT_TRUE(Eval("note IS NULL"));
+  EXPECT_TRUE(Eval("missing IS NULL"));
+  EXPECT_FALSE(Eval("status IS NULL"));
+  EXPECT_FALSE(Eval("empty IS NULL"));
+  EXPECT_TRUE(Eval("labels IS NOT NULL"));
+  EXPECT_FALSE(Eval("note IS NOT NULL"));
+}
+
+TEST(LikeMatcherTest, kinds) {
+  using cql2cpp::LikeMatcher;
+  EXPECT_EQ(LikeMatcher("A-01").kind(), LikeMatcher::Exact);
+  EXPECT_EQ(LikeMatcher("A-01%").kind(), LikeMatcher::Prefix);
+  EXPECT_EQ(LikeMatcher("%-01").kind(), LikeMatcher::Suffix);
+  EXPECT_EQ(LikeMatcher("%-01%%").kind(), LikeMatcher::Contains);
+  EXPECT_EQ(LikeMatcher("A\\_01%").kind(), LikeMatcher::Prefix);
+  EXPECT_EQ(LikeMatcher("A_01%").kind(), LikeMatcher::General);
+
+  EXPECT_TRUE(LikeMatcher("A\\_01%").Match("A_01-02"));
+  EXPECT_FALSE(LikeMatcher("A\\_01%").Match("AB01-02"));
+  EXPECT_TRUE(LikeMatcher("%aab").Match("aaab"));
+  EXPECT_TRUE(LikeMatcher("a%b%c").Match("acbc"));
+  EXPECT_FALSE(LikeMatcher("a%b%c").Match("acbcx"));
+  EXPECT_TRUE(LikeMatcher("a_c").Match("a\xc3\xa9" "c"));  // one code point
+  EXPECT_FALSE(LikeMatcher("a__c").Match("a\xc3\xa9" "c"));
+  EXPECT_TRUE(LikeMatcher("%").Match(""));
+}
+
+TEST_F(EvaluateTest, temporal) {
+  EXPECT_TRUE(Eval("T_AFTER(created, DATE('2025-06-07'))"));
+  EXPECT_TRUE(Eval("T_DURING(created, DATE('2025-06-08'))"));
+  EXPECT_TRUE(Eval("T_DURING(created, INTERVAL('2025-06-01', '..'))"));
+  EXPECT_TRUE(
+      Eval("T_BEFORE(created, TIMESTAMP('2025-06-08T12:00:00+01:00'))"));
+  EXPECT_FALSE(Eval("T_BEFORE(created, TIMESTAMP('2025-06-08T10:00:00Z'))"));
+  EXPECT_TRUE(
+      Eval("T_MEETS(INTERVAL('..', created), INTERVAL(created, '..'))"));
+  EXPECT_TRUE(Eval("T_EQUALS(DATE('2025-06-08'), "
+                   "INTERVAL('2025-06-08T00:00:00Z', "
+                   "'2025-06-08T23:59:59.999999999Z'))"));
+  EXPECT_TRUE(
+      Eval("t_intersects(created, interval('2025-06-08', '2025-06-09'))"));
+
+  bool result;
+  std::string error_msg;
+  EXPECT_FALSE(cql2cpp_.Evaluate("T_AFTER(created, DATE('2025-02-30'))",
+                                 *feature_, &result, &error_msg, nullptr));
+  EXPECT_FALSE(cql2cpp_.Evaluate("T_AFTER(status, DATE('2025-02-28'))",
+                                 *feature_, &result, &error_msg, nullptr));
+}
+
+TEST(TimeParserTest, parse) {
+  using cql2cpp::TimeParser;
+  cql2cpp::TimeValue time;
+  EXPECT_TRUE(TimeParser::ParseTimestamp("1970-01-01T01:00:00+01:00", &time));
+  EXPECT_EQ(time.begin, 0);
+  EXPECT_TRUE(TimeParser::ParseTimestamp("1969-12-31T23:59:59.5Z", &time));
+  EXPECT_EQ(time.begin, -TimeParser::kSecond / 2);
+  EXPECT_EQ(TimeParser::Format(time.begin), "1969-12-31T23:59:59.5Z");
+  EXPECT_TRUE(TimeParser::ParseDate("2024-02-29", &time));
+  EXPECT_EQ(time.end - time.begin, TimeParser::kDay - 1);
+  EXPECT_FALSE(TimeParser::ParseDate("2023-02-29", &time));
+  EXPECT_FALSE(TimeParser::ParseTimestamp("2025-06-08T10:00:00", &time));
+  EXPECT_FALSE(TimeParser::ParseTimestamp("2025-06-08T24:00:00Z", &time));
+}
+
+TEST_F(EvaluateTest, profile) {
+  std::string error_msg;
+  auto root = cql2cpp::Cql2Cpp::ParseAsAst(
+      "floor > 2 AND status = 'EMPTY'", &error_msg);
+  ASSERT_NE(root, nullptr) << error_msg;
+
+  cql2cpp::EvaluationProfile profile;
+  cql2cpp::Evaluator evaluator;
+  evaluator.set_profile(&profile);
+  cql2cpp::ValueT value;
+  for (int i = 0; i < 3; i++) evaluator.Evaluate(root, feature_.get(), &value);
+
+  const cql2cpp::NodeProfile* p = profile.Get(root.get());
+  ASSERT_NE(p, nullptr);
+  EXPECT_EQ(p->calls, 3);
+  EXPECT_EQ(p->trues, 0);
+  EXPECT_EQ(p->falses, 3);
+  const cql2cpp::NodeProfile* floor = profile.Get(root->children().at(0).get());
+  ASSERT_NE(floor, nullptr);
+  EXPECT_EQ(floor->trues, 3);
+  for (const auto& node : *root) {
+    const cql2cpp::NodeProfile* n = profile.Get(node.get());
+    if (n != nullptr) EXPECT_LE(profile.SelfTime(node), n->time);
+  }
+
+  auto top = profile.Top(root, 2);
+  ASSERT_EQ(top.size(), 2);
+  EXPECT_GE(profile.SelfTime(top.at(0)), profile.SelfTime(top.at(1)));
+
+  std::stringstream dot;
+  cql2cpp::Tree2Dot::GenerateDot(dot, root, "profile", &profile);
+  EXPECT_NE(dot.str().find("calls 3"), std::string::npos);
+  EXPECT_NE(dot.str().find("fillcolor"), std::string::npos);
+
+  // not recorded once the profile is removed
+  evaluator.set_profile(nullptr);
+  evaluator.Evaluate(root, feature_.get(), &value);
+  EXPECT_EQ(profile.Get(root.get())->calls, 3);
+}
@@ -0,0 +1,590 @@
+/*
+ * File Name: test_filter.cc
+ *
+ * Copyright (c) 2024 - 2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/21
+ *
+ */
+#include <cql2cpp/cql2cpp.h>
+#include <cql2cpp/feature_source_geojson.h>
+#include <cql2cpp/feature_source_json.h>
+#include <glog/logging.h>
+#include <geos/io/GeoJSONReader.h>
+#include <gtest/gtest.h>
+
+class FilterTest : public testing::Test {
+ protected:
+  std::vector<cql2cpp::FeatureSourcePtr> features_;
+  cql2cpp::Cql2Cpp scan_;
+  cql2cpp::Cql2Cpp indexed_;
+
+ public:
+  void SetUp() override {
+    FLAGS_colorlogtostderr = true;
+    const std::vector<std::string> statuses = {"OCCUPIED", "FREE", "LOCKED"};
+    const std::vector<std::string> zones = {"A", "B", "C", "D", "E"};
+    cql2cpp::TimeValue base;
+    cql2cpp::TimeParser::ParseTimestamp("2025-06-01T00:00:00Z", &base);
+    for (int i = 0; i < 100; i++) {
+      geos_nlohmann::json j;
+      j["status"] = statuses.at(i % statuses.size());
+      j["zone"] = zones.at(i % zones.size());
+      j["labels"] = geos_nlohmann::json::array();
+      if (i % 2 == 0) j["labels"].push_back("PICKING");
+      if (i % 7 == 0) j["labels"].push_back("CONTAINER");
+      j["floor"] = i % 6;
+      j["capacity"] = i % 4;
+      j["weight"] = i * 10.5;
+      // hourly tasks of half an hour
+      int64_t start = base.begin + i * 3600 * cql2cpp::TimeParser::kSecond;
+      j["start"] = cql2cpp::TimeParser::Format(start);
+      j["end"] = cql2cpp::TimeParser::Format(
+          start + 1800 * cql2cpp::TimeParser::kSecond);
+      features_.emplace_back(std::make_shared<cql2cpp::FeatureSourceJson>(j));
+    }
+
+    for (const auto& queryable : {"status", "zone", "labels"})
+      indexed_.RegisterIndex(
+          std::make_shared<cql2cpp::IndexInverted>(queryable));
+    for (const auto& queryable : {"floor", "weight"})
+      indexed_.RegisterIndex(std::make_shared<cql2cpp::IndexRange>(queryable));
+
+    scan_.set_feature_source(features_);
+    indexed_.set_feature_source(features_);
+  }
+
+  // the indexed filter must return exactly what a full scan returns
+  size_t Compare(const std::string& query) {
+    std::vector<cql2cpp::FeatureSourcePtr> expected;
+    std::vector<cql2cpp::FeatureSourcePtr> actual;
+    EXPECT_TRUE(scan_.filter(query, &expected)) << scan_.error_msg();
+    EXPECT_TRUE(indexed_.filter(query, &actual)) << indexed_.error_msg();
+    EXPECT_EQ(expected, actual) << query;
+    return actual.size();
+  }
+};
+
+TEST_F(FilterTest, inverted_equal) {
+  EXPECT_EQ(Compare("status = 'OCCUPIED'"), 34);
+  EXPECT_EQ(Compare("'LOCKED' = status"), 33);
+  EXPECT_EQ(Compare("status = 'UNKNOWN'"), 0);
+}
+
+TEST_F(FilterTest, inverted_in) {
+  EXPECT_EQ(Compare("zone IN ('A', 'C')"), 40);
+  EXPECT_EQ(Compare("zone IN ('A', 'C') AND status = 'FREE'"), 13);
+}
+
+TEST_F(FilterTest, inverted_array) {
+  EXPECT_EQ(Compare("A_CONTAINS(labels, ['PICKING'])"), 50);
+  EXPECT_EQ(Compare("A_CONTAINS(labels, ['PICKING', 'CONTAINER'])"), 8);
+  EXPECT_EQ(Compare("A_CONTAINEDBY(['CONTAINER'], labels)"), 15);
+  EXPECT_EQ(Compare("A_OVERLAPS(labels, ['PICKING', 'CONTAINER'])"), 57);
+  EXPECT_EQ(Compare("A_EQUALS(labels, ['CONTAINER'])"), 7);
+}
+
+TEST_F(FilterTest, array_columns) {
+  // labels sorted once per feature, merged without reading the property
+  cql2cpp::Cql2Cpp arrays;
+  arrays.RegisterArray("labels");
+  arrays.set_feature_source(features_);
+  cql2cpp::EvaluationProfile profile;
+  arrays.set_profile(&profile);
+  const std::vector<std::pair<std::string, size_t>> queries = {
+      {"A_CONTAINS(labels, ['CONTAINER', 'PICKING'])", 8},
+      {"A_CONTAINEDBY(['CONTAINER'], labels)", 15},
+      {"A_OVERLAPS(labels, ['PICKING', 'CONTAINER'])", 57},
+      {"A_EQUALS(labels, ['CONTAINER'])", 7}};
+  for (const auto& [query, expected] : queries) {
+    size_t count;
+    EXPECT_TRUE(arrays.count(query, &count)) << arrays.error_msg();
+    EXPECT_EQ(count, expected) << query;
+    EXPECT_TRUE(scan_.count(query, &count)) << scan_.error_msg();
+    EXPECT_EQ(count, expected) << query;
+  }
+  ASSERT_FALSE(profile.empty());
+  for (const cql2cpp::AstNode* node : profile.nodes())
+    EXPECT_EQ(node->type(), cql2cpp::ArrayPred);
+}
+
+TEST_F(FilterTest, inverted_residual) {
+  EXPECT_EQ(Compare("status = 'OCCUPIED' AND capacity > 1"), 17);
+  EXPECT_EQ(Compare("status = 'OCCUPIED' OR zone = 'A'"), 47);
+}
+
+TEST_F(FilterTest, range_compare) {
+  EXPECT_EQ(Compare("weight > 500 AND weight <= 900"), 38);
+  EXPECT_EQ(Compare("500 < weight"), 52);
+  EXPECT_EQ(Compare("floor = 3"), 17);
+  EXPECT_EQ(Compare("status = 'OCCUPIED' AND floor > 2"), 17);
+  EXPECT_EQ(Compare("floor >= 5 OR weight < 100"), 25);
+}
+
+TEST_F(FilterTest, range_between) {
+  std::vector<cql2cpp::FeatureSourcePtr> result;
+  EXPECT_TRUE(indexed_.filter("floor BETWEEN 2 AND 4", &result));
+  EXPECT_EQ(result.size(), 50);
+}
+
+TEST(IndexRangeTest, large_integers) {
+  // doubles merge integers beyond 2^53, the evaluator does not
+  std::vector<cql2cpp::FeatureSourcePtr> features;
+  for (int64_t i = 0; i < 32; i++)
+    features.emplace_back(std::make_shared<cql2cpp::FeatureSourceJson>(
+        geos_nlohmann::json{{"serial", i < 8 ? 9007199254740992 + i : i}}));
+  cql2cpp::Cql2Cpp scan;
+  cql2cpp::Cql2Cpp indexed;
+  indexed.RegisterIndex(std::make_shared<cql2cpp::IndexRange>("serial"));
+  scan.set_feature_source(features);
+  indexed.set_feature_source(features);
+  const std::vector<std::pair<std::string, size_t>> queries = {
+      {"serial BETWEEN 9007199254740993 AND 9007199254740993", 1},
+      {"serial BETWEEN 9007199254740993 AND 9007199254740995", 3},
+      {"serial BETWEEN 8 AND 20", 13}};
+  for (const auto& [query, expected] : queries) {
+    size_t count;
+    EXPECT_TRUE(indexed.count(query, &count)) << indexed.error_msg();
+    EXPECT_EQ(count, expected) << query;
+    EXPECT_TRUE(scan.count(query, &count)) << scan.error_msg();
+    EXPECT_EQ(count, expected) << query;
+  }
+  for (const std::string query :
+       {"serial > 9007199254740992", "serial <= 9007199254740993",
+        "serial = 9007199254740994", "serial < 10"}) {
+    size_t expected, actual;
+    EXPECT_TRUE(scan.count(query, &expected)) << scan.error_msg();
+    EXPECT_TRUE(indexed.count(query, &actual)) << indexed.error_msg();
+    EXPECT_EQ(expected, actual) << query;
+  }
+}
+
+TEST_F(FilterTest, between_and_null) {
+  // residual BETWEEN and IS NULL are decided for all candidates at once,
+  // which must agree with evaluating each feature
+  const std::vector<std::pair<std::string, size_t>> queries = {
+      {"floor BETWEEN 2 AND 3 AND capacity BETWEEN 1 AND 2", 17},
+      {"capacity NOT BETWEEN 1 AND 2", 50},
+      {"missing IS NULL AND zone = 'A'", 20},
+      {"status IS NOT NULL AND capacity BETWEEN 0.5 AND 1", 25},
+      {"labels IS NULL", 0}};
+  for (const auto& [query, expected] : queries) {
+    EXPECT_EQ(Compare(query), expected) << query;
+    size_t evaluated = 0;
+    for (const auto& feature : features_) {
+      bool result;
+      std::string error_msg;
+      EXPECT_TRUE(scan_.Evaluate(query, *feature, &result, &error_msg, nullptr))
+          << error_msg;
+      evaluated += result;
+    }
+    EXPECT_EQ(evaluated, expected) << query;
+  }
+}
+
+TEST_F(FilterTest, between_profiled) {
+  // a profile records the BETWEEN conjunct evaluated on every feature
+  cql2cpp::Cql2Cpp profiled;
+  profiled.set_feature_source(features_);
+  cql2cpp::EvaluationProfile profile;
+  profiled.set_profile(&profile);
+  size_t count;
+  EXPECT_TRUE(profiled.count("floor BETWEEN 2 AND 3 AND capacity > 1", &count))
+      << profiled.error_msg();
+  EXPECT_EQ(count, 18);
+
+  const cql2cpp::NodeProfile* between = nullptr;
+  const cql2cpp::NodeProfile* greater = nullptr;
+  for (const cql2cpp::AstNode* node : profile.nodes()) {
+    if (node->type() == cql2cpp::IsBetweenPred) between = profile.Get(node);
+    if (node->op() == cql2cpp::Greater) greater = profile.Get(node);
+  }
+  ASSERT_NE(between, nullptr);
+  EXPECT_EQ(between->calls, 100);
+  EXPECT_EQ(between->trues, 34);
+  ASSERT_NE(greater, nullptr);
+  EXPECT_EQ(greater->trues, 18);
+}
+
+TEST_F(FilterTest, selection_set) {
+  cql2cpp::SelectionSet expected;
+  cql2cpp::SelectionSet actual;
+  EXPECT_TRUE(scan_.filter("zone = 'B' AND floor < 3", &expected));
+  EXPECT_TRUE(indexed_.filter("zone = 'B' AND floor < 3", &actual));
+  EXPECT_EQ(expected, actual);
+  EXPECT_EQ(actual.ToVector(),
+            std::vector<uint32_t>({1, 6, 26, 31, 36, 56, 61, 66, 86, 91, 96}));
+}
+
+TEST_F(FilterTest, count) {
+  size_t count;
+  EXPECT_TRUE(indexed_.count("status = 'FREE'", &count));
+  EXPECT_EQ(count, 33);
+  EXPECT_TRUE(indexed_.count("status = 'FREE' AND capacity = 0", &count));
+  EXPECT_EQ(count, 8);
+  EXPECT_TRUE(scan_.count("status = 'FREE' AND capacity = 0", &count));
+  EXPECT_EQ(count, 8);
+}
+
+TEST_F(FilterTest, for_each) {
+  std::vector<uint32_t> ordinals;
+  EXPECT_TRUE(indexed_.for_each(
+      "A_CONTAINS(labels, ['CONTAINER']) AND weight < 500",
+      [&](uint32_t ordinal, const cql2cpp::FeatureSource&) {
+        ordinals.emplace_back(ordinal);
+      }));
+  EXPECT_EQ(ordinals, std::vector<uint32_t>({0, 7, 14, 21, 28, 35, 42}));
+}
+
+TEST_F(FilterTest, folded) {
+  cql2cpp::Cql2Cpp folded;
+  folded.RegisterFolding("status", cql2cpp::StringFold::CaseFolding);
+  folded.set_feature_source(features_);
+  const std::vector<std::pair<std::string, size_t>> queries = {
+      {"CASEI(status) = CASEI('free')", 33},
+      {"CASEI(status) LIKE 'occ%'", 34},
+      {"CASEI(status) IN ('locked', 'free')", 66},
+      {"CASEI(zone) = 'a'", 20}};  // zone is folded per evaluation
+  for (const auto& [query, expected] : queries) {
+    size_t count;
+    EXPECT_TRUE(folded.count(query, &count)) << folded.error_msg();
+    EXPECT_EQ(count, expected) << query;
+    EXPECT_TRUE(scan_.count(query, &count)) << scan_.error_msg();
+    EXPECT_EQ(count, expected) << query;
+  }
+
+  geos_nlohmann::json j;
+  j["status"] = "Free";
+  folded.Insert(std::make_shared<cql2cpp::FeatureSourceJson>(j));
+  size_t count;
+  EXPECT_TRUE(folded.count("CASEI(status) = CASEI('FREE')", &count));
+  EXPECT_EQ(count, 34);
+}
+
+TEST_F(FilterTest, temporal) {
+  cql2cpp::Cql2Cpp parsed;
+  parsed.RegisterTime("start");
+  parsed.RegisterTime("end");
+  parsed.set_feature_source(features_);
+  const std::vector<std::pair<std::string, size_t>> queries = {
+      {"T_AFTER(start, TIMESTAMP('2025-06-04T00:00:00Z'))", 27},
+      {"T_DURING(start, DATE('2025-06-02'))", 23},
+      {"T_INTERSECTS(INTERVAL(start, end), "
+       "INTERVAL('2025-06-01T10:15:00Z', '2025-06-01T12:00:00Z'))",
+       3},
+      {"T_BEFORE(INTERVAL(start, end), TIMESTAMP('2025-06-01T05:00:00Z'))", 5},
+      {"T_MEETS(INTERVAL(start, end), INTERVAL('2025-06-01T00:30:00Z', '..'))",
+       1},
+      {"T_INTERSECTS(INTERVAL(start, '..'), "
+       "TIMESTAMP('2025-06-03T12:15:00Z'))",
+       61}};
+  for (const auto& [query, expected] : queries) {
+    size_t count;
+    EXPECT_TRUE(parsed.count(query, &count)) << parsed.error_msg();
+    EXPECT_EQ(count, expected) << query;
+    EXPECT_TRUE(scan_.count(query, &count)) << scan_.error_msg();
+    EXPECT_EQ(count, expected) << query;
+  }
+}
+
+TEST_F(FilterTest, temporal_open_interval) {
+  std::string error_msg;
+  auto root = cql2cpp::Cql2Cpp::ParseAsAst(
+      "T_INTERSECTS(INTERVAL(start, '..'), "
+      "TIMESTAMP('2025-06-03T12:15:00Z'))",
+      &error_msg);
+  ASSERT_NE(root, nullptr) << error_msg;
+
+  cql2cpp::FoldedColumns folded;
+  cql2cpp::TimeColumns times;
+  cql2cpp::ArrayColumns arrays;
+  times.Register("start");
+  cql2cpp::EvaluationProfile profile;
+  cql2cpp::Evaluator evaluator;
+  evaluator.set_profile(&profile);
+  for (uint32_t i = 0; i < features_.size(); i++) {
+    times.Set(i, *features_.at(i));
+    cql2cpp::FeatureSourceColumns columns(*features_.at(i), folded, times,
+                                          arrays, i);
+    cql2cpp::ValueT value;
+    EXPECT_TRUE(evaluator.Evaluate(root, &columns, &value))
+        << evaluator.error_msg();
+  }
+
+  const cql2cpp::NodeProfile* p = profile.Get(root.get());
+  ASSERT_NE(p, nullptr);
+  EXPECT_EQ(p->trues, 61);
+  EXPECT_EQ(p->falses, 39);
+  // the open interval is related with the times parsed on load, its start
+  // is not read again
+  EXPECT_EQ(profile.Get(root->children().at(0).get()), nullptr);
+}
+
+TEST_F(FilterTest, interval_index) {
+  cql2cpp::Cql2Cpp intervals;
+  intervals.RegisterIndex(
+      std::make_shared<cql2cpp::IndexInterval>("start", "end"));
+  intervals.RegisterIndex(std::make_shared<cql2cpp::IndexInterval>("start"));
+  intervals.set_feature_source(features_);
+  const std::vector<std::pair<std::string, size_t>> queries = {
+      {"T_AFTER(start, TIMESTAMP('2025-06-04T00:00:00Z'))", 27},
+      {"T_DURING(start, DATE('2025-06-02'))", 23},
+      {"T_INTERSECTS(INTERVAL(start, end), "
+       "INTERVAL('2025-06-01T10:15:00Z', '2025-06-01T12:00:00Z'))",
+       3},
+      {"T_BEFORE(INTERVAL(start, end), TIMESTAMP('2025-06-01T05:00:00Z'))", 5},
+      {"T_AFTER(TIMESTAMP('2025-06-01T05:00:00Z'), INTERVAL(start, end))", 5},
+      {"T_CONTAINS(INTERVAL(start, end), "
+       "TIMESTAMP('2025-06-03T07:10:00Z')) AND floor = 1",
+       1}};
+  for (const auto& [query, expected] : queries) {
+    std::vector<cql2cpp::FeatureSourcePtr> scanned, found;
+    EXPECT_TRUE(scan_.filter(query, &scanned)) << scan_.error_msg();
+    EXPECT_TRUE(intervals.filter(query, &found)) << intervals.error_msg();
+    EXPECT_EQ(found, scanned) << query;
+    EXPECT_EQ(found.size(), expected) << query;
+  }
+
+  std::string explain;
+  EXPECT_TRUE(intervals.Explain(queries.at(2).first, &explain));
+  EXPECT_NE(explain.find("index interval(start): T_Intersects"),
+            std::string::npos)
+      << explain;
+  EXPECT_NE(explain.find("estimate 3 exact rows 3\n"), std::string::npos)
+      << explain;
+}
+
+TEST_F(FilterTest, metrics) {
+  using cql2cpp::MetricsSink;
+  cql2cpp::ThreadLocalMetricsSink metrics;
+  scan_.set_metrics_sink(&metrics);
+  indexed_.set_metrics_sink(&metrics);
+
+  size_t count;
+  EXPECT_TRUE(indexed_.count("status = 'FREE' AND capacity = 0", &count));
+  cql2cpp::MetricsSnapshot snapshot = metrics.Snapshot();
+  EXPECT_EQ(snapshot[MetricsSink::IndexPlans], 1);
+  EXPECT_EQ(snapshot[MetricsSink::FeaturesEvaluated], 33);
+  EXPECT_EQ(snapshot[MetricsSink::Matches], 8);
+
+  std::vector<cql2cpp::FeatureSourcePtr> result;
+  EXPECT_TRUE(scan_.filter("status = 'FREE' AND capacity = 0", &result));
+  EXPECT_FALSE(scan_.filter("status = ", &result));
+  indexed_.set_metrics_sink(nullptr);
+  EXPECT_TRUE(indexed_.count("status = 'FREE'", &count));
+
+  snapshot = metrics.Snapshot();
+  EXPECT_EQ(snapshot[MetricsSink::QueriesCompiled], 2);
+  EXPECT_EQ(snapshot[MetricsSink::IndexPlans], 1);
+  EXPECT_EQ(snapshot[MetricsSink::FullScans], 1);
+  EXPECT_EQ(snapshot[MetricsSink::FeaturesEvaluated], 133);
+  EXPECT_EQ(snapshot[MetricsSink::Matches], 16);
+  EXPECT_EQ(snapshot[MetricsSink::CompileLatency].count, 3);
+  EXPECT_EQ(snapshot[MetricsSink::FilterLatency].count, 2);
+}
+
+TEST_F(FilterTest, explain) {
+  const std::string query = "zone = 'A' AND status = 'FREE' AND weight >= 0";
+  EXPECT_EQ(Compare(query), 6);
+  std::string explain;
+  EXPECT_TRUE(indexed_.Explain(query, &explain));
+  // weight is not selective enough once zone and status narrowed it down
+  EXPECT_EQ(explain,
+            "features: 100\n"
+            "index inverted(zone): Equal(zone, A) estimate 20 exact rows 20\n"
+            "index inverted(status): Equal(status, FREE) estimate 33 exact "
+            "rows 6\n"
+            "residual: GreaterEqual(weight, 0)\n"
+            "candidates: 6\n");
+
+  EXPECT_TRUE(scan_.Explain(query, &explain));
+  EXPECT_EQ(explain.find("full scan"), 14);
+}
+
+TEST_F(FilterTest, insert_update_erase) {
+  for (auto* cql2cpp : {&scan_, &indexed_}) {
+    EXPECT_TRUE(cql2cpp->Erase(0));
+    EXPECT_FALSE(cql2cpp->Erase(0));
+    EXPECT_EQ(cql2cpp->feature(0), nullptr);
+
+    geos_nlohmann::json j;
+    j["status"] = "FREE";
+    j["zone"] = "A";
+    j["labels"] = {"CONTAINER"};
+    j["floor"] = 3;
+    j["weight"] = 5.0;
+    // the erased ordinal is reused first
+    EXPECT_EQ(cql2cpp->Insert(std::make_shared<cql2cpp::FeatureSourceJson>(j)),
+              0);
+    EXPECT_EQ(cql2cpp->Insert(std::make_shared<cql2cpp::FeatureSourceJson>(j)),
+              100);
+
+    j["status"] = "LOCKED";
+    j["floor"] = 100;
+    EXPECT_TRUE(
+        cql2cpp->Update(1, std::make_shared<cql2cpp::FeatureSourceJson>(j)));
+    EXPECT_FALSE(
+        cql2cpp->Update(200, std::make_shared<cql2cpp::FeatureSourceJson>(j)));
+  }
+
+  EXPECT_EQ(indexed_.size(), 101);
+  EXPECT_EQ(Compare("status = 'OCCUPIED'"), 33);
+  EXPECT_EQ(Compare("status = 'FREE'"), 34);
+  EXPECT_EQ(Compare("status = 'LOCKED'"), 34);
+  EXPECT_EQ(Compare("A_CONTAINS(labels, ['CONTAINER'])"), 17);
+  EXPECT_EQ(Compare("floor = 100"), 1);
+  EXPECT_EQ(Compare("weight < 10"), 3);
+}
+
+TEST_F(FilterTest, standing_query) {
+  uint32_t free_a, heavy;
+  EXPECT_TRUE(indexed_.Subscribe("status = 'FREE' AND zone = 'A'", &free_a));
+  EXPECT_TRUE(indexed_.Subscribe("weight > 1000", &heavy));
+  EXPECT_EQ(indexed_.subscription(free_a)->ToVector(),
+            std::vector<uint32_t>({10, 25, 40, 55, 70, 85}));
+  EXPECT_EQ(indexed_.subscription(heavy)->ToVector(),
+            std::vector<uint32_t>({96, 97, 98, 99}));
+
+  auto feature =
+      std::static_pointer_cast<cql2cpp::FeatureSourceJson>(features_.at(25));
+  std::vector<cql2cpp::Transition> transitions;
+  feature->json()["status"] = "LOCKED";
+  EXPECT_TRUE(indexed_.Notify(25, {"status"}, &transitions));
+  ASSERT_EQ(transitions.size(), 1);
+  EXPECT_EQ(transitions.at(0).query, free_a);
+  EXPECT_EQ(transitions.at(0).ordinal, 25);
+  EXPECT_FALSE(transitions.at(0).entered);
+
+  transitions.clear();
+  feature->json()["weight"] = 2000.0;
+  EXPECT_TRUE(indexed_.Notify(25, {"weight", "zone"}, &transitions));
+  ASSERT_EQ(transitions.size(), 1);
+  EXPECT_EQ(transitions.at(0).query, heavy);
+  EXPECT_TRUE(transitions.at(0).entered);
+  // the range index follows the change
+  EXPECT_EQ(Compare("weight > 1000"), 5);
+
+  transitions.clear();
+  EXPECT_TRUE(indexed_.Erase(96, &transitions));
+  ASSERT_EQ(transitions.size(), 1);
+  EXPECT_EQ(transitions.at(0).query, heavy);
+  EXPECT_FALSE(transitions.at(0).entered);
+  EXPECT_EQ(indexed_.subscription(heavy)->Count(), 4);
+
+  EXPECT_TRUE(indexed_.Unsubscribe(heavy));
+  EXPECT_FALSE(indexed_.Unsubscribe(heavy));
+  EXPECT_EQ(indexed_.subscription(heavy), nullptr);
+}
+
+class SpatialFilterTest : public testing::Test {
+ protected:
+  geos::io::GeoJSONFeatureCollection collection_{{}};
+  cql2cpp::Cql2Cpp scan_;
+  cql2cpp::Cql2Cpp indexed_;
+
+ public:
+  void SetUp() override {
+    // points on a 10 x 10 grid
+    geos_nlohmann::json fc;
+    fc["type"] = "FeatureCollection";
+    fc["features"] = geos_nlohmann::json::array();
+    for (int i = 0; i < 100; i++) {
+      geos_nlohmann::json f;
+      f["type"] = "Feature";
+      f["geometry"]["type"] = "Point";
+      f["geometry"]["coordinates"] = {i % 10, i / 10};
+      f["properties"]["floor"] = i % 6;
+      fc["features"].push_back(f);
+    }
+    collection_ = geos::io::GeoJSONReader().readFeatures(fc.dump());
+
+    std::vector<cql2cpp::FeatureSourcePtr> features;
+    for (const auto& feature : collection_.getFeatures())
+      features.emplace_back(
+          std::make_shared<cql2cpp::FeatureSourceGeoJson>(feature));
+    indexed_.RegisterIndex(std::make_shared<cql2cpp::IndexSpatial>("geom"));
+    indexed_.RegisterIndex(std::make_shared<cql2cpp::IndexRange>("floor"));
+    scan_.set_feature_source(features);
+    indexed_.set_feature_source(features);
+  }
+
+  size_t Compare(const std::string& query) {
+    size_t expected = 0;
+    size_t actual = 0;
+    EXPECT_TRUE(scan_.count(query, &expected)) << scan_.error_msg();
+    EXPECT_TRUE(indexed_.count(query, &actual)) << indexed_.error_msg();
+    EXPECT_EQ(expected, actual) << query;
+    return actual;
+  }
+
+  std::string Explain(const std::string& query) {
+    std::string explain;
+    EXPECT_TRUE(indexed_.Explain(query, &explain));
+    return explain;
+  }
+};
+
+TEST_F(SpatialFilterTest, intersects) {
+  const std::string bbox = "S_INTERSECTS(geom, BBOX(2.5, 2.5, 5.5, 4.5))";
+  EXPECT_EQ(Compare(bbox), 6);
+  EXPECT_NE(Explain(bbox).find("index spatial(geom)"), std::string::npos);
+  EXPECT_NE(Explain(bbox).find("residual: S_Intersects"), std::string::npos);
+
+  EXPECT_EQ(Compare("S_INTERSECTS(geom, POLYGON((0 0, 3 0, 0 3, 0 0)))"), 10);
+  EXPECT_EQ(Compare(bbox + " AND floor = 2"), 1);
+}
+
+TEST_F(SpatialFilterTest, within) {
+  const std::string within = "S_WITHIN(geom, BBOX(2.5, 2.5, 5.5, 4.5))";
+  EXPECT_EQ(Compare(within), 6);
+  EXPECT_NE(Explain(within).find("index spatial(geom)"), std::string::npos);
+  EXPECT_NE(Explain(within).find("residual: S_Within"), std::string::npos);
+
+  // disjoint geometries may have intersecting envelopes, so no lookup
+  const std::string disjoint = "S_DISJOINT(geom, BBOX(2.5, 2.5, 5.5, 4.5))";
+  EXPECT_EQ(Compare(disjoint), 94);
+  EXPECT_NE(Explain(disjoint).find("full scan"), std::string::npos);
+}
+
+TEST_F(SpatialFilterTest, not_selective) {
+  const std::string query = "S_INTERSECTS(geom, BBOX(-1, -1, 10, 10))";
+  EXPECT_EQ(Compare(query), 100);
+  EXPECT_NE(Explain(query).find("full scan"), std::string::npos);
+}
+
+TEST(SelectionSetTest, boolean) {
+  cql2cpp::SelectionSet even, third;
+  for (uint32_t i = 0; i < 200000; i += 2) even.Add(i);
+  for (uint32_t i = 0; i < 200000; i += 3) third.Add(i);
+  EXPECT_EQ(even.Count(), 100000);
+  EXPECT_EQ((even & third).Count(), 33334);
+  EXPECT_EQ((even | third).Count(), 133333);
+  EXPECT_EQ((even - third).Count(), 66666);
+  EXPECT_EQ(even.Not(200000).Count(), 100000);
+  EXPECT_TRUE(even.Not(200000).Contains(199999));
+  EXPECT_FALSE(even.Not(200000).Contains(199998));
+  EXPECT_EQ(cql2cpp::SelectionSet::All(200000), even | even.Not(200000));
+}
+
+TEST(SelectionSetTest, remove) {
+  cql2cpp::SelectionSet s;
+  for (uint32_t i = 0; i < 4097; i++) s.Add(i * 2);
+  for (int round = 0; round < 4; round++) {
+    s.Remove(0);
+    EXPECT_EQ(s.Count(), 4096);
+    EXPECT_FALSE(s.Contains(0));
+    s.Add(0);
+    EXPECT_EQ(s.Count(), 4097);
+    EXPECT_TRUE(s.Contains(0));
+  }
+  for (uint32_t i = 0; i < 4000; i++) s.Remove(i * 2);
+  EXPECT_EQ(s.Count(), 97);
+  EXPECT_FALSE(s.Contains(7998));
+  EXPECT_TRUE(s.Contains(8000));
+  cql2cpp::SelectionSet expected;
+  for (uint32_t i = 4000; i < 4097; i++) expected.Add(i * 2);
+  EXPECT_EQ(s, expected);
+  for (uint32_t i = 4000; i < 4097; i++) s.Remove(i * 2);
+  EXPECT_TRUE(s.Empty());
+}
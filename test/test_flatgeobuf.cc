@@ -0,0 +1,314 @@
+/*
+ * File Name: test_flatgeobuf.cc
+ *
+ * Copyright (c) 2024 - 2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/30
+ *
+ */
+#include <cql2cpp/cql2cpp.h>
+#include <cql2cpp/flatgeobuf_reader.h>
+#include <cql2cpp/flatgeobuf_writer.h>
+#include <geos/geom/Geometry.h>
+#include <geos/io/WKBWriter.h>
+#include <geos/io/WKTReader.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <set>
+#include <sstream>
+
+// bins.fgb has an index with nodes of 4 items, bins_no_index.fgb none.
+// Feature i < 100 is a point at (i % 10 + 0.5, i / 10 + 0.5) with name
+// bin-i, floor i % 3, zone A or B alternately, weight i / 2 and active if i
+// is a multiple of 7. Then follow a polygon with a hole, a multi line
+// string and a multi polygon.
+class FlatGeobufTest : public testing::TestWithParam<std::string> {
+ protected:
+  static std::string Name(const cql2cpp::FeatureSourcePtr& fs) {
+    return std::string(std::get<std::string_view>(fs->get_property("name")));
+  }
+
+  static std::set<std::string> Names(
+      const std::vector<cql2cpp::FeatureSourcePtr>& features) {
+    std::set<std::string> names;
+    for (const auto& fs : features) names.insert(Name(fs));
+    return names;
+  }
+};
+
+TEST_P(FlatGeobufTest, header) {
+  cql2cpp::FlatGeobufReader reader;
+  ASSERT_TRUE(reader.Open(GetParam())) << reader.error_msg();
+  EXPECT_EQ(reader.features_count(), 103);
+  EXPECT_EQ(reader.has_index(), GetParam() == "flatgeobuf/bins.fgb");
+  EXPECT_EQ(reader.extent().getMinX(), 0.5);
+  EXPECT_EQ(reader.extent().getMaxY(), 43);
+}
+
+TEST_P(FlatGeobufTest, properties) {
+  cql2cpp::FlatGeobufReader reader;
+  std::vector<cql2cpp::FeatureSourcePtr> features;
+  ASSERT_TRUE(reader.Open(GetParam()));
+  ASSERT_TRUE(reader.Load(&features)) << reader.error_msg();
+  ASSERT_EQ(features.size(), 103);
+  EXPECT_EQ(reader.decoded(), 103);
+
+  for (size_t i = 0; i < 100; i++) {
+    const auto& fs = features.at(i);
+    EXPECT_EQ(Name(fs), "bin-" + std::to_string(i));
+    EXPECT_EQ(std::get<int64_t>(fs->get_property("floor")),
+              static_cast<int64_t>(i % 3));
+    EXPECT_EQ(std::get<std::string_view>(fs->get_property("zone")),
+              i % 2 == 0 ? "A" : "B");
+    EXPECT_EQ(std::get<double>(fs->get_property("weight")), i * 0.5);
+    if (i % 7 == 0)
+      EXPECT_TRUE(std::get<bool>(fs->get_property("active")));
+    else
+      EXPECT_TRUE(
+          std::holds_alternative<cql2cpp::NullStruct>(fs->get_property("active")));
+  }
+  EXPECT_TRUE(std::holds_alternative<cql2cpp::NullStruct>(
+      features.at(100)->get_property("floor")));
+  EXPECT_EQ(std::get<int64_t>(features.at(101)->get_property("floor")), -1);
+  EXPECT_EQ(std::get<std::string_view>(features.at(102)->get_property("zone")),
+            "\xc3\xbc\"x");
+  EXPECT_TRUE(std::holds_alternative<cql2cpp::NullStruct>(
+      features.at(0)->get_property("missing")));
+}
+
+TEST_P(FlatGeobufTest, geometry) {
+  cql2cpp::FlatGeobufReader reader;
+  std::vector<cql2cpp::FeatureSourcePtr> features;
+  ASSERT_TRUE(reader.Open(GetParam()));
+  ASSERT_TRUE(reader.Load(&features));
+
+  auto geom = [&](size_t i) {
+    return std::get<const geos::geom::Geometry*>(
+        features.at(i)->get_property("geom"));
+  };
+  EXPECT_EQ(geom(13)->getGeometryType(), "Point");
+  EXPECT_EQ(geom(13)->getEnvelopeInternal()->getMinX(), 3.5);
+  EXPECT_EQ(geom(13)->getEnvelopeInternal()->getMinY(), 1.5);
+  EXPECT_EQ(geom(100)->getGeometryType(), "Polygon");
+  EXPECT_DOUBLE_EQ(geom(100)->getArea(), 15);
+  EXPECT_EQ(geom(101)->getGeometryType(), "MultiLineString");
+  EXPECT_DOUBLE_EQ(geom(101)->getLength(), 2 * std::sqrt(2));
+  EXPECT_EQ(geom(102)->getGeometryType(), "MultiPolygon");
+  EXPECT_DOUBLE_EQ(geom(102)->getArea(), 2);
+}
+
+TEST_P(FlatGeobufTest, window) {
+  cql2cpp::FlatGeobufReader reader;
+  ASSERT_TRUE(reader.Open(GetParam()));
+
+  // windows as minx, maxx, miny, maxy
+  for (auto [x1, x2, y1, y2] : std::vector<std::array<double, 4>>{
+           {2, 4.9, 2, 4.9},
+           {0, 100, 0, 100},
+           {9.6, 19, 0, 100},
+           {21.5, 21.6, 21.5, 21.6},
+           {-1, 0, -1, 0}}) {
+    geos::geom::Envelope window(x1, x2, y1, y2);
+    std::vector<cql2cpp::FeatureSourcePtr> features;
+    ASSERT_TRUE(reader.Load(&features, &window)) << reader.error_msg();
+    EXPECT_EQ(reader.decoded(), features.size());
+
+    std::set<std::string> expected;
+    for (size_t i = 0; i < 100; i++)
+      if (window.intersects(geos::geom::Envelope(
+              i % 10 + 0.5, i % 10 + 0.5, i / 10 + 0.5, i / 10 + 0.5)))
+        expected.insert("bin-" + std::to_string(i));
+    if (window.intersects(geos::geom::Envelope(20, 24, 20, 24)))
+      expected.insert("zone-1");
+    if (window.intersects(geos::geom::Envelope(30, 33, 0, 3)))
+      expected.insert("rail");
+    if (window.intersects(geos::geom::Envelope(40, 43, 40, 43)))
+      expected.insert("pair");
+    EXPECT_EQ(Names(features), expected) << window.toString();
+  }
+}
+
+TEST_P(FlatGeobufTest, query) {
+  std::string error_msg;
+  auto root = cql2cpp::Cql2Cpp::ParseAsAst(
+      "floor = 1 AND S_INTERSECTS(geom, BBOX(2, 2, 4.9, 4.9))", &error_msg);
+  ASSERT_NE(root, nullptr) << error_msg;
+
+  cql2cpp::FlatGeobufReader reader;
+  std::vector<cql2cpp::FeatureSourcePtr> features;
+  ASSERT_TRUE(reader.Open(GetParam()));
+  ASSERT_TRUE(reader.Load(root, &features));
+  EXPECT_EQ(reader.decoded(), 9);
+
+  cql2cpp::Cql2Cpp cql2cpp;
+  std::set<std::string> names;
+  for (const auto& fs : features)
+    if (cql2cpp.Matches(root, *fs)) names.insert(Name(fs));
+  EXPECT_EQ(names, std::set<std::string>({"bin-22", "bin-34", "bin-43"}));
+
+  // no spatial window, every feature is decoded
+  root = cql2cpp::Cql2Cpp::ParseAsAst("floor = 1", &error_msg);
+  features.clear();
+  ASSERT_TRUE(reader.Load(root, &features));
+  EXPECT_EQ(reader.decoded(), 103);
+}
+
+INSTANTIATE_TEST_SUITE_P(Files, FlatGeobufTest,
+                         testing::Values("flatgeobuf/bins.fgb",
+                                         "flatgeobuf/bins_no_index.fgb"));
+
+TEST(FlatGeobuf, invalid) {
+  cql2cpp::FlatGeobufReader reader;
+  EXPECT_FALSE(reader.Open("geojson/1.geojson"));
+  EXPECT_FALSE(reader.error_msg().empty());
+  EXPECT_FALSE(reader.Open("flatgeobuf/missing.fgb"));
+}
+
+// Json columns holding arrays are read as arrays, other JSON as null
+TEST(FlatGeobuf, json_arrays) {
+  using cql2cpp::FlatGeobufType;
+  cql2cpp::FlatGeobufWriter writer("bins", 1,
+                                   {{"labels", FlatGeobufType::Json}}, 0);
+  std::stringstream wkb;
+  geos::io::WKBWriter().write(
+      *geos::io::WKTReader().read("POINT (1 2)"), wkb);
+  cql2cpp::ArrayType labels = {cql2cpp::ValueT(std::string("COLD")),
+                                cql2cpp::ValueT(std::string("PICKING"))};
+  ASSERT_TRUE(writer.Add(wkb.str(), {std::string("[\"BULK\", \"COLD\"]")}));
+  ASSERT_TRUE(writer.Add(wkb.str(), {labels}));
+  ASSERT_TRUE(writer.Add(wkb.str(), {std::string("{\"a\": 1}")}));
+  auto data = std::make_shared<std::string>();
+  std::ostringstream oss;
+  ASSERT_TRUE(writer.Write(oss)) << writer.error_msg();
+  *data = oss.str();
+
+  cql2cpp::FlatGeobufReader reader;
+  std::vector<cql2cpp::FeatureSourcePtr> features;
+  ASSERT_TRUE(reader.Open(data, reinterpret_cast<const uint8_t*>(data->data()),
+                          data->size()))
+      << reader.error_msg();
+  ASSERT_TRUE(reader.Load(&features));
+  ASSERT_EQ(features.size(), 3);
+  EXPECT_EQ(cql2cpp::value_str(features.at(1)->get_property("labels")),
+            cql2cpp::value_str(labels));
+  EXPECT_TRUE(std::holds_alternative<cql2cpp::NullStruct>(
+      features.at(2)->get_property("labels")));
+
+  std::string error_msg;
+  auto root = cql2cpp::Cql2Cpp::ParseAsAst("A_CONTAINS(labels, ['COLD'])",
+                                           &error_msg);
+  ASSERT_NE(root, nullptr) << error_msg;
+  cql2cpp::Cql2Cpp cql2cpp;
+  EXPECT_TRUE(cql2cpp.Matches(root, *features.at(0)));
+  EXPECT_TRUE(cql2cpp.Matches(root, *features.at(1)));
+  EXPECT_FALSE(cql2cpp.Matches(root, *features.at(2)));
+}
+
+// write the features of bins.fgb again and read them back
+TEST(FlatGeobuf, collection_z) {
+  // a multi polygon of a file with z whose second part has no z
+  using cql2cpp::FlatBuilder;
+  std::vector<double> xy = {0, 0, 1, 0, 1, 1, 0, 1, 0, 0};
+  std::vector<double> z = {1, 1, 1, 1, 1};
+  std::string buffer = FlatBuilder::Finish(
+      {FlatBuilder::TablesOf(7, {{FlatBuilder::VectorOf(1, xy),
+                                  FlatBuilder::VectorOf(2, z)},
+                                 {FlatBuilder::VectorOf(1, xy)}})});
+  auto g = cql2cpp::FlatTable::Root(
+      reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
+  std::string wkb;
+  ASSERT_TRUE(cql2cpp::FeatureSourceFlatGeobuf::ToWkb(g, 6, true, &wkb));
+
+  // both parts have z like the collection, NaN where the file has none
+  auto type = [&wkb](size_t pos) {
+    uint32_t type;
+    std::memcpy(&type, wkb.data() + pos + 1, 4);
+    return type;
+  };
+  const size_t part = 1 + 4 + 4 + 4 + 5 * 24;
+  ASSERT_EQ(wkb.size(), 1 + 4 + 4 + 2 * part);
+  EXPECT_EQ(type(0), 1006);
+  EXPECT_EQ(type(9), 1003);
+  EXPECT_EQ(type(9 + part), 1003);
+  double last_z;
+  std::memcpy(&last_z, wkb.data() + wkb.size() - 8, 8);
+  EXPECT_TRUE(std::isnan(last_z));
+}
+
+TEST(FlatGeobuf, writer) {
+  cql2cpp::FlatGeobufReader reader;
+  std::vector<cql2cpp::FeatureSourcePtr> features;
+  ASSERT_TRUE(reader.Open("flatgeobuf/bins.fgb"));
+  ASSERT_TRUE(reader.Load(&features));
+
+  using cql2cpp::FlatGeobufType;
+  std::vector<cql2cpp::FlatGeobufWriter::Column> columns = {
+      {"name", FlatGeobufType::String},
+      {"floor", FlatGeobufType::Int},
+      {"zone", FlatGeobufType::String},
+      {"weight", FlatGeobufType::Double},
+      {"active", FlatGeobufType::Bool}};
+  cql2cpp::FlatGeobufWriter writer("bins", 0, columns, 4);
+  for (const auto& fs : features) {
+    std::string wkb;
+    ASSERT_TRUE(cql2cpp::FeatureSourceFlatGeobuf::ToWkb(
+        static_cast<cql2cpp::FeatureSourceFlatGeobuf*>(fs.get())
+            ->table()
+            .Table(0),
+        0, false, &wkb));
+    std::vector<cql2cpp::ValueT> values;
+    for (const auto& column : columns)
+      values.emplace_back(fs->get_property(column.name));
+    ASSERT_TRUE(writer.Add(wkb, values)) << writer.error_msg();
+  }
+  EXPECT_FALSE(writer.Add("", std::vector<cql2cpp::ValueT>(5)));
+  EXPECT_FALSE(writer.Add("", {}));
+
+  auto data = std::make_shared<std::string>();
+  std::ostringstream oss;
+  ASSERT_TRUE(writer.Write(oss));
+  *data = oss.str();
+
+  cql2cpp::FlatGeobufReader copy;
+  std::vector<cql2cpp::FeatureSourcePtr> copies;
+  ASSERT_TRUE(copy.Open(data, reinterpret_cast<const uint8_t*>(data->data()),
+                        data->size()))
+      << copy.error_msg();
+  EXPECT_EQ(copy.features_count(), 103);
+  EXPECT_TRUE(copy.has_index());
+  EXPECT_TRUE(copy.extent().equals(&reader.extent()));
+  ASSERT_TRUE(copy.Load(&copies));
+
+  // sorted along the Hilbert curve, so compare by name
+  std::map<std::string, cql2cpp::FeatureSourcePtr> by_name;
+  for (const auto& fs : copies)
+    by_name.emplace(
+        std::string(std::get<std::string_view>(fs->get_property("name"))), fs);
+  ASSERT_EQ(by_name.size(), 103);
+  for (const auto& fs : features) {
+    std::string name(std::get<std::string_view>(fs->get_property("name")));
+    const auto& other = by_name.at(name);
+    for (const auto& column : columns)
+      EXPECT_EQ(cql2cpp::value_str(fs->get_property(column.name)),
+                cql2cpp::value_str(other->get_property(column.name)))
+          << name << " " << column.name;
+    EXPECT_TRUE(std::get<const geos::geom::Geometry*>(fs->get_property("geom"))
+                    ->equals(std::get<const geos::geom::Geometry*>(
+                        other->get_property("geom"))))
+        << name;
+  }
+
+  for (const auto& window : {geos::geom::Envelope(2, 4.9, 2, 4.9),
+                             geos::geom::Envelope(21.5, 30.5, 0, 21.5)}) {
+    std::vector<cql2cpp::FeatureSourcePtr> expected, found;
+    ASSERT_TRUE(reader.Load(&expected, &window));
+    ASSERT_TRUE(copy.Load(&found, &window));
+    EXPECT_EQ(found.size(), expected.size()) << window.toString();
+  }
+}
@@ -0,0 +1,128 @@
+/*
+ * File Name: test_geojson_mapped_reader.cc
+ *
+ * Copyright (c) 2024 - 2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/28
+ *
+ */
+#include <cql2cpp/cql2cpp.h>
+#include <cql2cpp/feature_source_geojson_object.h>
+#include <cql2cpp/feature_source_mapped.h>
+#include <cql2cpp/geojson_mapped_reader.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+const std::string collection = R"({
+  "type": "FeatureCollection",
+  "name": "bins",
+  "bbox": [0, 0, 10, 10],
+  "features": [
+    {"type": "Feature", "id": "a",
+     "geometry": {"type": "Point", "coordinates": [1, 1]},
+     "properties": {"name": "a", "floor": 1, "tags": ["x", "y", null],
+                    "size": {"w": 2.5, "h": [3, -4]},
+                    "note": "caf\u00e9 \"\ud83d\ude00\"", "ok": true}},
+    {"type": "Feature", "id": "b",
+     "geometry": {"type": "Point", "coordinates": [5, 5]},
+     "properties": {"name": "b", "floor": 2, "tags": []}},
+    {"type": "Feature", "id": "c", "geometry": null,
+     "properties": {"name": "c", "floor": 2}}
+  ],
+  "crs": {"type": "name", "properties": {"name": "local"}}
+})";
+
+TEST(GeoJsonMappedReader, features) {
+  cql2cpp::GeoJsonMappedReader reader;
+  std::vector<std::string_view> features;
+  EXPECT_TRUE(reader.Read(collection, [&](std::string_view text) {
+    features.emplace_back(text);
+    return true;
+  }));
+  EXPECT_EQ(reader.count(), 3);
+  ASSERT_EQ(features.size(), 3);
+  auto expected = geos_nlohmann::json::parse(collection).at("features");
+  for (size_t i = 0; i < features.size(); i++)
+    EXPECT_EQ(geos_nlohmann::json::parse(features.at(i)), expected.at(i));
+}
+
+TEST(GeoJsonMappedReader, properties) {
+  auto expected = geos_nlohmann::json::parse(collection).at("features");
+  cql2cpp::GeoJsonMappedReader reader;
+  size_t i = 0;
+  EXPECT_TRUE(reader.Read(collection, [&](std::string_view text) {
+    cql2cpp::FeatureSourceMapped mapped(nullptr, text);
+    cql2cpp::FeatureSourceGeoJsonObject parsed(expected.at(i++));
+    for (const auto& path : {"name", "floor", "tags", "size", "size.w",
+                             "size.h", "size.d", "note", "ok", "missing"}) {
+      EXPECT_EQ(cql2cpp::value_str(mapped.get_property(path)),
+                cql2cpp::value_str(parsed.get_property(path)))
+          << path;
+    }
+    EXPECT_EQ(mapped.get_property("geom").index(),
+              parsed.get_property("geom").index());
+    return true;
+  }));
+
+  // strings without escapes are views into the text
+  std::string_view text;
+  reader.Read(collection, [&](std::string_view t) {
+    text = t;
+    return false;
+  });
+  cql2cpp::FeatureSourceMapped fs(nullptr, text);
+  auto name = fs.get_property("name");
+  ASSERT_TRUE(std::holds_alternative<std::string_view>(name));
+  EXPECT_EQ(std::get<std::string_view>(name).data(),
+            collection.data() + collection.find("\"a\", \"floor\"") + 1);
+  EXPECT_EQ(std::get<std::string>(fs.get_property("note")),
+            "caf\xc3\xa9 \"\xf0\x9f\x98\x80\"");
+}
+
+TEST(GeoJsonMappedReader, stop) {
+  cql2cpp::GeoJsonMappedReader reader;
+  EXPECT_FALSE(
+      reader.Read(collection, [&](std::string_view text) { return false; }));
+  EXPECT_EQ(reader.count(), 1);
+  EXPECT_EQ(reader.error_msg(), "stopped by callback");
+}
+
+TEST(GeoJsonMappedReader, invalid) {
+  cql2cpp::GeoJsonMappedReader reader;
+  size_t count = 0;
+  EXPECT_FALSE(reader.Read(collection.substr(0, collection.find("\"c\"")),
+                           [&](std::string_view text) {
+                             count++;
+                             return true;
+                           }));
+  EXPECT_FALSE(reader.error_msg().empty());
+  EXPECT_FALSE(reader.Read("{\"type\": \"FeatureCollection\"}",
+                           [&](std::string_view text) { return true; }));
+}
+
+TEST(GeoJsonMappedReader, load) {
+  std::string path = testing::TempDir() + "mapped_collection.geojson";
+  std::ofstream(path) << collection;
+
+  std::vector<cql2cpp::FeatureSourcePtr> features;
+  cql2cpp::GeoJsonMappedReader reader;
+  ASSERT_TRUE(reader.Load(path, &features)) << reader.error_msg();
+  ASSERT_EQ(features.size(), 3);
+  std::remove(path.c_str());  // still mapped
+
+  cql2cpp::Cql2Cpp cql2cpp;
+  cql2cpp.set_feature_source(features);
+  size_t count = 0;
+  EXPECT_TRUE(cql2cpp.count(
+      "floor = 2 AND S_INTERSECTS(geom, BBOX(4, 4, 6, 6))", &count));
+  EXPECT_EQ(count, 1);
+  EXPECT_TRUE(cql2cpp.count("name IN ('a', 'c')", &count));
+  EXPECT_EQ(count, 2);
+
+  EXPECT_FALSE(reader.Load(path, &features));
+  EXPECT_FALSE(reader.error_msg().empty());
+}
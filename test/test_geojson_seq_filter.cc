@@ -0,0 +1,100 @@
+/*
+ * File Name: test_geojson_seq_filter.cc
+ *
+ * Copyright (c) 2024 - 2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/29
+ *
+ */
+#include <cql2cpp/cql2cpp.h>
+#include <cql2cpp/geojson_seq_filter.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+// floor is i % 3 for feature i
+static std::string Lines(size_t n) {
+  std::stringstream ss;
+  for (size_t i = 0; i < n; i++)
+    ss << "{\"type\": \"Feature\", \"id\": " << i
+       << ", \"geometry\": {\"type\": \"Point\", \"coordinates\": [" << i
+       << ", 0]}, \"properties\": {\"floor\": " << i % 3 << "}}\n";
+  return ss.str();
+}
+
+static bool FloorIsOne(const cql2cpp::FeatureSource& fs) {
+  auto floor = fs.get_property("floor");
+  return std::holds_alternative<uint64_t>(floor) and
+         std::get<uint64_t>(floor) == 1;
+}
+
+TEST(GeoJsonSeqFilter, order) {
+  std::string lines = Lines(1000);
+  std::string expected;
+  std::istringstream all(lines);
+  std::string line;
+  for (size_t i = 0; std::getline(all, line); i++)
+    if (i % 3 == 1) expected += line + "\n";
+
+  // batches smaller than the input and queues shorter than the batches
+  for (size_t batch_lines : {1, 7, 1024}) {
+    cql2cpp::GeoJsonSeqFilter filter(FloorIsOne, batch_lines, 2);
+    std::istringstream in(lines);
+    std::ostringstream out;
+    EXPECT_TRUE(filter.Run(in, out)) << filter.error_msg();
+    EXPECT_EQ(filter.count(), 1000);
+    EXPECT_EQ(filter.selected(), 333);
+    EXPECT_EQ(out.str(), expected);
+  }
+}
+
+TEST(GeoJsonSeqFilter, lines) {
+  // record separators of RFC 8142, blank lines, CRLF and lines which are
+  // not features, the last one without a newline
+  std::istringstream in(
+      "\x1e{\"properties\": {\"floor\": 1}}\n"
+      "\n"
+      "  \r\n"
+      "not a feature\n"
+      "[1, 2]\n"
+      "{\"properties\": {\"floor\": 2}}\r\n"
+      "{\"properties\": {\"floor\": 1}}\r\n"
+      "{\"properties\": {\"floor\": 1}}");
+  std::ostringstream out;
+  cql2cpp::GeoJsonSeqFilter filter(FloorIsOne);
+  EXPECT_TRUE(filter.Run(in, out));
+  EXPECT_EQ(filter.count(), 4);
+  EXPECT_EQ(filter.skipped(), 2);
+  EXPECT_EQ(filter.selected(), 3);
+  EXPECT_EQ(out.str(),
+            "\x1e{\"properties\": {\"floor\": 1}}\n"
+            "{\"properties\": {\"floor\": 1}}\r\n"
+            "{\"properties\": {\"floor\": 1}}\n");
+}
+
+TEST(GeoJsonSeqFilter, empty) {
+  std::istringstream in("");
+  std::ostringstream out;
+  cql2cpp::GeoJsonSeqFilter filter(FloorIsOne);
+  EXPECT_TRUE(filter.Run(in, out));
+  EXPECT_EQ(filter.count(), 0);
+  EXPECT_EQ(out.str(), "");
+}
+
+TEST(GeoJsonSeqFilter, query) {
+  cql2cpp::Cql2Cpp cql2cpp;
+  std::string error_msg;
+  auto root = cql2cpp::Cql2Cpp::ParseAsAst(
+      "floor = 2 AND S_INTERSECTS(geom, BBOX(0, -1, 10, 1))", &error_msg);
+  ASSERT_NE(root, nullptr) << error_msg;
+
+  cql2cpp::GeoJsonSeqFilter filter([&](const cql2cpp::FeatureSource& fs) {
+    return cql2cpp.Matches(root, fs);
+  });
+  std::istringstream in(Lines(100));
+  std::ostringstream out;
+  EXPECT_TRUE(filter.Run(in, out));
+  EXPECT_EQ(filter.selected(), 3);  // 2, 5 and 8
+}
@@ -0,0 +1,82 @@
+/*
+ * File Name: test_geojson_stream_reader.cc
+ *
+ * Copyright (c) 2024 - 2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/27
+ *
+ */
+#include <cql2cpp/cql2cpp.h>
+#include <cql2cpp/feature_source_geojson_object.h>
+#include <cql2cpp/geojson_stream_reader.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+const std::string collection = R"({
+  "type": "FeatureCollection",
+  "name": "bins",
+  "bbox": [0, 0, 10, 10],
+  "features": [
+    {"type": "Feature", "id": "a",
+     "geometry": {"type": "Point", "coordinates": [1, 1]},
+     "properties": {"name": "a", "floor": 1, "tags": ["x", "y"],
+                    "size": {"w": 2, "h": [3, 4]}}},
+    {"type": "Feature", "id": "b",
+     "geometry": {"type": "Point", "coordinates": [5, 5]},
+     "properties": {"name": "b", "floor": 2, "tags": []}},
+    {"type": "Feature", "id": "c", "geometry": null,
+     "properties": {"name": "c", "floor": 2}}
+  ],
+  "crs": {"type": "name", "properties": {"name": "local"}}
+})";
+
+TEST(GeoJsonStreamReader, features) {
+  cql2cpp::GeoJsonStreamReader reader;
+  std::vector<geos_nlohmann::json> features;
+  EXPECT_TRUE(reader.Read(collection, [&](geos_nlohmann::json&& feature) {
+    features.emplace_back(std::move(feature));
+    return true;
+  }));
+  EXPECT_EQ(reader.count(), 3);
+  ASSERT_EQ(features.size(), 3);
+  auto expected = geos_nlohmann::json::parse(collection).at("features");
+  for (size_t i = 0; i < features.size(); i++)
+    EXPECT_EQ(features.at(i), expected.at(i));
+}
+
+TEST(GeoJsonStreamReader, stop) {
+  cql2cpp::GeoJsonStreamReader reader;
+  EXPECT_FALSE(reader.Read(
+      collection, [&](geos_nlohmann::json&& feature) { return false; }));
+  EXPECT_EQ(reader.count(), 1);
+}
+
+TEST(GeoJsonStreamReader, invalid) {
+  cql2cpp::GeoJsonStreamReader reader;
+  size_t count = 0;
+  EXPECT_FALSE(reader.Read(collection.substr(0, collection.find("\"c\"")),
+                           [&](geos_nlohmann::json&& feature) {
+                             count++;
+                             return true;
+                           }));
+  EXPECT_EQ(count, 2);
+  EXPECT_FALSE(reader.error_msg().empty());
+}
+
+TEST(GeoJsonStreamReader, filter) {
+  cql2cpp::Cql2Cpp cql2cpp;
+  std::string error_msg;
+  auto root = cql2cpp::Cql2Cpp::ParseAsAst(
+      "floor = 2 AND S_INTERSECTS(geom, BBOX(4, 4, 6, 6))", &error_msg);
+  ASSERT_NE(root, nullptr) << error_msg;
+
+  std::vector<std::string> names;
+  cql2cpp::GeoJsonStreamReader reader;
+  EXPECT_TRUE(reader.Read(collection, [&](geos_nlohmann::json&& feature) {
+    cql2cpp::FeatureSourceGeoJsonObject fs(feature);
+    if (cql2cpp.Matches(root, fs)) names.emplace_back(feature["id"]);
+    return true;
+  }));
+  EXPECT_EQ(names, std::vector<std::string>({"b"}));
+}
@@ -0,0 +1,195 @@
+/*
+ * File Name: test_lazy_geometry.cc
+ *
+ * Copyright (c) 2024 - 2025 IndoorSpatial
+ *
+ * Author: Kunlin Yu <yukunlin@syriusrobotics.com>
+ * Create Date: 2025/05/31
+ *
+ */
+#include <cql2cpp/cql2cpp.h>
+#include <cql2cpp/feature_source_geojson_object.h>
+#include <cql2cpp/flatgeobuf_reader.h>
+#include <cql2cpp/lazy_geometry.h>
+#include <geos/io/WKTReader.h>
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <thread>
+
+TEST(LazyGeometry, build) {
+  auto geometry = geos::io::WKTReader().read("LINESTRING (0 0, 2 1)");
+  cql2cpp::LazyGeometry lazy(*geometry);
+  EXPECT_FALSE(lazy.built());
+  EXPECT_TRUE(lazy.envelope().equals(geometry->getEnvelopeInternal()));
+  ASSERT_NE(lazy.get(), nullptr);
+  EXPECT_TRUE(lazy.built());
+  EXPECT_TRUE(lazy.get()->equals(geometry.get()));
+
+  cql2cpp::LazyGeometry invalid("not wkb", geos::geom::Envelope(0, 1, 0, 1));
+  EXPECT_EQ(invalid.get(), nullptr);
+}
+
+TEST(LazyGeometry, cache) {
+  auto cache = std::make_shared<cql2cpp::GeometryCache>(2);
+  std::vector<std::unique_ptr<cql2cpp::LazyGeometry>> geometries;
+  for (int i = 0; i < 3; i++)
+    geometries.emplace_back(std::make_unique<cql2cpp::LazyGeometry>(
+        *geos::io::WKTReader().read("POINT (" + std::to_string(i) + " 0)"),
+        cache));
+  for (const auto& g : geometries) EXPECT_NE(g->get(), nullptr);
+  EXPECT_EQ(cache->size(), 2);
+  EXPECT_EQ(cache->builds(), 3);
+  EXPECT_FALSE(geometries.at(0)->built());
+
+  // using one keeps it, the least recently used is dropped instead
+  geometries.at(1)->get();
+  geometries.at(0)->get();
+  EXPECT_TRUE(geometries.at(1)->built());
+  EXPECT_FALSE(geometries.at(2)->built());
+  EXPECT_EQ(cache->builds(), 4);
+
+  geometries.clear();
+  EXPECT_EQ(cache->size(), 0);
+}
+
+TEST(LazyGeometry, held) {
+  auto cache = std::make_shared<cql2cpp::GeometryCache>(2);
+  std::vector<std::unique_ptr<cql2cpp::FeatureSourceGeoJsonObject>> features;
+  for (int i = 0; i < 3; i++)
+    features.emplace_back(std::make_unique<cql2cpp::FeatureSourceGeoJsonObject>(
+        geos_nlohmann::json::parse(
+            R"({"type": "Feature", "properties": {}, "geometry": )"
+            R"({"type": "Point", "coordinates": [)" +
+            std::to_string(i) + ", 0]}}"),
+        cache));
+
+  // the geometry of the first feature outlives its dropping while pinned
+  cql2cpp::GeometryPins pins;
+  cql2cpp::ValueT first = features.at(0)->get_property("geom");
+  features.at(1)->get_property("geom");
+  features.at(2)->get_property("geom");
+  EXPECT_EQ(cache->builds(), 3);
+  ASSERT_TRUE(std::holds_alternative<const geos::geom::Geometry*>(first));
+  EXPECT_EQ(std::get<const geos::geom::Geometry*>(first)->toString(),
+            "POINT (0 0)");
+}
+
+TEST(LazyGeometry, threads) {
+  // features are shared by concurrent filters, each building on first use
+  auto cache = std::make_shared<cql2cpp::GeometryCache>(64);
+  std::vector<std::unique_ptr<cql2cpp::LazyGeometry>> geometries;
+  for (int i = 0; i < 32; i++)
+    geometries.emplace_back(std::make_unique<cql2cpp::LazyGeometry>(
+        *geos::io::WKTReader().read("POINT (" + std::to_string(i) + " 0)"),
+        i % 2 == 0 ? cache : nullptr));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++)
+    threads.emplace_back([&geometries]() {
+      for (int round = 0; round < 100; round++)
+        for (const auto& g : geometries) EXPECT_NE(g->get(), nullptr);
+    });
+  for (auto& thread : threads) thread.join();
+  for (const auto& g : geometries) EXPECT_TRUE(g->built());
+  EXPECT_EQ(cache->builds(), 16);
+}
+
+TEST(LazyGeometry, envelope_check) {
+  std::string error_msg;
+  auto root = cql2cpp::Cql2Cpp::ParseAsAst(
+      "S_INTERSECTS(geom, BBOX(2, 2, 4.9, 4.9))", &error_msg);
+  ASSERT_NE(root, nullptr) << error_msg;
+
+  auto cache = std::make_shared<cql2cpp::GeometryCache>(4);
+  cql2cpp::FlatGeobufReader reader;
+  reader.set_geometry_cache(cache);
+  std::vector<cql2cpp::FeatureSourcePtr> features;
+  ASSERT_TRUE(reader.Open("flatgeobuf/bins_no_index.fgb"));
+  ASSERT_TRUE(reader.Load(&features));
+
+  cql2cpp::Cql2Cpp cql2cpp;
+  size_t matches = 0;
+  for (const auto& fs : features)
+    if (cql2cpp.Matches(root, *fs)) matches++;
+  EXPECT_EQ(matches, 9);
+  // only the features whose envelope intersects the bbox are built
+  EXPECT_EQ(cache->builds(), 9);
+  EXPECT_EQ(cache->size(), 4);
+}
+
+TEST(LazyGeometry, spatial_index) {
+  auto cache = std::make_shared<cql2cpp::GeometryCache>(4);
+  cql2cpp::FlatGeobufReader reader;
+  reader.set_geometry_cache(cache);
+  std::vector<cql2cpp::FeatureSourcePtr> features;
+  ASSERT_TRUE(reader.Open("flatgeobuf/bins_no_index.fgb"));
+  ASSERT_TRUE(reader.Load(&features));
+
+  // the index is built from envelopes
+  cql2cpp::Cql2Cpp cql2cpp;
+  cql2cpp.RegisterIndex(std::make_shared<cql2cpp::IndexSpatial>("geom"));
+  cql2cpp.set_feature_source(features);
+  EXPECT_EQ(cache->builds(), 0);
+
+  size_t count = 0;
+  ASSERT_TRUE(cql2cpp.count("S_INTERSECTS(geom, BBOX(2, 2, 4.9, 4.9))", &count))
+      << cql2cpp.error_msg();
+  EXPECT_EQ(count, 9);
+  EXPECT_EQ(cache->builds(), 9);
+}
+
+TEST(LazyGeometry, geojson_object) {
+  auto feature = geos_nlohmann::json::parse(R"({
+    "type": "Feature",
+    "geometry": {"type": "Point", "coordinates": [1, 2]},
+    "properties": {"name": "a"}
+  })");
+  cql2cpp::FeatureSourceGeoJsonObject fs(feature);
+  geos::geom::Envelope envelope;
+  ASSERT_TRUE(fs.get_envelope("geom", &envelope));
+  geos::geom::Envelope expected(1, 1, 2, 2);
+  EXPECT_TRUE(envelope.equals(&expected));
+  EXPECT_FALSE(fs.get_envelope("name", &envelope));
+
+  std::string error_msg;
+  auto root = cql2cpp::Cql2Cpp::ParseAsAst(
+      "S_INTERSECTS(geom, BBOX(5, 5, 6, 6))", &error_msg);
+  ASSERT_NE(root, nullptr) << error_msg;
+  EXPECT_FALSE(cql2cpp::Cql2Cpp().Matches(root, fs));
+}
+
+TEST(LazyGeometry, is_null) {
+  // IS NULL of geom is answered without building the geometry
+  auto cache = std::make_shared<cql2cpp::GeometryCache>(4);
+  cql2cpp::FeatureSourceGeoJsonObject point(geos_nlohmann::json::parse(R"({
+    "type": "Feature",
+    "geometry": {"type": "Point", "coordinates": [1, 2]},
+    "properties": {"name": "a"}
+  })"), cache);
+  cql2cpp::FeatureSourceGeoJsonObject none(geos_nlohmann::json::parse(R"({
+    "type": "Feature",
+    "geometry": null,
+    "properties": {"name": "b"}
+  })"), cache);
+
+  std::string error_msg;
+  auto root = cql2cpp::Cql2Cpp::ParseAsAst("geom IS NULL", &error_msg);
+  ASSERT_NE(root, nullptr) << error_msg;
+  cql2cpp::Cql2Cpp cql2cpp;
+  EXPECT_FALSE(cql2cpp.Matches(root, point));
+  EXPECT_TRUE(cql2cpp.Matches(root, none));
+  EXPECT_EQ(cache->builds(), 0);
+
+  cql2cpp::FlatGeobufReader reader;
+  reader.set_geometry_cache(cache);
+  std::vector<cql2cpp::FeatureSourcePtr> features;
+  ASSERT_TRUE(reader.Open("flatgeobuf/bins_no_index.fgb"));
+  ASSERT_TRUE(reader.Load(&features));
+  root = cql2cpp::Cql2Cpp::ParseAsAst("geom IS NOT NULL", &error_msg);
+  ASSERT_NE(root, nullptr) << error_msg;
+  size_t matches = 0;
+  for (const auto& fs : features)
+    if (cql2cpp.Matches(root, *fs)) matches++;
+  EXPECT_EQ(matches, 103);
+  EXPECT_EQ(cache->builds(), 0);
+}
@@ -8,12 +8,14 @@
  *
  */
 #include <cql2cpp/cql2cpp.h>
+#include <cql2cpp/feature_source_json.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <thread>
 
 namespace fs = std::filesystem;
 
@@ -224,3 +226,85 @@ TEST_F(ParseExampleTest, example86) {EXPECT_TRUE(Parse(case_name_)); }
 
 TEST_F(TryAll, TryAll) { Run("supported/1.0/examples/text/"); }
 // clang-format on
+
+TEST(QueryCacheTest, normalize) {
+  using cql2cpp::QueryCache;
+  EXPECT_EQ(QueryCache::Normalize(" floor  >\t2\n and status = 'Free  Bin'"),
+            "floor > 2 AND status = 'Free  Bin'");
+  EXPECT_EQ(QueryCache::Normalize("s_intersects( geom , BBOX(0, 0, 1, 1) )"),
+            "S_INTERSECTS(geom,BBOX(0,0,1,1))");
+  EXPECT_EQ(QueryCache::Normalize("zone in ('A', 'B')"), "zone IN ('A','B')");
+  // names are case sensitive and NOT IN is a token in upper case only
+  EXPECT_EQ(QueryCache::Normalize("Floor > 2"), "Floor > 2");
+  EXPECT_EQ(QueryCache::Normalize("zone NOT in ('A')"),
+            "zone NOT in ('A')");
+}
+
+TEST(QueryCacheTest, cql2cpp) {
+  auto cache = std::make_shared<cql2cpp::QueryCache>(2);
+  cql2cpp::Cql2Cpp::set_query_cache(cache);
+
+  cql2cpp::AstNodePtr root =
+      cql2cpp::Cql2Cpp::ParseAsAst("floor > 2", nullptr);
+  ASSERT_NE(root, nullptr);
+  // a clone of the cached tree
+  cql2cpp::AstNodePtr hit =
+      cql2cpp::Cql2Cpp::ParseAsAst(" floor  >  2 ", nullptr);
+  ASSERT_NE(hit, nullptr);
+  EXPECT_NE(hit, root);
+  EXPECT_EQ(hit->id(), root->id());
+  ASSERT_EQ(hit->children().size(), 2);
+  EXPECT_NE(hit->children().at(1), root->children().at(1));
+  EXPECT_TRUE(hit->children().at(1)->constant());
+  std::string sql, error_msg;
+  EXPECT_TRUE(cql2cpp::Cql2Cpp::ConvertToSQL("floor >\n2", &sql, &error_msg));
+  EXPECT_EQ(cache->hits(), 2);
+  EXPECT_EQ(cache->misses(), 1);
+
+  // errors are not cached
+  EXPECT_EQ(cql2cpp::Cql2Cpp::ParseAsAst("floor >", nullptr), nullptr);
+  EXPECT_EQ(cql2cpp::Cql2Cpp::ParseAsAst("floor >", nullptr), nullptr);
+  EXPECT_EQ(cache->size(), 1);
+
+  EXPECT_NE(cql2cpp::Cql2Cpp::ParseAsAst("floor < 2", nullptr), nullptr);
+  EXPECT_NE(cql2cpp::Cql2Cpp::ParseAsAst("floor = 2", nullptr), nullptr);
+  EXPECT_EQ(cache->size(), 2);
+  EXPECT_NE(cql2cpp::Cql2Cpp::ParseAsAst("floor > 2", nullptr), nullptr);
+  EXPECT_EQ(cache->misses(), 6);
+
+  cql2cpp::Cql2Cpp::set_query_cache(nullptr);
+  EXPECT_EQ(cql2cpp::Cql2Cpp::query_cache(), nullptr);
+}
+
+// one cached query filtering from several threads, each evaluating its own
+// clone
+TEST(QueryCacheTest, threads) {
+  auto cache = std::make_shared<cql2cpp::QueryCache>();
+  cql2cpp::Cql2Cpp::set_query_cache(cache);
+
+  std::vector<cql2cpp::FeatureSourcePtr> features;
+  for (int i = 0; i < 1000; i++)
+    features.emplace_back(std::make_shared<cql2cpp::FeatureSourceJson>(
+        geos_nlohmann::json{{"floor", i % 5}, {"zone", i % 2 ? "A" : "B"}}));
+
+  const std::string query = "floor > 2 AND zone = 'A'";
+  std::vector<size_t> matches(4, 0);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < matches.size(); t++)
+    threads.emplace_back([&, t]() {
+      cql2cpp::Cql2Cpp cql2cpp;
+      for (int round = 0; round < 10; round++) {
+        cql2cpp::AstNodePtr root = cql2cpp::Cql2Cpp::ParseAsAst(query, nullptr);
+        if (root == nullptr) return;
+        for (const auto& fs : features)
+          if (cql2cpp.Matches(root, *fs)) matches.at(t)++;
+      }
+    });
+  for (auto& thread : threads) thread.join();
+
+  for (size_t count : matches) EXPECT_EQ(count, 10 * 200);
+  EXPECT_EQ(cache->size(), 1);
+  EXPECT_EQ(cache->hits() + cache->misses(), 40);
+
+  cql2cpp::Cql2Cpp::set_query_cache(nullptr);
+}
@@ -8,6 +8,7 @@
  *
  */
 #include <cql2cpp/cql2cpp.h>
+#include <cql2cpp/db_filter.h>
 #include <gtest/gtest.h>
 #include <sqlite3.h>
 //
@@ -227,3 +228,262 @@ TEST_F(SqlTest, example83) { EXPECT_TRUE(Convert(case_name_)); }
 TEST_F(SqlTest, example84) { EXPECT_TRUE(Convert(case_name_)); }
 TEST_F(SqlTest, example85) { EXPECT_TRUE(Convert(case_name_)); }
 TEST_F(SqlTest, example85_alt01) { EXPECT_TRUE(Convert(hyphen(case_name_))); }
+// clang-format on
+
+// true if an integer is even
+class FunctorEven : public cql2cpp::Functor {
+ public:
+  std::string name() const override { return "even"; }
+  bool operator()(const std::vector<cql2cpp::ValueT> &arguments,
+                  cql2cpp::ValueT *result,
+                  std::string *error_msg) const override {
+    if (arguments.size() != 1 or
+        not std::holds_alternative<int64_t>(arguments.at(0))) {
+      *error_msg = "even expects 1 integer";
+      return false;
+    }
+    *result = std::get<int64_t>(arguments.at(0)) % 2 == 0;
+    return true;
+  }
+};
+
+// true if a geometry is a point
+class FunctorIsPoint : public cql2cpp::Functor {
+ public:
+  std::string name() const override { return "is_point"; }
+  bool operator()(const std::vector<cql2cpp::ValueT> &arguments,
+                  cql2cpp::ValueT *result,
+                  std::string *error_msg) const override {
+    if (arguments.size() != 1 or
+        not std::holds_alternative<const geos::geom::Geometry *>(
+            arguments.at(0))) {
+      *error_msg = "is_point expects 1 geometry";
+      return false;
+    }
+    *result = std::get<const geos::geom::Geometry *>(arguments.at(0))
+                  ->getGeometryType() == "Point";
+    return true;
+  }
+};
+
+// Row i + 1 of table bins is a point at (i % 10 + 0.5, i / 10 + 0.5) with
+// name bin-i, floor i % 3, weight i / 2 and zone A or B alternately.
+class DbFilterTest : public testing::Test {
+ protected:
+  sqlite3 *db_ = nullptr;
+
+  void SetUp() override {
+    spatialite_init(0);
+    ASSERT_EQ(sqlite3_open(":memory:", &db_), SQLITE_OK);
+    Exec("SELECT InitSpatialMetadata(1);");
+    Exec(
+        "CREATE TABLE bins(id INTEGER PRIMARY KEY, name TEXT, floor INTEGER, "
+        "weight REAL, zone TEXT);");
+    Exec("SELECT AddGeometryColumn('bins', 'geom', 0, 'POINT', 'XY');");
+    Exec(
+        "WITH RECURSIVE n(i) AS (SELECT 0 UNION ALL SELECT i + 1 FROM n "
+        "WHERE i < 29) INSERT INTO bins SELECT i + 1, 'bin-' || i, i % 3, "
+        "i * 0.5, CASE i % 2 WHEN 0 THEN 'A' ELSE 'B' END, "
+        "MakePoint(i % 10 + 0.5, i / 10 + 0.5, 0) FROM n;");
+  }
+
+  void TearDown() override { sqlite3_close(db_); }
+
+  void Exec(const std::string &sql) {
+    char *error_msg = nullptr;
+    EXPECT_EQ(sqlite3_exec(db_, sql.c_str(), NULL, 0, &error_msg), SQLITE_OK)
+        << sql << ": " << (error_msg == nullptr ? "" : error_msg);
+    sqlite3_free(error_msg);
+  }
+
+  // the details of EXPLAIN QUERY PLAN for the last statement of a filter
+  std::string Plan(const cql2cpp::DbFilter &filter) {
+    sqlite3_stmt *stmt;
+    std::string error_msg;
+    std::string sql = "EXPLAIN QUERY PLAN " + filter.sql();
+    EXPECT_EQ(sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, NULL),
+              SQLITE_OK);
+    EXPECT_TRUE(cql2cpp::SqlStatementCache::Bind(stmt, filter.parameters(),
+                                                 &error_msg));
+    std::string plan;
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+      plan += std::string(reinterpret_cast<const char *>(
+                  sqlite3_column_text(stmt, 3))) +
+              "\n";
+    sqlite3_finalize(stmt);
+    return plan;
+  }
+
+  std::set<std::string> Filter(cql2cpp::DbFilter *filter,
+                               const std::string &query) {
+    std::string error_msg;
+    auto root = cql2cpp::Cql2Cpp::ParseAsAst(query, &error_msg);
+    EXPECT_NE(root, nullptr) << error_msg;
+    std::set<std::string> names;
+    EXPECT_TRUE(filter->Filter(root, [&](int64_t rowid, const auto &fs) {
+      names.insert("bin-" + std::to_string(rowid - 1));
+    })) << filter->error_msg();
+    return names;
+  }
+};
+
+TEST_F(DbFilterTest, pushdown) {
+  cql2cpp::DbFilter filter(db_, "bins");
+  EXPECT_EQ(Filter(&filter, "floor = 1 AND zone = 'A'"),
+            std::set<std::string>(
+                {"bin-4", "bin-10", "bin-16", "bin-22", "bin-28"}));
+  EXPECT_TRUE(filter.residual().empty());
+  EXPECT_EQ(filter.rows(), 5);
+
+  // OR and NOT keep their precedence in SQL
+  EXPECT_EQ(Filter(&filter, "NOT (floor = 1 OR floor = 2) AND weight < 5")
+                .size(),
+            4);
+  EXPECT_EQ(filter.rows(), 4);
+
+  EXPECT_EQ(Filter(&filter, "S_INTERSECTS(geom, BBOX(2, 1, 4.9, 2.9))"),
+            std::set<std::string>(
+                {"bin-12", "bin-13", "bin-14", "bin-22", "bin-23", "bin-24"}));
+  EXPECT_EQ(filter.rows(), 6);
+}
+
+TEST_F(DbFilterTest, residual) {
+  cql2cpp::DbFilter filter(db_, "bins");
+  filter.RegisterFunctor(std::make_shared<FunctorEven>());
+
+  // ids 2, 5, 8, ... 29 are on floor 1
+  EXPECT_EQ(Filter(&filter, "floor = 1 AND even(id)"),
+            std::set<std::string>(
+                {"bin-1", "bin-7", "bin-13", "bin-19", "bin-25"}));
+  EXPECT_EQ(filter.residual().size(), 1);
+  EXPECT_EQ(filter.rows(), 10);
+  EXPECT_EQ(filter.sql(),
+            "SELECT rowid, \"id\" FROM \"bins\" WHERE (\"floor\" = ?1)");
+
+  // nothing to push down, every row is read
+  EXPECT_EQ(Filter(&filter, "even(id)").size(), 15);
+  EXPECT_EQ(filter.rows(), 30);
+}
+
+TEST_F(DbFilterTest, like) {
+  cql2cpp::DbFilter filter(db_, "bins");
+  // LIKE is case sensitive as Cql2Cpp::filter evaluates it, not as SQLite
+  EXPECT_TRUE(Filter(&filter, "name LIKE 'BIN-1%' AND floor = 1").empty());
+  EXPECT_EQ(filter.residual().size(), 1);
+  EXPECT_EQ(Filter(&filter, "name LIKE 'bin-1%' AND floor = 1"),
+            std::set<std::string>({"bin-1", "bin-10", "bin-13", "bin-16",
+                                   "bin-19"}));
+  EXPECT_EQ(filter.rows(), 10);
+}
+
+TEST_F(DbFilterTest, parameters) {
+  cql2cpp::DbFilter filter(db_, "bins");
+  EXPECT_EQ(Filter(&filter, "zone = 'A' AND weight >= 12.5").size(), 2);
+  EXPECT_EQ(filter.sql(),
+            "SELECT rowid FROM \"bins\" WHERE (\"zone\" = ?1) AND "
+            "(\"weight\" >= ?2)");
+  EXPECT_EQ(filter.parameters(),
+            std::vector<cql2cpp::SqlParameter>({"A", 12.5}));
+
+  // other literals reuse the prepared statement
+  EXPECT_EQ(Filter(&filter, "zone = 'B' AND weight >= 10").size(), 5);
+  EXPECT_EQ(filter.statements().misses(), 1);
+  EXPECT_EQ(filter.statements().hits(), 1);
+
+  // geometries are bound as WKB
+  EXPECT_EQ(Filter(&filter, "S_INTERSECTS(geom, BBOX(2, 1, 4.9, 2.9))").size(),
+            6);
+  EXPECT_EQ(Filter(&filter, "S_INTERSECTS(geom, POINT(3.5 2.5))"),
+            std::set<std::string>({"bin-23"}));
+  EXPECT_TRUE(std::holds_alternative<std::vector<unsigned char>>(
+      filter.parameters().at(0)));
+  EXPECT_EQ(filter.statements().misses(), 2);
+}
+
+TEST(SQL_PARAMETERS, convert) {
+  std::string sql_where, error_msg;
+  std::vector<cql2cpp::SqlParameter> parameters;
+  EXPECT_TRUE(cql2cpp::Cql2Cpp::ConvertToSQL(
+      "name IN ('a', 'b') AND floor + 1 > 2 OR avg(weight) > 3",
+      {{"floor", "level"}}, &sql_where, &parameters, &error_msg))
+      << error_msg;
+  EXPECT_EQ(sql_where,
+            "(\"name\" IN (?1,?2) AND (\"level\" + ?3) > ?4 OR "
+            "avg(\"weight\") > ?5)");
+  EXPECT_EQ(parameters, std::vector<cql2cpp::SqlParameter>(
+                            {"a", "b", int64_t(1), int64_t(2), int64_t(3)}));
+}
+
+TEST_F(DbFilterTest, residual_geometry) {
+  cql2cpp::DbFilter filter(db_, "bins", {{"level", "floor"}});
+  filter.RegisterFunctor(std::make_shared<FunctorIsPoint>());
+
+  // the residual reads geometries as WKB
+  EXPECT_EQ(Filter(&filter, "is_point(geom) AND level = 2 AND weight < 3"),
+            std::set<std::string>({"bin-2", "bin-5"}));
+  EXPECT_EQ(filter.residual().size(), 1);
+  EXPECT_EQ(filter.sql(),
+            "SELECT rowid, ST_AsBinary(\"geom\") FROM \"bins\" WHERE "
+            "(\"floor\" = ?1) AND (\"weight\" < ?2)");
+
+  cql2cpp::DbFilter unknown(db_, "no_such_table");
+  std::string error_msg;
+  EXPECT_FALSE(unknown.Filter(
+      cql2cpp::Cql2Cpp::ParseAsAst("floor = 1", &error_msg),
+      [](int64_t, const auto &) {}));
+  EXPECT_FALSE(unknown.error_msg().empty());
+}
+
+TEST_F(DbFilterTest, spatial_index) {
+  Exec("SELECT CreateSpatialIndex('bins', 'geom');");
+  const std::string query = "S_INTERSECTS(geom, BBOX(2, 1, 4.9, 2.9))";
+  const std::set<std::string> expected = {"bin-12", "bin-13", "bin-14",
+                                          "bin-22", "bin-23", "bin-24"};
+
+  cql2cpp::DbFilter scan(db_, "bins");
+  EXPECT_EQ(Filter(&scan, query), expected);
+  std::string scan_plan = Plan(scan);
+  EXPECT_EQ(scan_plan.find("VIRTUAL TABLE"), std::string::npos);
+
+  cql2cpp::DbFilter index(db_, "bins");
+  index.set_dialect(cql2cpp::SqlDialect::SpatiaLite);
+  EXPECT_EQ(Filter(&index, query), expected);
+  EXPECT_EQ(index.rows(), expected.size());
+  std::string plan = Plan(index);
+  EXPECT_NE(plan.find("VIRTUAL TABLE"), std::string::npos);
+  EXPECT_NE(plan.find("INTEGER PRIMARY KEY"), std::string::npos);
+}
+
+TEST(SQL_DIALECT, spatial) {
+  std::string error_msg;
+  auto root = cql2cpp::Cql2Cpp::ParseAsAst(
+      "S_WITHIN(location, BBOX(-118, 33.8, -117.9, 34)) AND "
+      "S_DISJOINT(location, geom)",
+      &error_msg);
+  ASSERT_NE(root, nullptr) << error_msg;
+
+  auto convert = [&](cql2cpp::SqlDialect dialect, const std::string &table) {
+    std::vector<cql2cpp::SqlParameter> parameters;
+    cql2cpp::SqlConverter converter(
+        std::map<std::string, std::string>({{"location", "loc\"1"}}));
+    converter.set_dialect(dialect, table);
+    converter.set_parameters(&parameters);
+    std::string sql;
+    EXPECT_TRUE(converter.Convert(root, &sql)) << converter.error_msg();
+    EXPECT_EQ(parameters.size(), 1);
+    return sql;
+  };
+  EXPECT_EQ(convert(cql2cpp::SqlDialect::SQLite, "feature"),
+            "ST_Within(\"loc\"\"1\",ST_GeomFromWKB(?1)) AND "
+            "ST_Disjoint(\"loc\"\"1\",\"geom\")");
+  EXPECT_EQ(convert(cql2cpp::SqlDialect::SpatiaLite, "feature"),
+            "(ST_Within(\"loc\"\"1\",ST_GeomFromWKB(?1)) AND "
+            "\"feature\".ROWID IN (SELECT ROWID FROM SpatialIndex WHERE "
+            "f_table_name = 'feature' AND f_geometry_column = 'loc\"1' AND "
+            "search_frame = ST_GeomFromWKB(?1))) AND "
+            "ST_Disjoint(\"loc\"\"1\",\"geom\")");
+  EXPECT_EQ(convert(cql2cpp::SqlDialect::PostGIS, ""),
+            "(\"loc\"\"1\" && ST_GeomFromWKB($1) AND "
+            "ST_Within(\"loc\"\"1\",ST_GeomFromWKB($1))) AND "
+            "ST_Disjoint(\"loc\"\"1\",\"geom\")");
+}